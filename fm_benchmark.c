@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_rda5807.h>
+#include <rds_parser.h>
+#include <hardware/i2c.h>
+#include <pico/stdlib.h>
+#include <stdio.h>
+
+#if !FM_RDA5807_STATS_ENABLE
+#error "fm_benchmark requires FM_RDA5807_STATS_ENABLE"
+#endif
+
+static const uint SDIO_PIN = PICO_DEFAULT_I2C_SDA_PIN;
+static const uint SCLK_PIN = PICO_DEFAULT_I2C_SCL_PIN;
+
+// uncomment to benchmark interrupt mode, with RDA5807 GPIO2 connected to this pin
+// #define INTERRUPT_PIN 6
+
+// change this to match your local stations (kHz)
+static const uint32_t STATION_PRESETS[] = {
+    88800, // Radio Romania Actualitati
+    90400, // EBS
+    91700, // RFI
+    95600, // Radio Cluj
+    101000, // Radio Romania Cultural
+    107300, // Itsy Bitsy
+};
+
+// change this to configure FM band, channel spacing, and de-emphasis
+#define FM_CONFIG fm_config_europe()
+
+static const uint TUNE_ROUNDS = 10;
+static const uint SEEK_COUNT = 10;
+static const uint RDS_TIMEOUT_MS = 15000; // per station
+static const uint RDS_POLL_INTERVAL_MS = 10; // below the ~87.6ms group period
+
+static rda5807_t radio;
+static rds_parser_t rds_parser;
+static fm_histogram_t ps_histogram; // tune to complete PS
+static fm_histogram_t rt_histogram; // tune to complete RT
+
+static void print_histogram(const char *name, const fm_histogram_t *histogram) {
+    if (histogram->count == 0) {
+        printf("%-20s n=0\n", name);
+        return;
+    }
+    printf("%-20s n=%-5lu min=%-8lu avg=%-8lu p50<=%-8lu p90<=%-8lu p99<=%-8lu max=%lu us\n",
+        name,
+        (unsigned long)histogram->count,
+        (unsigned long)histogram->min_us,
+        (unsigned long)(histogram->total_us / histogram->count),
+        (unsigned long)fm_histogram_percentile_us(histogram, 50),
+        (unsigned long)fm_histogram_percentile_us(histogram, 90),
+        (unsigned long)fm_histogram_percentile_us(histogram, 99),
+        (unsigned long)histogram->max_us);
+}
+
+static void print_report(const char *title, uint64_t elapsed_us) {
+    const fm_stats_t *stats = fm_get_stats(&radio);
+    printf("== %s (%llu ms)\n", title, (unsigned long long)(elapsed_us / 1000));
+    printf("I2C: %lu transactions, %lu bytes written, %lu bytes read, %lu errors\n",
+        (unsigned long)stats->i2c_transactions,
+        (unsigned long)stats->i2c_bytes_written,
+        (unsigned long)stats->i2c_bytes_read,
+        (unsigned long)stats->i2c_errors);
+    printf("I2C recovery: %lu retries, %lu timeouts, %lu bus recoveries\n",
+        (unsigned long)stats->i2c_retries,
+        (unsigned long)stats->i2c_timeouts,
+        (unsigned long)stats->i2c_bus_recoveries);
+    printf("Async: %lu ticks, %llu us total\n",
+        (unsigned long)stats->async_ticks,
+        (unsigned long long)stats->async_tick_us);
+    printf("RDS: %lu groups\n", (unsigned long)stats->rds_groups);
+    print_histogram("tune", &stats->tune);
+    print_histogram("seek", &stats->seek);
+    print_histogram("rds_group_interval", &stats->rds_group_interval);
+    print_histogram("rds_ps_complete", &ps_histogram);
+    print_histogram("rds_rt_complete", &rt_histogram);
+    puts("");
+}
+
+static void benchmark_tune() {
+    // alternate between presets, measuring tune and register traffic
+    fm_reset_stats(&radio);
+    uint64_t start_time = time_us_64();
+    for (uint round = 0; round < TUNE_ROUNDS; round++) {
+        for (size_t i = 0; i < count_of(STATION_PRESETS); i++) {
+            fm_set_frequency_khz_blocking(&radio, STATION_PRESETS[i]);
+        }
+    }
+    print_report("tune", time_us_64() - start_time);
+}
+
+static void benchmark_seek() {
+    fm_reset_stats(&radio);
+    uint64_t start_time = time_us_64();
+    fm_set_frequency_khz_blocking(&radio, fm_get_frequency_range_khz(&radio).bottom);
+    for (uint i = 0; i < SEEK_COUNT; i++) {
+        fm_seek_blocking(&radio, FM_SEEK_UP);
+    }
+    print_report("seek", time_us_64() - start_time);
+}
+
+static void benchmark_rds() {
+    // time from tune until PS / RT are complete on each preset
+    fm_reset_stats(&radio);
+    ps_histogram = (fm_histogram_t){};
+    rt_histogram = (fm_histogram_t){};
+    uint64_t start_time = time_us_64();
+    for (size_t i = 0; i < count_of(STATION_PRESETS); i++) {
+        uint64_t tune_time = time_us_64();
+        fm_set_frequency_khz_blocking(&radio, STATION_PRESETS[i]);
+        rds_parser_reset(&rds_parser);
+
+        bool has_ps = false;
+        bool has_rt = !RDS_PARSER_RADIO_TEXT_ENABLE;
+        uint64_t timeout_time = tune_time + RDS_TIMEOUT_MS * 1000;
+        while ((!has_ps || !has_rt) && time_us_64() < timeout_time) {
+            union
+            {
+                uint16_t group_data[4];
+                rds_group_t group;
+            } rds;
+            if (fm_read_rds_group(&radio, rds.group_data)) {
+                rds_parser_update_with_errors(&rds_parser, &rds.group, fm_get_rds_block_errors(&radio));
+            }
+            if (!has_ps && rds_get_program_service_name_str(&rds_parser)[0] != '\0') {
+                fm_histogram_add(&ps_histogram, time_us_64() - tune_time);
+                has_ps = true;
+            }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+            if (!has_rt && rds_get_radio_text_str(&rds_parser)[0] != '\0') {
+                fm_histogram_add(&rt_histogram, time_us_64() - tune_time);
+                has_rt = true;
+            }
+#endif
+            sleep_ms(RDS_POLL_INTERVAL_MS);
+        }
+        printf("%.2f MHz: PS %s, RT %s\n",
+            fm_get_frequency(&radio),
+            has_ps ? "ok" : "timeout",
+            has_rt ? "ok" : "timeout");
+    }
+    print_report("rds", time_us_64() - start_time);
+}
+
+int main() {
+    stdio_init_all();
+    sleep_ms(2000); // give the stdio host time to connect
+
+    // RDA5807 supports up to 400kHz SCLK frequency
+    i2c_init(i2c_default, 400 * 1000);
+
+    fm_init(&radio, i2c_default, SDIO_PIN, SCLK_PIN, true /* enable_pull_ups */);
+#ifdef INTERRUPT_PIN
+    fm_enable_interrupt(&radio, INTERRUPT_PIN);
+#endif
+    sleep_ms(500); // wait for radio IC to initialize
+
+    fm_reset_stats(&radio);
+    uint64_t start_time = time_us_64();
+    fm_power_up(&radio, FM_CONFIG);
+    print_report("power up", time_us_64() - start_time);
+
+    benchmark_tune();
+    benchmark_seek();
+    benchmark_rds();
+
+    // standby and fast resume, including the retune
+    fm_power_down(&radio);
+    fm_reset_stats(&radio);
+    start_time = time_us_64();
+    fm_power_up_async(&radio, FM_CONFIG, 0);
+    fm_async_progress_t progress;
+    do {
+        progress = fm_async_task_tick(&radio);
+    } while (!progress.done);
+    print_report("resume", time_us_64() - start_time);
+
+    fm_power_down(&radio);
+    puts("Benchmark finished");
+    do {
+        sleep_ms(1000);
+    } while (true);
+}
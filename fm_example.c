@@ -4,23 +4,41 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <fm_executor.h>
 #include <fm_rda5807.h>
+#include <fm_storage.h>
+#include <fm_telemetry.h>
+#include <rds_capture.h>
 #include <rds_parser.h>
+#include <rds_poll_controller.h>
+#include <rds_station_cache.h>
 #include <hardware/i2c.h>
+#include <pico/async_context_poll.h>
 #include <pico/stdlib.h>
 #include <stdio.h>
+#include <string.h>
+
+#if LIB_PICO_STDIO_USB
+#include <pico/stdio_usb.h>
+#include <tusb.h>
+#else
+#include <hardware/uart.h>
+#endif
 
 static const uint SDIO_PIN = PICO_DEFAULT_I2C_SDA_PIN;
 static const uint SCLK_PIN = PICO_DEFAULT_I2C_SCL_PIN;
 
-// change this to match your local stations
-static const float STATION_PRESETS[] = {
-    88.8f, // Radio Romania Actualitati
-    90.4f, // EBS
-    91.7f, // RFI
-    95.6f, // Radio Cluj
-    101.0f, // Radio Romania Cultural
-    107.3f, // Itsy Bitsy
+// uncomment to enable interrupt mode, with RDA5807 GPIO2 connected to this pin
+// #define INTERRUPT_PIN 6
+
+// change this to match your local stations (kHz)
+static const uint32_t STATION_PRESETS[] = {
+    88800, // Radio Romania Actualitati
+    90400, // EBS
+    91700, // RFI
+    95600, // Radio Cluj
+    101000, // Radio Romania Cultural
+    107300, // Itsy Bitsy
 };
 static_assert(count_of(STATION_PRESETS) <= 9, "");
 
@@ -29,8 +47,38 @@ static_assert(count_of(STATION_PRESETS) <= 9, "");
 // change this to configure FM band, channel spacing, and de-emphasis
 #define FM_CONFIG fm_config_europe()
 
+static const uint RDS_POLL_INTERVAL_MS = 40;
+static const uint INPUT_POLL_INTERVAL_MS = 10;
+static const uint8_t AF_FOLLOW_RSSI = 20; // probe alternative frequencies below this signal strength
+static const uint AF_CHECK_INTERVAL_MS = 2000;
+static const uint SAVE_DELAY_MS = 10000; // let RDS decode the station name before saving
+static const uint TELEMETRY_POLL_INTERVAL_MS = 1;
+static const uint TELEMETRY_MAX_INPUT_PER_POLL = 64; // bytes
+static const uint16_t TELEMETRY_DEFAULT_QUALITY_PERIOD_MS = 100;
+static const uint TELEMETRY_EXIT_TIMEOUT_MS = 100; // flushing the output before text resumes
+
+static async_context_poll_t context;
 static rda5807_t radio;
+static fm_executor_t executor;
 static rds_parser_t rds_parser;
+static rds_poll_controller_t rds_poll_controller;
+static rds_station_cache_t rds_station_cache;
+static fm_station_t stations[FM_STORAGE_MAX_STATIONS];
+static size_t station_count;
+static uint64_t next_af_check_time;
+static fm_storage_t storage;
+static fm_storage_data_t storage_data;
+static uint64_t save_time; // 0 if no save pending
+static rds_capture_writer_t rds_capture;
+static fm_tracker_t tracker; // live signal of the presets
+static fm_telemetry_t telemetry;
+static bool telemetry_active; // binary mode, no text output
+static uint8_t telemetry_stream_flags; // FM_TELEMETRY_STREAM_xxx
+static uint16_t telemetry_quality_period_ms;
+static uint64_t next_quality_time;
+static uint8_t telemetry_task; // FM_TELEMETRY_CMD_xxx running as async task, 0 if none
+static uint32_t af_frequencies_khz[25]; // read by the AF probe while it runs
+static bool af_probe_running; // completed by on_task_done()
 
 static void print_help() {
     puts("RDA5807 - test program");
@@ -39,6 +87,10 @@ static void print_help() {
     puts("1-9   Station presets");
     puts("{ }   Frequency down / up");
     puts("[ ]   Seek down / up");
+    puts("s     Scan band");
+    puts("a     Probe alternative frequencies");
+    puts("g     Go to the strongest preset of this station");
+    puts("t     Print preset ranking");
     puts("<     Reduce seek threshold");
     puts(">     Increase seek threshold");
     puts("0     Toggle mute");
@@ -47,16 +99,21 @@ static void print_help() {
     puts("b     Toggle bass boost");
     puts("i     Print station info");
     puts("r     Print RDS info");
+    puts("c     Start / stop RDS capture, other keys are ignored meanwhile");
+    puts("p     Binary telemetry mode");
     puts("x     Power down");
     puts("?     Print help");
     puts("");
 }
 
 static void print_station_info() {
-    printf("%.2f MHz, RSSI: %u, stereo: %u\n",
+    const fm_quality_t *quality = fm_get_quality(&radio); // one read for all fields
+    printf("%.2f MHz, RSSI: %u (avg %u), stereo: %u, station: %u\n",
         fm_get_frequency(&radio),
-        fm_get_rssi(&radio),
-        fm_get_stereo_indicator(&radio));
+        quality->rssi,
+        quality->rssi_smoothed,
+        quality->stereo,
+        quality->fm_true);
 }
 
 static void print_rds_info() {
@@ -76,6 +133,12 @@ static void print_rds_info() {
     printf("      RT: %u-'%s'\n",
         rds_has_alternative_radio_text(&rds_parser),
         rds_get_radio_text_str(&rds_parser));
+    char rt_partial[65];
+    rds_get_radio_text_partial(&rds_parser, rt_partial);
+    printf("      RT segments: %04X of %04X, '%s'\n",
+        rds_get_radio_text_segments(&rds_parser),
+        rds_get_radio_text_expected_segments(&rds_parser),
+        rt_partial);
 #endif
 
 #if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
@@ -95,23 +158,110 @@ static void print_rds_info() {
         puts("");
     }
 #endif
+
+#if RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+    printf("      PTYN: %s\n", rds_get_program_type_name_str(&rds_parser));
+#endif
+
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+    const rds_clock_time_t *clock_time = rds_get_clock_time(&rds_parser);
+    if (clock_time != NULL) {
+        uint16_t year;
+        uint8_t month, day;
+        rds_decode_date(clock_time->mjd, &year, &month, &day);
+        uint8_t offset = clock_time->offset < 0 ? -clock_time->offset : clock_time->offset; // half hours
+        printf("      CT: %04u-%02u-%02u %02u:%02u UTC%c%u.%u\n", year, month, day, clock_time->hour, clock_time->minute,
+            clock_time->offset < 0 ? '-' : '+', offset / 2, (offset % 2) * 5);
+    }
+#endif
+
+#if RDS_PARSER_EON_ENABLE
+    for (size_t i = 0; i < rds_get_eon_network_count(&rds_parser); i++) {
+        const rds_eon_network_t *network = rds_get_eon_network(&rds_parser, i);
+        printf("      EON: %04X '%s' PTY: %u, TP: %u, TA: %u\n", network->pi, network->ps_str, network->pty, network->tp, network->ta);
+    }
+#endif
+}
+
+static void update_tracked_pi() {
+    // the tracker only samples PI on other presets, fill in the current one from RDS
+    uint32_t frequency_khz = fm_get_frequency_khz(&radio);
+    for (size_t i = 0; i < tracker.count; i++) {
+        if (tracker.stations[i].frequency_khz == frequency_khz && rds_get_program_id(&rds_parser) != 0) {
+            tracker.stations[i].pi = rds_get_program_id(&rds_parser);
+        }
+    }
+}
+
+static void on_rds_group(fm_executor_t *executor, const uint16_t *blocks, uint8_t block_errors) {
+    (void)executor;
+    rds_group_t group = {blocks[0], blocks[1], blocks[2], blocks[3]};
+    rds_parser_update_with_errors(&rds_parser, &group, block_errors);
+    rds_station_cache_update(&rds_station_cache, &rds_parser);
+    update_tracked_pi();
+    if (telemetry_active) {
+        if (telemetry_stream_flags & FM_TELEMETRY_STREAM_RDS) {
+            fm_telemetry_send_rds_group(&telemetry, blocks, block_errors, time_us_64());
+        }
+        return;
+    }
+    if (rds_capture_writer_is_active(&rds_capture)) {
+        rds_capture_writer_add(&rds_capture, blocks, block_errors, time_us_64());
+        return; // keep the binary stream clean
+    }
+
+    // show station name and Radio Text as they arrive
+    uint16_t changes = rds_parser_take_changes(&rds_parser);
+    if ((changes & RDS_CHANGE_PS) && rds_get_program_service_name_str(&rds_parser)[0] != '\0') {
+        printf("PS: %s\n", rds_get_program_service_name_str(&rds_parser));
+    }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    if ((changes & RDS_CHANGE_RT) && rds_get_radio_text_str(&rds_parser)[0] != '\0') {
+        printf("RT: %s\n", rds_get_radio_text_str(&rds_parser));
+    }
+#endif
 }
 
-static void update_rds() {
-    union
-    {
-        uint16_t group_data[4];
-        rds_group_t group;
-    } rds;
-    if (fm_read_rds_group(&radio, rds.group_data)) {
-        rds_parser_update(&rds_parser, &rds.group);
+static void write_capture(const uint8_t *data, size_t size, void *user_data) {
+    (void)user_data;
+    for (size_t i = 0; i < size; i++) {
+        putchar_raw(data[i]); // no CR/LF translation
     }
 }
 
-static void set_frequency(float frequency) {
-    fm_set_frequency_blocking(&radio, frequency);
+static void stop_capture() {
+    if (rds_capture_writer_is_active(&rds_capture)) {
+        rds_capture_writer_end(&rds_capture);
+        stdio_flush();
+        puts("\nCapture stopped");
+    }
+}
+
+static void toggle_capture() {
+    // Streams groups in the rds_capture.h format until stopped or retuned. Log the raw
+    // terminal output to a file, and replay it with the host rds_replay tool. Other keys
+    // and AF switching are paused meanwhile, nothing else gets printed into the stream.
+    if (rds_capture_writer_is_active(&rds_capture)) {
+        stop_capture();
+        return;
+    }
+    puts("Capture started");
+    stdio_flush();
+    rds_capture_writer_begin(&rds_capture, fm_get_frequency_khz(&radio), time_us_64());
+}
+
+static void reset_rds() {
+    stop_capture(); // one station per capture
+
+    // keeps the station being left, to show its name right away when it's tuned again
+    rds_station_cache_retune(&rds_station_cache, &rds_parser, fm_get_frequency_khz(&radio));
+    fm_executor_schedule(&executor);
+}
+
+static void set_frequency(uint32_t frequency_khz) {
+    fm_set_frequency_khz_blocking(&radio, frequency_khz);
     printf("%.2f MHz\n", fm_get_frequency(&radio));
-    rds_parser_reset(&rds_parser);
+    reset_rds();
 }
 
 static void seek(fm_seek_direction_t direction) {
@@ -134,13 +284,369 @@ static void seek(fm_seek_direction_t direction) {
     } else {
         printf("... failed: %d\n", progress.result);
     }
-    rds_parser_reset(&rds_parser);
+    reset_rds();
 }
 
-static void loop() {
+static void scan() {
+    puts("Scanning...");
+    station_count = fm_scan_blocking(&radio, stations, count_of(stations), fm_scan_config_default());
+    printf("... found %zu stations\n", station_count);
+    for (size_t i = 0; i < station_count; i++) {
+        const fm_station_t *station = &stations[i];
+        printf("    %.2f MHz, RSSI: %u, stereo: %u\n",
+            fm_get_channel_frequency(&radio, station->channel),
+            station->rssi,
+            (station->flags & FM_STATION_STEREO) != 0);
+    }
+}
+
+static void follow_alternative_frequency() {
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    // keep the station by switching to a stronger transmitter from its RDS AF list, the
+    // executor runs the probe in the background
+    size_t alt_freq_count = rds_get_alternative_frequency_count(&rds_parser);
+    if (alt_freq_count == 0) {
+        puts("No alternative frequencies");
+        return;
+    }
+    for (size_t i = 0; i < alt_freq_count; i++) {
+        af_frequencies_khz[i] = rds_decode_alternative_frequency_khz(rds_get_alternative_frequency(&rds_parser, i));
+    }
+    uint16_t pi = rds_get_program_id(&rds_parser);
+    fm_probe_af_async(&radio, af_frequencies_khz, alt_freq_count, pi, fm_af_config_default());
+    af_probe_running = true;
+    fm_executor_schedule(&executor);
+#else
+    puts("Alternative frequencies disabled");
+#endif
+}
+
+static void finish_af_probe(fm_async_progress_t progress) {
+    af_probe_running = false;
+    if (progress.result == 0) {
+        printf("Switched to alternative frequency %.2f MHz\n", fm_get_frequency(&radio));
+        reset_rds();
+    } else {
+        puts("Kept current frequency");
+        fm_executor_schedule(&executor);
+    }
+}
+
+static void print_ranking() {
+    puts("Presets by signal:");
+    for (size_t i = 0; i < tracker.count; i++) {
+        const fm_tracked_station_t *station = &tracker.stations[tracker.ranking[i]];
+        if (station->sample_time == 0) {
+            printf("    %.2f MHz, not sampled yet\n", station->frequency_khz / 1000.0);
+        } else {
+            printf("    %.2f MHz, RSSI: %u, PI: %04X, %llu s ago\n", station->frequency_khz / 1000.0, station->rssi, station->pi,
+                (unsigned long long)((time_us_64() - station->sample_time) / 1000000));
+        }
+    }
+}
+
+static void go_to_best_preset() {
+    // instant switch, the tracker already knows which transmitter is strongest
+    int index = fm_tracker_find_best(&tracker, rds_get_program_id(&rds_parser));
+    if (index < 0 || rds_get_program_id(&rds_parser) == 0) {
+        puts("Station not among the presets");
+        return;
+    }
+    uint32_t frequency_khz = tracker.stations[index].frequency_khz;
+    if (frequency_khz == fm_get_frequency_khz(&radio)) {
+        puts("Already on the strongest preset");
+        return;
+    }
+    set_frequency(frequency_khz);
+}
+
+static void finish_background_task() {
+    // tracker visits and AF probes are short, let the current one complete before handling a command
+    while (fm_async_task_is_running(&radio)) {
+        if (fm_async_task_is_due(&radio)) {
+            fm_async_progress_t progress = fm_async_task_tick(&radio);
+            if (progress.done && af_probe_running) {
+                finish_af_probe(progress); // not seen by the executor
+            }
+        } else {
+            tight_loop_contents();
+        }
+    }
+}
+
+static void check_tracker() {
+    // sample one preset at a time in the background, run by the executor
+    if (!fm_tracker_is_due(&tracker) || fm_async_task_is_running(&radio)) {
+        return;
+    }
+    fm_track_stations_async(&radio, &tracker);
+    fm_executor_schedule(&executor);
+}
+
+static void schedule_save() {
+    // wait for changes to settle, to spare flash
+    save_time = time_us_64() + SAVE_DELAY_MS * 1000;
+}
+
+static void check_save() {
+    if (save_time == 0 || time_us_64() < save_time) {
+        return;
+    }
+    save_time = 0;
+    memset(&storage_data, 0, sizeof(storage_data));
+    fm_storage_capture_radio(&storage_data, &radio);
+    storage_data.station_count = station_count;
+    memcpy(storage_data.stations, stations, station_count * sizeof(fm_station_t));
+    rds_station_cache_store(&rds_station_cache, &rds_parser); // keep the current station name
+    storage_data.station_cache = rds_station_cache;
+    fm_storage_save(&storage, &storage_data);
+}
+
+static void check_signal() {
+    // probe alternative frequencies when reception gets weak
+    if (time_us_64() < next_af_check_time) {
+        return;
+    }
+    next_af_check_time = time_us_64() + AF_CHECK_INTERVAL_MS * 1000;
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    if (rds_get_alternative_frequency_count(&rds_parser) != 0 && fm_get_rssi(&radio) < AF_FOLLOW_RSSI) {
+        printf("Weak signal, ");
+        follow_alternative_frequency();
+    }
+#endif
+}
+
+static size_t write_telemetry(const uint8_t *data, size_t size, void *user_data) {
+    (void)user_data;
+#if LIB_PICO_STDIO_USB
+    // only hand stdio what fits in the CDC FIFO, it would block once full
+    if (!stdio_usb_connected()) {
+        return size; // no host, discard
+    }
+    size = MIN(size, tud_cdc_write_available());
+    stdio_usb.out_chars((const char *)data, size);
+    return size;
+#else
+    size_t written = 0;
+    while (written < size && uart_is_writable(uart_default)) {
+        uart_putc_raw(uart_default, data[written++]);
+    }
+    return written;
+#endif
+}
+
+static void send_telemetry_status() {
+    fm_telemetry_status_t status = {0};
+    if (fm_is_powered_up(&radio)) {
+        status.frequency_khz = fm_get_frequency_khz(&radio);
+        status.volume = fm_get_volume(&radio);
+        status.flags = FM_TELEMETRY_STATUS_POWERED
+            | (fm_async_task_is_running(&radio) ? FM_TELEMETRY_STATUS_BUSY : 0)
+            | (fm_get_mute(&radio) ? FM_TELEMETRY_STATUS_MUTE : 0)
+            | (fm_get_softmute(&radio) ? FM_TELEMETRY_STATUS_SOFTMUTE : 0)
+            | (fm_get_mono(&radio) ? FM_TELEMETRY_STATUS_MONO : 0)
+            | (fm_get_bass_boost(&radio) ? FM_TELEMETRY_STATUS_BASS_BOOST : 0);
+    }
+    status.stream_flags = telemetry_stream_flags;
+    status.quality_period_ms = telemetry_quality_period_ms;
+    fm_telemetry_send_status(&telemetry, &status);
+}
+
+static void enter_telemetry() {
+    // Frames in the fm_telemetry.h format replace all text output, until the host sends
+    // FM_TELEMETRY_CMD_EXIT. AF following and the preset tracker pause, the host drives tuning.
+    stop_capture();
+    puts("Telemetry mode");
+    stdio_flush();
+    fm_telemetry_init(&telemetry);
+    telemetry_stream_flags = FM_TELEMETRY_STREAM_RDS;
+    telemetry_quality_period_ms = TELEMETRY_DEFAULT_QUALITY_PERIOD_MS;
+    next_quality_time = 0;
+    telemetry_active = true;
+    send_telemetry_status();
+}
+
+static void exit_telemetry() {
+    // let the ack out before text resumes
+    uint64_t deadline = time_us_64() + TELEMETRY_EXIT_TIMEOUT_MS * 1000;
+    while (fm_telemetry_get_pending(&telemetry) != 0 && time_us_64() < deadline) {
+        fm_telemetry_drain(&telemetry, write_telemetry, NULL);
+        tight_loop_contents();
+    }
+    telemetry_active = false;
+    fm_set_quality_period(&radio, FM_QUALITY_DEFAULT_PERIOD_MS);
+    puts("\nText mode");
+}
+
+static void on_task_done(fm_executor_t *executor, fm_async_progress_t progress) {
+    // completion of AF probes, and of commands started in telemetry mode
+    (void)executor;
+    if (af_probe_running) {
+        finish_af_probe(progress);
+        return;
+    }
+    uint8_t command = telemetry_task;
+    telemetry_task = 0;
+    if (command == FM_TELEMETRY_CMD_TUNE) {
+        fm_telemetry_send_event(&telemetry, FM_TELEMETRY_EVENT_TUNED, fm_get_frequency_khz(&radio));
+        reset_rds();
+    } else if (command == FM_TELEMETRY_CMD_SEEK) {
+        uint8_t event = progress.result == 0 ? FM_TELEMETRY_EVENT_SEEK_COMPLETE : FM_TELEMETRY_EVENT_SEEK_FAILED;
+        fm_telemetry_send_event(&telemetry, event, fm_get_frequency_khz(&radio));
+        reset_rds();
+    } else if (command == FM_TELEMETRY_CMD_SCAN) {
+        station_count = fm_get_scan_station_count(&radio);
+        for (size_t i = 0; i < station_count; i++) {
+            const fm_station_t *station = &stations[i];
+            fm_telemetry_send_station(&telemetry, fm_get_channel_frequency_khz(&radio, station->channel), station->rssi, station->flags);
+        }
+        fm_telemetry_send_event(&telemetry, FM_TELEMETRY_EVENT_SCAN_COMPLETE, station_count);
+    }
+}
+
+static uint8_t check_telemetry_command(const fm_telemetry_frame_t *frame) {
+    size_t length;
+    bool needs_radio = true;
+    bool needs_idle = false; // starts an async task
+    switch (frame->type) {
+    case FM_TELEMETRY_CMD_TUNE:
+        length = 4;
+        needs_idle = true;
+        break;
+    case FM_TELEMETRY_CMD_SEEK:
+        length = 1;
+        needs_idle = true;
+        break;
+    case FM_TELEMETRY_CMD_SCAN:
+        length = 0;
+        needs_idle = true;
+        break;
+    case FM_TELEMETRY_CMD_VOLUME:
+    case FM_TELEMETRY_CMD_MUTE:
+        length = 1;
+        break;
+    case FM_TELEMETRY_CMD_STREAM:
+        length = 3;
+        needs_radio = false;
+        break;
+    case FM_TELEMETRY_CMD_PING:
+    case FM_TELEMETRY_CMD_STATUS:
+    case FM_TELEMETRY_CMD_EXIT:
+        length = 0;
+        needs_radio = false;
+        break;
+    default:
+        return FM_TELEMETRY_ACK_INVALID;
+    }
+    if (frame->length != length) {
+        return FM_TELEMETRY_ACK_INVALID;
+    }
+    if (needs_radio && !fm_is_powered_up(&radio)) {
+        return FM_TELEMETRY_ACK_POWERED_DOWN;
+    }
+    if (needs_idle && fm_async_task_is_running(&radio)) {
+        return FM_TELEMETRY_ACK_BUSY;
+    }
+    if (frame->type == FM_TELEMETRY_CMD_TUNE) {
+        fm_frequency_range_khz_t range = fm_get_frequency_range_khz(&radio);
+        uint32_t frequency_khz = fm_telemetry_get_u32(frame->payload);
+        if (frequency_khz < range.bottom || range.top < frequency_khz) {
+            return FM_TELEMETRY_ACK_INVALID;
+        }
+    } else if (frame->type == FM_TELEMETRY_CMD_VOLUME && FM_MAX_VOLUME < frame->payload[0]) {
+        return FM_TELEMETRY_ACK_INVALID;
+    }
+    return FM_TELEMETRY_ACK_OK;
+}
+
+static void handle_telemetry_command(const fm_telemetry_frame_t *frame) {
+    uint8_t status = check_telemetry_command(frame);
+    fm_telemetry_send_ack(&telemetry, frame->type, status);
+    if (status != FM_TELEMETRY_ACK_OK) {
+        return;
+    }
+    const uint8_t *payload = frame->payload;
+    switch (frame->type) {
+    case FM_TELEMETRY_CMD_TUNE:
+        fm_set_frequency_khz_async(&radio, fm_telemetry_get_u32(payload));
+        telemetry_task = frame->type;
+        fm_executor_schedule(&executor);
+        schedule_save();
+        break;
+    case FM_TELEMETRY_CMD_SEEK:
+        fm_seek_async(&radio, payload[0] != 0 ? FM_SEEK_UP : FM_SEEK_DOWN);
+        telemetry_task = frame->type;
+        fm_executor_schedule(&executor);
+        schedule_save();
+        break;
+    case FM_TELEMETRY_CMD_SCAN:
+        fm_scan_async(&radio, stations, count_of(stations), fm_scan_config_default());
+        telemetry_task = frame->type;
+        fm_executor_schedule(&executor);
+        schedule_save();
+        break;
+    case FM_TELEMETRY_CMD_VOLUME:
+        fm_set_volume(&radio, payload[0]);
+        schedule_save();
+        break;
+    case FM_TELEMETRY_CMD_MUTE:
+        fm_set_mute(&radio, payload[0] != 0);
+        schedule_save();
+        break;
+    case FM_TELEMETRY_CMD_STREAM:
+        telemetry_stream_flags = payload[0];
+        telemetry_quality_period_ms = fm_telemetry_get_u16(&payload[1]);
+        next_quality_time = 0;
+        // refresh the cached signal quality at least as often as it's sampled
+        fm_set_quality_period(&radio, MIN(telemetry_quality_period_ms, FM_QUALITY_DEFAULT_PERIOD_MS));
+        break;
+    case FM_TELEMETRY_CMD_STATUS:
+        send_telemetry_status();
+        break;
+    case FM_TELEMETRY_CMD_EXIT:
+        exit_telemetry();
+        break;
+    default: // FM_TELEMETRY_CMD_PING
+        break;
+    }
+}
+
+static void check_quality_stream() {
+    // sampled between tasks, a seek or scan owns the tuner
+    if (!(telemetry_stream_flags & FM_TELEMETRY_STREAM_QUALITY) || !fm_is_powered_up(&radio)
+        || fm_async_task_is_running(&radio) || time_us_64() < next_quality_time) {
+        return;
+    }
+    next_quality_time = time_us_64() + telemetry_quality_period_ms * 1000;
+    const fm_quality_t *quality = fm_get_quality(&radio);
+    uint8_t flags = (quality->stereo ? FM_TELEMETRY_QUALITY_STEREO : 0) | (quality->fm_true ? FM_TELEMETRY_QUALITY_FM_TRUE : 0);
+    fm_telemetry_send_quality(&telemetry, quality->rssi, quality->rssi_smoothed, flags, time_us_64());
+}
+
+static void poll_telemetry() {
+    // take all pending input, a command may span several polls
+    for (uint i = 0; i < TELEMETRY_MAX_INPUT_PER_POLL && telemetry_active; i++) {
+        int result = getchar_timeout_us(0);
+        if (result == PICO_ERROR_TIMEOUT) {
+            break;
+        }
+        if (fm_telemetry_receive(&telemetry, (uint8_t)result)) {
+            handle_telemetry_command(fm_telemetry_get_frame(&telemetry));
+        }
+    }
+    if (telemetry_active) {
+        check_quality_stream();
+    }
+}
+
+static void poll_console() {
     int result = getchar_timeout_us(0);
     if (result != PICO_ERROR_TIMEOUT) {
+        if (rds_capture_writer_is_active(&rds_capture) && result != 'c') {
+            return; // keys would echo into the binary stream
+        }
         // handle command
+        finish_background_task();
         if (fm_is_powered_up(&radio)) {
             char ch = (char)result;
             if (ch == '-') {
@@ -154,26 +660,34 @@ static void loop() {
                     printf("Set volume: %u\n", fm_get_volume(&radio));
                 }
             } else if ('0' < ch && ch <= '0' + count_of(STATION_PRESETS)) {
-                float frequency = STATION_PRESETS[ch - '1'];
-                set_frequency(frequency);
+                uint32_t frequency_khz = STATION_PRESETS[ch - '1'];
+                set_frequency(frequency_khz);
             } else if (ch == '{') {
-                fm_frequency_range_t range = fm_get_frequency_range(&radio);
-                float frequency = fm_get_frequency(&radio) - range.spacing;
-                if (frequency < range.bottom) {
-                    frequency = range.top; // wrap to top
+                fm_frequency_range_khz_t range = fm_get_frequency_range_khz(&radio);
+                uint32_t frequency_khz = fm_get_frequency_khz(&radio) - range.spacing;
+                if (frequency_khz < range.bottom) {
+                    frequency_khz = range.top; // wrap to top
                 }
-                set_frequency(frequency);
+                set_frequency(frequency_khz);
             } else if (ch == '}') {
-                fm_frequency_range_t range = fm_get_frequency_range(&radio);
-                float frequency = fm_get_frequency(&radio) + range.spacing;
-                if (range.top < frequency) {
-                    frequency = range.bottom; // wrap to bottom
+                fm_frequency_range_khz_t range = fm_get_frequency_range_khz(&radio);
+                uint32_t frequency_khz = fm_get_frequency_khz(&radio) + range.spacing;
+                if (range.top < frequency_khz) {
+                    frequency_khz = range.bottom; // wrap to bottom
                 }
-                set_frequency(frequency);
+                set_frequency(frequency_khz);
             } else if (ch == '[') {
                 seek(FM_SEEK_DOWN);
             } else if (ch == ']') {
                 seek(FM_SEEK_UP);
+            } else if (ch == 's') {
+                scan();
+            } else if (ch == 'a') {
+                follow_alternative_frequency();
+            } else if (ch == 'g') {
+                go_to_best_preset();
+            } else if (ch == 't') {
+                print_ranking();
             } else if (ch == '<') {
                 if (0 < fm_get_seek_threshold(&radio)) {
                     fm_set_seek_threshold(&radio, fm_get_seek_threshold(&radio) - 1);
@@ -200,8 +714,13 @@ static void loop() {
                 print_station_info();
             } else if (ch == 'r') {
                 print_rds_info();
+            } else if (ch == 'c') {
+                toggle_capture();
+            } else if (ch == 'p') {
+                enter_telemetry();
             } else if (ch == 'x') {
                 if (fm_is_powered_up(&radio)) {
+                    stop_capture();
                     puts("Power down");
                     fm_power_down(&radio);
                     rds_parser_reset(&rds_parser);
@@ -209,16 +728,39 @@ static void loop() {
             } else if (ch == '?') {
                 print_help();
             }
+            schedule_save();
         } else {
             puts("Power up");
-            fm_power_up(&radio, FM_CONFIG);
+            fm_power_up_async(&radio, FM_CONFIG, 0); // resume from standby
+            fm_executor_schedule(&executor);
         }
     }
+}
 
-    if (fm_is_powered_up(&radio)) {
-        update_rds(&radio);
+static void loop() {
+    if (telemetry_active) {
+        poll_telemetry();
+    } else {
+        poll_console();
+    }
+
+    if (fm_is_powered_up(&radio) && !fm_async_task_is_running(&radio)) {
+        check_save();
+        if (!telemetry_active && !rds_capture_writer_is_active(&rds_capture)) {
+            // the host decides when to retune in telemetry mode, and a capture stays on one station
+            check_signal();
+            check_tracker();
+        }
+    }
+
+    // run RDS reads when due, sleeping in between
+    async_context_poll(&context.core);
+    if (telemetry_active) {
+        fm_telemetry_drain(&telemetry, write_telemetry, NULL);
+        async_context_wait_for_work_ms(&context.core, TELEMETRY_POLL_INTERVAL_MS);
+    } else {
+        async_context_wait_for_work_ms(&context.core, INPUT_POLL_INTERVAL_MS);
     }
-    sleep_ms(40);
 }
 
 int main() {
@@ -229,13 +771,39 @@ int main() {
     i2c_init(i2c_default, 400 * 1000);
 
     fm_init(&radio, i2c_default, SDIO_PIN, SCLK_PIN, true /* enable_pull_ups */);
-    sleep_ms(500); // wait for radio IC to initialize
-    fm_power_up(&radio, FM_CONFIG);
-    fm_set_frequency_blocking(&radio, DEFAULT_FREQUENCY);
-    fm_set_volume(&radio, 1);
-    fm_set_mute(&radio, false);
+#ifdef INTERRUPT_PIN
+    fm_enable_interrupt(&radio, INTERRUPT_PIN);
+#endif
+    // seek on past stops the chip doesn't detect as real stations
+    fm_seek_config_t seek_config = fm_seek_config_default();
+    seek_config.require_fm_true = true;
+    fm_set_seek_config(&radio, seek_config);
+    // power up and tune in the background, the executor runs the task
+    fm_storage_init(&storage);
+    if (fm_storage_load(&storage, &storage_data)) {
+        // warm boot, resume the last station with its cached name
+        fm_storage_restore_radio(&storage_data, &radio);
+        station_count = MIN(storage_data.station_count, count_of(stations));
+        memcpy(stations, storage_data.stations, station_count * sizeof(fm_station_t));
+        rds_station_cache = storage_data.station_cache;
+    } else {
+        fm_power_up_async(&radio, FM_CONFIG, DEFAULT_FREQUENCY);
+        fm_begin_update(&radio);
+        fm_set_volume(&radio, 1);
+        fm_set_mute(&radio, false);
+        fm_commit_update(&radio);
+        rds_station_cache_init(&rds_station_cache);
+    }
 
-    rds_parser_reset(&rds_parser);
+    rds_capture_writer_init(&rds_capture, write_capture, NULL);
+    fm_tracker_init(&tracker, STATION_PRESETS, count_of(STATION_PRESETS), fm_tracker_config_default());
+    async_context_poll_init_with_defaults(&context);
+    fm_executor_init(&executor, &radio, &context.core, NULL);
+    fm_executor_set_task_callback(&executor, on_task_done);
+    fm_executor_set_rds_callback(&executor, on_rds_group, RDS_POLL_INTERVAL_MS);
+    rds_poll_controller_init(&rds_poll_controller, rds_poll_config_default());
+    fm_executor_set_rds_poll_controller(&executor, &rds_poll_controller, &rds_parser);
+    reset_rds();
     do {
         loop();
     } while (true);
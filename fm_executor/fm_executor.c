@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_executor.h>
+#include <pico/stdlib.h>
+#include <string.h>
+
+//
+// workers
+//
+
+static uint32_t fm_executor_rds_poll_interval_us(fm_executor_t *executor) {
+    rds_poll_controller_t *controller = executor->rds_poll_controller;
+    if (controller == NULL) {
+        return executor->rds_poll_interval_us;
+    }
+    rda5807_t *radio = executor->radio;
+    uint64_t now = time_us_64();
+    uint32_t frequency_khz = fm_get_frequency_khz(radio);
+    if (frequency_khz != executor->rds_frequency_khz) {
+        executor->rds_frequency_khz = frequency_khz;
+        rds_poll_controller_reset(controller, now);
+    }
+    return rds_poll_controller_update(controller, executor->rds_parser, fm_get_rds_sync(radio), now) * 1000;
+}
+
+static void fm_executor_schedule_timeout(fm_executor_t *executor) {
+    // arm the timeout worker for the next poll, interrupts are handled by the pending worker
+    rda5807_t *radio = executor->radio;
+    async_context_remove_at_time_worker(executor->context, &executor->timeout_worker);
+    uint64_t time;
+    if (fm_async_task_is_running(radio)) {
+        time = fm_async_task_get_resume_time(radio);
+    } else if (executor->rds_callback != NULL && fm_is_powered_up(radio) && !radio->interrupt_enabled) {
+        time = time_us_64() + fm_executor_rds_poll_interval_us(executor);
+    } else {
+        return; // idle until the next interrupt or fm_executor_schedule()
+    }
+    async_context_add_at_time_worker_at(executor->context, &executor->timeout_worker, from_us_since_boot(time));
+}
+
+static void fm_executor_run(fm_executor_t *executor) {
+    rda5807_t *radio = executor->radio;
+    if (fm_async_task_is_running(radio)) {
+        fm_async_progress_t progress = fm_async_task_tick(radio);
+        if (progress.done && executor->task_callback != NULL) {
+            executor->task_callback(executor, progress);
+        }
+    } else if (executor->rds_callback != NULL && fm_is_powered_up(radio)) {
+        uint16_t blocks[4];
+        if (fm_read_rds_group(radio, blocks)) {
+            executor->rds_callback(executor, blocks, fm_get_rds_block_errors(radio));
+        }
+    }
+    fm_executor_schedule_timeout(executor);
+}
+
+static void fm_executor_timeout_work(async_context_t *context, async_at_time_worker_t *worker) {
+    (void)context;
+    fm_executor_run(worker->user_data);
+}
+
+static void fm_executor_interrupt_work(async_context_t *context, async_when_pending_worker_t *worker) {
+    (void)context;
+    fm_executor_run(worker->user_data);
+}
+
+static void fm_executor_interrupt_callback(rda5807_t *radio, void *user_data) {
+    // interrupt context, defer to the pending worker
+    (void)radio;
+    fm_executor_t *executor = user_data;
+    async_context_set_work_pending(executor->context, &executor->interrupt_worker);
+}
+
+//
+// public interface
+//
+
+void fm_executor_init(fm_executor_t *executor, rda5807_t *radio, async_context_t *context, void *user_data) {
+    memset(executor, 0, sizeof(fm_executor_t));
+    executor->radio = radio;
+    executor->context = context;
+    executor->user_data = user_data;
+    executor->timeout_worker.do_work = fm_executor_timeout_work;
+    executor->timeout_worker.user_data = executor;
+    executor->interrupt_worker.do_work = fm_executor_interrupt_work;
+    executor->interrupt_worker.user_data = executor;
+
+    async_context_add_when_pending_worker(context, &executor->interrupt_worker);
+    fm_set_interrupt_callback(radio, fm_executor_interrupt_callback, executor);
+}
+
+void fm_executor_deinit(fm_executor_t *executor) {
+    fm_set_interrupt_callback(executor->radio, NULL, NULL);
+    async_context_remove_at_time_worker(executor->context, &executor->timeout_worker);
+    async_context_remove_when_pending_worker(executor->context, &executor->interrupt_worker);
+}
+
+void fm_executor_set_task_callback(fm_executor_t *executor, fm_executor_task_callback_t task_callback) {
+    executor->task_callback = task_callback;
+}
+
+void fm_executor_set_rds_callback(fm_executor_t *executor, fm_executor_rds_callback_t rds_callback, uint32_t poll_interval_ms) {
+    executor->rds_callback = rds_callback;
+    executor->rds_poll_interval_us = poll_interval_ms * 1000;
+}
+
+void fm_executor_set_rds_poll_controller(fm_executor_t *executor, rds_poll_controller_t *controller, const rds_parser_t *parser) {
+    assert(controller == NULL || parser != NULL);
+
+    executor->rds_poll_controller = controller;
+    executor->rds_parser = parser;
+    executor->rds_frequency_khz = 0;
+}
+
+void fm_executor_schedule(fm_executor_t *executor) {
+    async_context_acquire_lock_blocking(executor->context);
+    fm_executor_schedule_timeout(executor);
+    async_context_release_lock(executor->context);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _FM_EXECUTOR_H_
+#define _FM_EXECUTOR_H_
+
+#include <fm_rda5807.h>
+#include <rds_poll_controller.h>
+#include <pico/async_context.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file fm_executor.h
+ *
+ * \brief Event driven execution of RDA5807 async tasks on a Pico SDK async_context.
+ *
+ * Instead of calling fm_async_task_tick() periodically, start a task with fm_xxx_async() and
+ * hand it to fm_executor_schedule(). The executor runs the task at exactly its resume time,
+ * or as soon as the chip raises an interrupt, and reports completion through a callback.
+ * RDS groups can be delivered the same way. Between events the core is free to sleep, e.g.
+ * in async_context_wait_for_work_until().
+ *
+ * Callbacks run from async_context workers, with the context lock held. With a background
+ * context (async_context_threadsafe_background) any other use of the radio must happen under
+ * async_context_acquire_lock_blocking().
+ */
+
+struct fm_executor_t;
+
+/**
+ * \brief Called when an async task completes.
+ */
+typedef void (*fm_executor_task_callback_t)(struct fm_executor_t *executor, fm_async_progress_t progress);
+
+/**
+ * \brief Called for each RDS group read.
+ *
+ * The block error levels are in the format of fm_get_rds_block_errors().
+ */
+typedef void (*fm_executor_rds_callback_t)(struct fm_executor_t *executor, const uint16_t *blocks, uint8_t block_errors);
+
+/**
+ * \brief Radio executor.
+ */
+typedef struct fm_executor_t
+{
+    rda5807_t *radio;
+    async_context_t *context;
+    async_at_time_worker_t timeout_worker;
+    async_when_pending_worker_t interrupt_worker;
+    fm_executor_task_callback_t task_callback;
+    fm_executor_rds_callback_t rds_callback;
+    uint32_t rds_poll_interval_us;
+    rds_poll_controller_t *rds_poll_controller;
+    const rds_parser_t *rds_parser;
+    uint32_t rds_frequency_khz; // frequency seen by the poll controller
+    void *user_data;
+} fm_executor_t;
+
+/**
+ * \brief Attach an executor to a radio.
+ *
+ * If the radio has interrupts enabled, its interrupt callback is taken over by the executor.
+ *
+ * @param executor Executor handle.
+ * @param radio Radio handle.
+ * @param context Async context running the executor workers.
+ * @param user_data Available to callbacks as executor->user_data.
+ */
+void fm_executor_init(fm_executor_t *executor, rda5807_t *radio, async_context_t *context, void *user_data);
+
+/**
+ * \brief Detach the executor from its radio and async context.
+ *
+ * A running async task is left to the caller.
+ *
+ * @param executor Executor handle.
+ */
+void fm_executor_deinit(fm_executor_t *executor);
+
+/**
+ * \brief Set the callback for async task completion.
+ *
+ * @param executor Executor handle.
+ * @param task_callback Callback, or NULL to ignore completion.
+ */
+void fm_executor_set_task_callback(fm_executor_t *executor, fm_executor_task_callback_t task_callback);
+
+/**
+ * \brief Enable RDS delivery while no async task is running.
+ *
+ * With interrupts enabled groups are read when the chip signals them, otherwise RDS is polled.
+ *
+ * @param executor Executor handle.
+ * @param rds_callback Callback receiving RDS groups, or NULL to disable RDS.
+ * @param poll_interval_ms Time between RDS polls (below 87ms to not miss groups).
+ */
+void fm_executor_set_rds_callback(fm_executor_t *executor, fm_executor_rds_callback_t rds_callback, uint32_t poll_interval_ms);
+
+/**
+ * \brief Adapt the RDS poll interval to signal and decode state.
+ *
+ * Replaces the fixed poll interval of fm_executor_set_rds_callback(). Fast polling restarts
+ * whenever the executor sees the radio on a new frequency. Has no effect with interrupts
+ * enabled, since RDS is then read as it arrives.
+ *
+ * @param executor Executor handle.
+ * @param controller Initialized controller, or NULL to restore the fixed interval.
+ * @param parser RDS parser fed by the RDS callback.
+ */
+void fm_executor_set_rds_poll_controller(fm_executor_t *executor, rds_poll_controller_t *controller, const rds_parser_t *parser);
+
+/**
+ * \brief Schedule the executor after the radio state changed.
+ *
+ * Must be called after starting an async task, and after power up to resume RDS delivery.
+ * Should also be called after blocking tune / seek, so an RDS poll controller can speed up.
+ *
+ * @param executor Executor handle.
+ */
+void fm_executor_schedule(fm_executor_t *executor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FM_EXECUTOR_H_
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_manager.h>
+#include <pico/stdlib.h>
+#include <string.h>
+
+//
+// scheduling
+//
+
+static bool fm_manager_is_rds_due(fm_manager_t *manager, fm_manager_slot_t *slot, uint64_t now) {
+    rda5807_t *radio = slot->radio;
+    if (manager->rds_callback == NULL || !fm_is_powered_up(radio)) {
+        return false;
+    }
+    if (radio->interrupt_enabled) {
+        return fm_is_interrupt_pending(radio);
+    }
+    return slot->next_rds_time <= now;
+}
+
+static bool fm_manager_service(fm_manager_t *manager, size_t radio_index, uint64_t now) {
+    // returns false if the radio wasn't due
+    fm_manager_slot_t *slot = &manager->slots[radio_index];
+    rda5807_t *radio = slot->radio;
+    if (fm_async_task_is_running(radio)) {
+        if (!fm_async_task_is_due(radio)) {
+            return false;
+        }
+        fm_async_progress_t progress = fm_async_task_tick(radio);
+        if (progress.done) {
+            slot->next_rds_time = now; // new station, read RDS right away
+            if (manager->task_callback != NULL) {
+                manager->task_callback(manager, radio_index, progress);
+            }
+        }
+        return true;
+    }
+    if (!fm_manager_is_rds_due(manager, slot, now)) {
+        return false;
+    }
+    slot->next_rds_time = now + manager->rds_poll_interval_us;
+    uint16_t blocks[4];
+    if (fm_read_rds_group(radio, blocks)) {
+        manager->rds_callback(manager, radio_index, blocks, fm_get_rds_block_errors(radio));
+    }
+    return true;
+}
+
+static bool fm_manager_is_first_on_bus(fm_manager_t *manager, size_t radio_index) {
+    i2c_inst_t *i2c_inst = manager->slots[radio_index].radio->i2c_inst;
+    for (size_t i = 0; i < radio_index; i++) {
+        if (manager->slots[i].radio->i2c_inst == i2c_inst) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// public interface
+//
+
+void fm_manager_init(fm_manager_t *manager, void *user_data) {
+    memset(manager, 0, sizeof(fm_manager_t));
+    manager->user_data = user_data;
+}
+
+size_t fm_manager_add_radio(fm_manager_t *manager, rda5807_t *radio) {
+    assert(manager->radio_count < FM_MANAGER_MAX_RADIOS);
+
+    size_t radio_index = manager->radio_count++;
+    manager->slots[radio_index] = (fm_manager_slot_t){radio, 0};
+    manager->bus_cursors[radio_index] = radio_index;
+    return radio_index;
+}
+
+void fm_manager_set_task_callback(fm_manager_t *manager, fm_manager_task_callback_t task_callback) {
+    manager->task_callback = task_callback;
+}
+
+void fm_manager_set_rds_callback(fm_manager_t *manager, fm_manager_rds_callback_t rds_callback, uint32_t poll_interval_ms) {
+    manager->rds_callback = rds_callback;
+    manager->rds_poll_interval_us = poll_interval_ms * 1000;
+}
+
+void fm_manager_tick(fm_manager_t *manager) {
+    size_t radio_count = manager->radio_count;
+    uint64_t now = time_us_64();
+    for (size_t bus_index = 0; bus_index < radio_count; bus_index++) {
+        if (!fm_manager_is_first_on_bus(manager, bus_index)) {
+            continue;
+        }
+        // service the first due radio on this bus, starting after the one serviced last
+        i2c_inst_t *i2c_inst = manager->slots[bus_index].radio->i2c_inst;
+        size_t cursor = manager->bus_cursors[bus_index];
+        for (size_t i = 0; i < radio_count; i++) {
+            size_t radio_index = (cursor + i) % radio_count;
+            if (manager->slots[radio_index].radio->i2c_inst != i2c_inst) {
+                continue;
+            }
+            if (fm_manager_service(manager, radio_index, now)) {
+                manager->bus_cursors[bus_index] = (radio_index + 1) % radio_count;
+                break;
+            }
+        }
+    }
+}
+
+uint64_t fm_manager_get_next_time(fm_manager_t *manager) {
+    uint64_t next_time = UINT64_MAX;
+    for (size_t i = 0; i < manager->radio_count; i++) {
+        fm_manager_slot_t *slot = &manager->slots[i];
+        rda5807_t *radio = slot->radio;
+        uint64_t time = UINT64_MAX;
+        if (fm_async_task_is_running(radio)) {
+            time = fm_async_task_get_resume_time(radio);
+            if (radio->interrupt_enabled && fm_is_interrupt_pending(radio)) {
+                time = 0;
+            }
+        } else if (manager->rds_callback != NULL && fm_is_powered_up(radio)) {
+            if (!radio->interrupt_enabled) {
+                time = slot->next_rds_time;
+            } else if (fm_is_interrupt_pending(radio)) {
+                time = 0;
+            }
+        }
+        next_time = MIN(next_time, time);
+    }
+    return next_time;
+}
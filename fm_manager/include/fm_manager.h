@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _FM_MANAGER_H_
+#define _FM_MANAGER_H_
+
+#include <fm_rda5807.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file fm_manager.h
+ *
+ * \brief Scheduler for several RDA5807 tuners.
+ *
+ * The manager owns a set of powered up radios, on one or more I2C buses. Async tasks are
+ * started on the radios as usual (e.g. fm_seek_async()), then a single fm_manager_tick()
+ * drives all of them and polls RDS in between. Each tick does I2C work for at most one
+ * radio per bus, picked round-robin among the radios that are due, so a slow seek on one
+ * tuner doesn't delay RDS reads on the others.
+ *
+ * Radios sharing a bus must not have DMA enabled (see fm_enable_dma()), otherwise a
+ * background write may still be in flight when the next radio is serviced.
+ */
+
+#ifndef FM_MANAGER_MAX_RADIOS
+#define FM_MANAGER_MAX_RADIOS 4
+#endif
+
+struct fm_manager_t;
+
+/**
+ * \brief Called when an async task completes.
+ */
+typedef void (*fm_manager_task_callback_t)(struct fm_manager_t *manager, size_t radio_index, fm_async_progress_t progress);
+
+/**
+ * \brief Called for each RDS group read.
+ *
+ * The block error levels are in the format of fm_get_rds_block_errors().
+ */
+typedef void (*fm_manager_rds_callback_t)(struct fm_manager_t *manager, size_t radio_index, const uint16_t *blocks, uint8_t block_errors);
+
+// private
+typedef struct fm_manager_slot_t
+{
+    rda5807_t *radio;
+    uint64_t next_rds_time;
+} fm_manager_slot_t;
+
+/**
+ * \brief Multi-tuner scheduler.
+ */
+typedef struct fm_manager_t
+{
+    fm_manager_slot_t slots[FM_MANAGER_MAX_RADIOS];
+    size_t radio_count;
+    size_t bus_cursors[FM_MANAGER_MAX_RADIOS]; // next slot to service, indexed by first slot on each bus
+    fm_manager_task_callback_t task_callback;
+    fm_manager_rds_callback_t rds_callback;
+    uint32_t rds_poll_interval_us;
+    void *user_data;
+} fm_manager_t;
+
+/**
+ * \brief Initialize the manager, with no radios.
+ *
+ * @param manager Manager handle.
+ * @param user_data Available to callbacks as manager->user_data.
+ */
+void fm_manager_init(fm_manager_t *manager, void *user_data);
+
+/**
+ * \brief Add a radio to the manager.
+ *
+ * The radio is only referenced, it should be initialized and configured as usual. Radios
+ * on the same bus are detected by their I2C instance.
+ *
+ * @param manager Manager handle.
+ * @param radio Radio handle.
+ * @return Radio index, passed to callbacks.
+ */
+size_t fm_manager_add_radio(fm_manager_t *manager, rda5807_t *radio);
+
+/**
+ * \brief Get a managed radio.
+ *
+ * @param manager Manager handle.
+ * @param radio_index Radio index.
+ */
+static inline rda5807_t *fm_manager_get_radio(fm_manager_t *manager, size_t radio_index) {
+    return manager->slots[radio_index].radio;
+}
+
+/**
+ * \brief Set the callback for async task completion.
+ *
+ * @param manager Manager handle.
+ * @param task_callback Callback, or NULL to ignore completion.
+ */
+void fm_manager_set_task_callback(fm_manager_t *manager, fm_manager_task_callback_t task_callback);
+
+/**
+ * \brief Enable RDS polling on radios without a running async task.
+ *
+ * On radios with interrupts enabled, RDS is only read when an interrupt is pending.
+ *
+ * @param manager Manager handle.
+ * @param rds_callback Callback receiving RDS groups, or NULL to disable RDS polling.
+ * @param poll_interval_ms Minimum time between RDS reads on each radio (below 87ms to not miss groups).
+ */
+void fm_manager_set_rds_callback(fm_manager_t *manager, fm_manager_rds_callback_t rds_callback, uint32_t poll_interval_ms);
+
+/**
+ * \brief Update all managed radios.
+ *
+ * Services at most one due radio per I2C bus. Should be called at least as often as the RDS
+ * poll interval divided by the number of radios on the busiest bus.
+ *
+ * @param manager Manager handle.
+ */
+void fm_manager_tick(fm_manager_t *manager);
+
+/**
+ * \brief Get the earliest time a radio needs servicing.
+ *
+ * Useful for sleeping between ticks. May be earlier on radios with interrupts enabled.
+ *
+ * @param manager Manager handle.
+ * @return Absolute time in µs since boot, UINT64_MAX if nothing is scheduled.
+ */
+uint64_t fm_manager_get_next_time(fm_manager_t *manager);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FM_MANAGER_H_
@@ -6,168 +6,671 @@
 
 #include "fm_rda5807_regs.h"
 #include <fm_rda5807.h>
+#include <hardware/dma.h>
 #include <hardware/i2c.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
 #include <pico/stdlib.h>
 #include <math.h>
 #include <string.h>
 
 static const uint TUNE_POLL_INTERVAL_MS = 5;
-static const uint SEEK_POLL_INTERVAL_MS = 200; // relatively large, to reduce electrical interference from I2C
+static const uint TUNE_INTERRUPT_TIMEOUT_MS = 50; // fallback poll, in case an interrupt was missed
+static const uint POWER_UP_POLL_INTERVAL_MS = 2;
+static const uint POWER_UP_TIMEOUT_MS = 1000;
+static const uint RESYNC_RETUNE_DELAY_MS = 10; // chip start-up before retuning, as in fm_power_up()
+#if FM_RDA5807_SEEK_ENABLE
+static const uint SEEK_INTERRUPT_TIMEOUT_MS = 1000; // fallback poll, also limits progress updates
+#endif
+#if FM_RDA5807_SCAN_ENABLE
+static const uint SCAN_SEEK_POLL_INTERVAL_MS = 10;
+static const uint SCAN_SEEK_INTERRUPT_TIMEOUT_MS = 1000; // fallback poll, also limits progress updates
+#endif
+#if FM_RDA5807_AF_ENABLE || FM_RDA5807_TRACKER_ENABLE
+static const uint AF_PI_POLL_INTERVAL_MS = 10;
+#endif
+
+#define fm_set_bit(reg, bit, value) \
+    if (value) {                    \
+        reg |= bit##_BIT;           \
+    } else {                        \
+        reg &= ~bit##_BIT;          \
+    }
+
+#define fm_get_bit(reg, bit) \
+    (((reg)&bit##_BIT) != 0)
+
+#define fm_set_bits(reg, bits, value) \
+    reg &= ~bits##_BITS;              \
+    reg |= (value) << bits##_LSB;
+
+#define fm_get_bits(reg, bits) \
+    (((reg)&bits##_BITS) >> bits##_LSB)
 
 //
 // misc
 //
 
-static fm_frequency_range_t fm_frequency_range(fm_band_t band, fm_channel_spacing_t channel_spacing) {
-    fm_frequency_range_t range;
+static fm_frequency_range_khz_t fm_frequency_range_khz(fm_band_t band, fm_channel_spacing_t channel_spacing) {
+    fm_frequency_range_khz_t range;
     switch (band) {
     case FM_BAND_COMMON:
-        range.bottom = 87.0f;
-        range.top = 108.0f;
+        range.bottom = 87000;
+        range.top = 108000;
         break;
     case FM_BAND_JAPAN:
-        range.bottom = 76.0f;
-        range.top = 91.0f;
+        range.bottom = 76000;
+        range.top = 91000;
         break;
     case FM_BAND_JAPAN_WIDE:
-        range.bottom = 76.0f;
-        range.top = 108.0f;
+        range.bottom = 76000;
+        range.top = 108000;
         break;
     case FM_BAND_EAST_EUROPE:
-        range.bottom = 50.0f;
-        range.top = 76.0f;
+        range.bottom = 50000;
+        range.top = 76000;
         break;
     default: // FM_BAND_EAST_EUROPE_UPPER
-        range.bottom = 65.0f;
-        range.top = 76.0f;
+        range.bottom = 65000;
+        range.top = 76000;
         break;
     }
     switch (channel_spacing) {
     case FM_CHANNEL_SPACING_200:
-        range.spacing = 0.2f;
+        range.spacing = 200;
         break;
     case FM_CHANNEL_SPACING_100:
-        range.spacing = 0.1f;
+        range.spacing = 100;
+        break;
+    case FM_CHANNEL_SPACING_50:
+        range.spacing = 50;
         break;
-    default: // FM_CHANNEL_SPACING_50
-        range.spacing = 0.05f;
+    default: // FM_CHANNEL_SPACING_25
+        range.spacing = 25;
         break;
     }
     return range;
 }
 
-static float fm_channel_to_frequency(uint16_t channel, fm_frequency_range_t range) {
-    return channel * range.spacing + range.bottom;
+static uint32_t fm_channel_to_frequency_khz(uint16_t channel, fm_frequency_range_khz_t range) {
+    return range.bottom + channel * range.spacing;
+}
+
+static uint16_t fm_frequency_khz_to_channel(uint32_t frequency_khz, fm_frequency_range_khz_t range) {
+    frequency_khz = MAX(frequency_khz, range.bottom);
+    frequency_khz = MIN(frequency_khz, range.top);
+    return (uint16_t)((frequency_khz - range.bottom + range.spacing / 2) / range.spacing);
+}
+
+static uint32_t fm_mhz_to_khz(float frequency) {
+    // only for the MHz interface, everything else is integer
+    if (frequency <= 0.0f) {
+        return 0;
+    }
+    return (uint32_t)lroundf(frequency * 1000.0f);
 }
 
-static uint16_t fm_frequency_to_channel(float frequency, fm_frequency_range_t range) {
-    return (uint16_t)roundf((frequency - range.bottom) / range.spacing);
+static float fm_khz_to_mhz(uint32_t frequency_khz) {
+    return frequency_khz / 1000.0f;
 }
 
 //
-// register access
+// stats
 //
 
-static bool fm_read_registers(i2c_inst_t *i2c_inst, uint16_t *regs, size_t n) {
-    assert(n <= 6); // registers 0xA..0xF
+static void fm_stats_transfer(rda5807_t *radio, size_t write_size, size_t read_size) {
+#if FM_RDA5807_STATS_ENABLE
+    fm_stats_t *stats = &radio->stats;
+    stats->i2c_transactions++;
+    stats->i2c_bytes_written += write_size;
+    stats->i2c_bytes_read += read_size;
+#else
+    (void)radio;
+    (void)write_size;
+    (void)read_size;
+#endif
+}
 
-    uint8_t buf[12];
-    size_t data_size = n * sizeof(uint16_t);
-    int result = i2c_read_blocking(i2c_inst, RDA5807_ADDR_SEQUENTIAL, buf, data_size, false);
-    if (result != (int)data_size) {
-        return false; // failed
+static void fm_stats_transfer_error(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.i2c_errors++;
+#else
+    (void)radio;
+#endif
+}
+
+static void fm_stats_i2c_retry(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.i2c_retries++;
+#else
+    (void)radio;
+#endif
+}
+
+static void fm_stats_i2c_timeout(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.i2c_timeouts++;
+#else
+    (void)radio;
+#endif
+}
+
+static void fm_stats_bus_recovery(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.i2c_bus_recoveries++;
+#else
+    (void)radio;
+#endif
+}
+
+static void fm_stats_resync(rda5807_t *radio, bool repaired) {
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.resyncs++;
+    radio->stats.resync_repairs += repaired;
+#else
+    (void)radio;
+    (void)repaired;
+#endif
+}
+
+static void fm_stats_begin_operation(rda5807_t *radio) {
+    // tune or seek started, RDS intervals restart on the new station
+#if FM_RDA5807_STATS_ENABLE
+    radio->stats.operation_start_time = time_us_64();
+    radio->stats.last_rds_group_time = 0;
+#else
+    (void)radio;
+#endif
+}
+
+static void fm_stats_end_tune(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    fm_histogram_add(&radio->stats.tune, time_us_64() - radio->stats.operation_start_time);
+#else
+    (void)radio;
+#endif
+}
+
+#if FM_RDA5807_SEEK_ENABLE
+static void fm_stats_end_seek(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    fm_histogram_add(&radio->stats.seek, time_us_64() - radio->stats.operation_start_time);
+#else
+    (void)radio;
+#endif
+}
+#endif
+
+static void fm_stats_rds_group(rda5807_t *radio) {
+#if FM_RDA5807_STATS_ENABLE
+    fm_stats_t *stats = &radio->stats;
+    uint64_t now = time_us_64();
+    if (stats->last_rds_group_time != 0) {
+        fm_histogram_add(&stats->rds_group_interval, now - stats->last_rds_group_time);
+    }
+    stats->last_rds_group_time = now;
+    stats->rds_groups++;
+#else
+    (void)radio;
+#endif
+}
+
+//
+// signal quality
+//
+
+static void fm_quality_reset(rda5807_t *radio) {
+    // samples from the previous channel no longer apply
+    radio->quality = (fm_quality_t){};
+}
+
+static void fm_quality_sample(rda5807_t *radio) {
+    // registers 0xA and 0xB were just read
+    uint16_t *regs = radio->regs;
+    fm_quality_t *quality = &radio->quality;
+    uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
+    if (quality->history_count != 0 && quality->channel != channel) {
+        fm_quality_reset(radio);
     }
-    uint16_t *p = regs + 0xA;
+    uint8_t rssi = (uint8_t)fm_get_bits(regs[0xB], RSSI);
+    quality->sample_time = time_us_64();
+    quality->channel = channel;
+    quality->rssi = rssi;
+    quality->stereo = fm_get_bit(regs[0xA], ST);
+    quality->fm_true = fm_get_bit(regs[0xB], FM_TRUE);
+    quality->fm_ready = fm_get_bit(regs[0xB], FM_READY);
+
+    // exponential moving average, weight 1/4
+    if (quality->history_count == 0) {
+        quality->rssi_smoothed_fp = rssi << 8;
+    } else {
+        quality->rssi_smoothed_fp += ((int32_t)(rssi << 8) - quality->rssi_smoothed_fp) / 4;
+    }
+    quality->rssi_smoothed = (quality->rssi_smoothed_fp + 0x80) >> 8;
+
+    quality->rssi_history[quality->history_head] = rssi;
+    quality->history_head = (quality->history_head + 1) % FM_QUALITY_HISTORY_SIZE;
+    if (quality->history_count < FM_QUALITY_HISTORY_SIZE) {
+        quality->history_count++;
+    }
+}
+
+//
+// transport
+//
+
+static void fm_decode_registers(uint16_t *regs, const uint8_t *buf, size_t data_size) {
+    uint16_t *p = regs;
     for (size_t i = 0; i < data_size;) {
         uint16_t reg = buf[i++] << 8; // hi
         reg |= buf[i++]; // lo
         *p++ = reg;
     }
+}
+
+static void fm_decode_read_registers(rda5807_t *radio, const uint8_t *buf, size_t data_size) {
+    // sequential reads start at 0xA, any read covering 0xB refreshes signal quality
+    fm_decode_registers(radio->regs + 0xA, buf, data_size);
+    if (2 * sizeof(uint16_t) <= data_size) {
+        fm_quality_sample(radio);
+    }
+}
+
+static uint32_t fm_i2c_timeout_us(size_t size) {
+    // one more byte for the address
+    return (size + 1) * FM_I2C_BYTE_TIMEOUT_US;
+}
+
+static fm_async_progress_t fm_power_up_async_task(rda5807_t *radio, bool cancel);
+
+static bool fm_is_probing(rda5807_t *radio) {
+    // fm_power_up_async() retries the first write until the chip is on the bus
+    return radio->async.task == &fm_power_up_async_task && radio->async.state == 1;
+}
+
+static uint fm_i2c_retries(rda5807_t *radio) {
+    return fm_is_probing(radio) ? 0 : FM_I2C_RETRIES;
+}
+
+static void fm_set_i2c_failed(rda5807_t *radio) {
+    // out of retries, cancels the running task, or the task being started (callers skip setting writes)
+    if (!fm_is_probing(radio)) {
+        radio->async.i2c_failed = true;
+    }
+}
+
+static void fm_recover_bus(rda5807_t *radio) {
+    // a chip interrupted mid-byte may hold SDA low, clock out the byte then send a STOP
+    uint sdio_pin = radio->sdio_pin;
+    uint sclk_pin = radio->sclk_pin;
+    i2c_hw_t *hw = i2c_get_hw(radio->i2c_inst);
+    hw->enable = 0; // flushes FIFOs
+    // emulate open drain: low as output, released as input
+    gpio_put(sdio_pin, false);
+    gpio_put(sclk_pin, false);
+    gpio_set_dir(sdio_pin, GPIO_IN);
+    gpio_set_dir(sclk_pin, GPIO_IN);
+    gpio_set_function(sdio_pin, GPIO_FUNC_SIO);
+    gpio_set_function(sclk_pin, GPIO_FUNC_SIO);
+    for (int i = 0; i < 9 && !gpio_get(sdio_pin); i++) {
+        gpio_set_dir(sclk_pin, GPIO_OUT);
+        busy_wait_us(5);
+        gpio_set_dir(sclk_pin, GPIO_IN);
+        busy_wait_us(5);
+    }
+    // START then STOP, SDA toggles while SCL is high
+    gpio_set_dir(sdio_pin, GPIO_OUT);
+    busy_wait_us(5);
+    gpio_set_dir(sdio_pin, GPIO_IN);
+    busy_wait_us(5);
+    gpio_set_function(sdio_pin, GPIO_FUNC_I2C);
+    gpio_set_function(sclk_pin, GPIO_FUNC_I2C);
+    hw->enable = 1;
+    fm_stats_bus_recovery(radio);
+}
+
+static void fm_dma_launch(rda5807_t *radio) {
+    // (re)start the queued transfer from cmd_buf
+    fm_transport_t *transport = &radio->transport;
+    i2c_inst_t *i2c_inst = radio->i2c_inst;
+    i2c_hw_t *hw = i2c_get_hw(i2c_inst);
+    hw->enable = 0;
+    hw->tar = transport->addr;
+    hw->enable = 1;
+    (void)hw->clr_tx_abrt;
+    (void)hw->clr_stop_det;
+
+    size_t dst_size = transport->rx_size;
+    fm_stats_transfer(radio, transport->cmd_count - dst_size, dst_size);
+    transport->status = FM_TRANSFER_BUSY;
+    transport->timeout_time = time_us_64() + fm_i2c_timeout_us(transport->cmd_count);
+    if (dst_size != 0) {
+        dma_channel_config config = dma_channel_get_default_config(transport->rx_dma_channel);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+        channel_config_set_read_increment(&config, false);
+        channel_config_set_write_increment(&config, true);
+        channel_config_set_dreq(&config, i2c_get_dreq(i2c_inst, false /* is_tx */));
+        dma_channel_configure(transport->rx_dma_channel, &config, transport->rx_buf, &hw->data_cmd, dst_size, true);
+    }
+    dma_channel_config config = dma_channel_get_default_config(transport->tx_dma_channel);
+    channel_config_set_transfer_data_size(&config, DMA_SIZE_32);
+    channel_config_set_read_increment(&config, true);
+    channel_config_set_write_increment(&config, false);
+    channel_config_set_dreq(&config, i2c_get_dreq(i2c_inst, true /* is_tx */));
+    dma_channel_configure(transport->tx_dma_channel, &config, &hw->data_cmd, transport->cmd_buf, transport->cmd_count, true);
+}
+
+static void fm_dma_start(rda5807_t *radio, uint8_t addr, const uint8_t *src, size_t src_size, size_t dst_size) {
+    fm_transport_t *transport = &radio->transport;
+    assert(transport->status != FM_TRANSFER_BUSY);
+    assert(0 < src_size + dst_size && src_size + dst_size <= count_of(transport->cmd_buf));
+    assert(dst_size <= sizeof(transport->rx_buf));
+
+    // each byte is a command, reads after writes need a restart, last command ends with stop
+    size_t n = 0;
+    for (size_t i = 0; i < src_size; i++) {
+        transport->cmd_buf[n++] = src[i];
+    }
+    for (size_t i = 0; i < dst_size; i++) {
+        uint32_t cmd = I2C_IC_DATA_CMD_CMD_BITS;
+        if (i == 0 && src_size != 0) {
+            cmd |= I2C_IC_DATA_CMD_RESTART_BITS;
+        }
+        transport->cmd_buf[n++] = cmd;
+    }
+    transport->cmd_buf[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+    transport->addr = addr;
+    transport->cmd_count = n;
+    transport->rx_size = dst_size;
+    transport->attempts = 0;
+    transport->retry_regs = 0;
+    fm_dma_launch(radio);
+}
+
+static fm_transfer_status_t fm_dma_poll(rda5807_t *radio) {
+    fm_transport_t *transport = &radio->transport;
+    if (transport->status != FM_TRANSFER_BUSY) {
+        return transport->status;
+    }
+    i2c_hw_t *hw = i2c_get_hw(radio->i2c_inst);
+    uint32_t raw_intr_stat = hw->raw_intr_stat;
+    if (raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+        // NAK or arbitration lost, FIFO has been flushed
+        dma_channel_abort(transport->tx_dma_channel);
+        dma_channel_abort(transport->rx_dma_channel);
+        (void)hw->clr_tx_abrt;
+        fm_stats_transfer_error(radio);
+    } else if ((raw_intr_stat & I2C_IC_RAW_INTR_STAT_STOP_DET_BITS)
+        && (transport->rx_size == 0 || !dma_channel_is_busy(transport->rx_dma_channel))) {
+        transport->status = FM_TRANSFER_DONE;
+        return transport->status;
+    } else if (time_us_64() >= transport->timeout_time) {
+        // bus stuck
+        dma_channel_abort(transport->tx_dma_channel);
+        dma_channel_abort(transport->rx_dma_channel);
+        fm_stats_transfer_error(radio);
+        fm_stats_i2c_timeout(radio);
+        fm_recover_bus(radio);
+    } else {
+        return transport->status;
+    }
+    if (transport->attempts < fm_i2c_retries(radio)) {
+        transport->attempts++;
+        fm_stats_i2c_retry(radio);
+        fm_dma_launch(radio);
+    } else {
+        transport->status = FM_TRANSFER_FAILED;
+        if (transport->retry_regs != 0) {
+            // setting write, retried by the next commit without cancelling the running task
+            radio->dirty_regs |= transport->retry_regs;
+            transport->retry_regs = 0;
+        } else {
+            fm_set_i2c_failed(radio);
+        }
+    }
+    return transport->status;
+}
+
+static fm_transfer_status_t fm_dma_wait(rda5807_t *radio) {
+    fm_transfer_status_t status;
+    while ((status = fm_dma_poll(radio)) == FM_TRANSFER_BUSY) {
+        tight_loop_contents();
+    }
+    return status;
+}
+
+static void fm_dma_complete(rda5807_t *radio) {
+    // finish queued transfer, keeping any received registers
+    fm_transport_t *transport = &radio->transport;
+    if (fm_dma_wait(radio) == FM_TRANSFER_DONE && transport->rx_size != 0) {
+        fm_decode_read_registers(radio, transport->rx_buf, transport->rx_size);
+    }
+    transport->rx_size = 0;
+}
+
+static int fm_try_transfer(rda5807_t *radio, uint8_t addr, const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+    // single attempt, PICO_ERROR_TIMEOUT if the bus got stuck
+    i2c_inst_t *i2c_inst = radio->i2c_inst;
+    if (src_size != 0) {
+        int result = i2c_write_timeout_us(i2c_inst, addr, src, src_size, dst_size != 0 /* nostop */, fm_i2c_timeout_us(src_size));
+        if (result != (int)src_size) {
+            return result < 0 ? result : PICO_ERROR_GENERIC;
+        }
+    }
+    if (dst_size != 0) {
+        int result = i2c_read_timeout_us(i2c_inst, addr, dst, dst_size, false, fm_i2c_timeout_us(dst_size));
+        if (result != (int)dst_size) {
+            return result < 0 ? result : PICO_ERROR_GENERIC;
+        }
+    }
+    return PICO_OK;
+}
+
+static bool fm_transfer(rda5807_t *radio, uint8_t addr, const uint8_t *src, size_t src_size, uint8_t *dst, size_t dst_size) {
+    // write src, then read into dst with a repeated start
+    if (!radio->transport.dma_enabled) {
+        for (uint attempt = 0;; attempt++) {
+            fm_stats_transfer(radio, src_size, dst_size);
+            int result = fm_try_transfer(radio, addr, src, src_size, dst, dst_size);
+            if (result == PICO_OK) {
+                return true;
+            }
+            fm_stats_transfer_error(radio);
+            if (result == PICO_ERROR_TIMEOUT) {
+                fm_stats_i2c_timeout(radio);
+                fm_recover_bus(radio);
+            }
+            if (attempt == fm_i2c_retries(radio)) {
+                break;
+            }
+            fm_stats_i2c_retry(radio);
+        }
+        if (!radio->transport.setting_write) {
+            fm_set_i2c_failed(radio); // failed setting writes only stay dirty
+        }
+        return false;
+    }
+
+    fm_dma_complete(radio);
+    fm_dma_start(radio, addr, src, src_size, dst_size);
+    if (dst_size == 0) {
+        return true; // writes complete in background
+    }
+    bool success = (fm_dma_wait(radio) == FM_TRANSFER_DONE);
+    if (success) {
+        memcpy(dst, radio->transport.rx_buf, dst_size);
+    }
+    radio->transport.rx_size = 0; // decoded by caller
+    return success;
+}
+
+//
+// register access
+//
+
+static bool fm_read_registers(rda5807_t *radio, size_t n) {
+    assert(n <= 6); // registers 0xA..0xF
+
+    uint8_t buf[12];
+    size_t data_size = n * sizeof(uint16_t);
+    if (!fm_transfer(radio, radio->i2c_addr_sequential, NULL, 0, buf, data_size)) {
+        return false; // failed
+    }
+    fm_decode_read_registers(radio, buf, data_size);
     return true;
 }
 
-static bool fm_read_registers_up_to(i2c_inst_t *i2c_inst, uint16_t *regs, uint8_t reg_index) {
+static bool fm_read_registers_up_to(rda5807_t *radio, uint8_t reg_index) {
     // read order: 0xA, 0xB, 0xC, 0xD, 0xE, 0xF
     assert(0xA <= reg_index && reg_index <= 0xF);
 
     size_t n = reg_index - 9;
-    return fm_read_registers(i2c_inst, regs, n);
+    return fm_read_registers(radio, n);
+}
+
+static bool fm_begin_read_registers_up_to(rda5807_t *radio, uint8_t reg_index) {
+    assert(0xA <= reg_index && reg_index <= 0xF);
+
+    fm_transport_t *transport = &radio->transport;
+    if (!transport->dma_enabled) {
+        // fall back to a blocking read
+        bool success = fm_read_registers_up_to(radio, reg_index);
+        transport->status = success ? FM_TRANSFER_DONE : FM_TRANSFER_FAILED;
+        transport->rx_size = 0;
+        return true;
+    }
+    if (fm_dma_poll(radio) == FM_TRANSFER_BUSY) {
+        return false;
+    }
+    fm_dma_complete(radio);
+    size_t data_size = (reg_index - 9) * sizeof(uint16_t);
+    fm_dma_start(radio, radio->i2c_addr_sequential, NULL, 0, data_size);
+    return true;
 }
 
-static bool fm_write_registers(i2c_inst_t *i2c_inst, uint16_t *regs, size_t n) {
+static bool fm_write_registers(rda5807_t *radio, size_t n) {
     assert(n <= 7); // registers 0x2..0x8
 
     uint8_t buf[14];
     size_t data_size = n * sizeof(uint16_t);
-    uint16_t *p = regs + 0x2;
+    radio->dirty_regs &= ~((1 << n) - 1);
+    uint16_t *p = radio->regs + 0x2;
     for (size_t i = 0; i < data_size;) {
         uint16_t reg = *p++;
         buf[i++] = reg >> 8; // hi
         buf[i++] = reg & 0xFF; // lo
     }
-    int result = i2c_write_blocking(i2c_inst, RDA5807_ADDR_SEQUENTIAL, buf, data_size, false);
-    return result == (int)data_size;
+    return fm_transfer(radio, radio->i2c_addr_sequential, buf, data_size, NULL, 0);
 }
 
-static bool fm_write_registers_up_to(i2c_inst_t *i2c_inst, uint16_t *regs, uint8_t reg_index) {
+static bool fm_write_registers_up_to(rda5807_t *radio, uint8_t reg_index) {
     // write order: 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8
     assert(0x2 <= reg_index && reg_index <= 0x8);
 
     size_t n = reg_index - 1;
-    return fm_write_registers(i2c_inst, regs, n);
+    return fm_write_registers(radio, n);
 }
 
-static bool fm_write_single_register(i2c_inst_t *i2c_inst, uint16_t *regs, size_t reg_index) {
+static bool fm_write_single_register(rda5807_t *radio, size_t reg_index) {
     assert(0x2 <= reg_index && reg_index <= 0x8);
 
     if (reg_index == 0x2) {
         // no need for reg_index
-        return fm_write_registers(i2c_inst, regs, 1);
+        return fm_write_registers(radio, 1);
     }
-    uint16_t reg = regs[reg_index];
+    radio->dirty_regs &= ~(1 << (reg_index - 0x2));
+    uint16_t reg = radio->regs[reg_index];
     uint8_t buf[3] = {reg_index, reg >> 8, reg & 0xFF};
-    int result = i2c_write_blocking(i2c_inst, RDA5807_ADDR_RANDOM_ACCESS, buf, sizeof(buf), false);
-    return result == sizeof(buf);
+    return fm_transfer(radio, radio->i2c_addr_random_access, buf, sizeof(buf), NULL, 0);
 }
 
-static bool fm_read_single_register(i2c_inst_t *i2c_inst, uint16_t *regs, size_t reg_index) {
+static bool fm_read_single_register(rda5807_t *radio, size_t reg_index) {
     assert(reg_index <= 0xF);
 
     if (reg_index == 0xA) {
         // no need for reg_index
-        return fm_read_registers(i2c_inst, regs, 1);
+        return fm_read_registers(radio, 1);
     }
-    uint8_t buf[2] = {reg_index};
-    int result = i2c_write_blocking(i2c_inst, RDA5807_ADDR_RANDOM_ACCESS, buf, 1, true /* nostop */);
-    if (result != 1) {
+    uint8_t addr_buf[1] = {reg_index};
+    uint8_t buf[2];
+    if (!fm_transfer(radio, radio->i2c_addr_random_access, addr_buf, 1, buf, 2)) {
         return false;
     }
-    buf[0] = 0;
-    result = i2c_read_blocking(i2c_inst, RDA5807_ADDR_RANDOM_ACCESS, buf, 2, false);
-    if (result != 2) {
+    fm_decode_registers(radio->regs + reg_index, buf, 2);
+    return true;
+}
+
+static bool fm_check_setting_write(rda5807_t *radio, bool success, uint8_t dirty_mask) {
+    // failed setting writes stay dirty, to be retried by the next commit
+    if (!success) {
+        radio->dirty_regs |= dirty_mask;
         return false;
     }
-    uint16_t reg = (buf[0] << 8) | buf[1];
-    regs[reg_index] = reg;
+    radio->transport.retry_regs = dirty_mask; // with DMA the write may still fail in the background
     return true;
 }
 
-#define fm_set_bit(reg, bit, value) \
-    if (value) {                    \
-        reg |= bit##_BIT;           \
-    } else {                        \
-        reg &= ~bit##_BIT;          \
-    }
+static bool fm_update_register(rda5807_t *radio, size_t reg_index) {
+    // write now, or defer until fm_commit_update()
+    assert(0x2 <= reg_index && reg_index <= 0x8);
 
-#define fm_get_bit(reg, bit) \
-    (((reg)&bit##_BIT) != 0)
+    if (radio->update_pending) {
+        radio->dirty_regs |= 1 << (reg_index - 0x2);
+        return true;
+    }
+    radio->transport.setting_write = true;
+    bool success = fm_write_single_register(radio, reg_index);
+    radio->transport.setting_write = false;
+    return fm_check_setting_write(radio, success, 1 << (reg_index - 0x2));
+}
 
-#define fm_set_bits(reg, bits, value) \
-    reg &= ~bits##_BITS;              \
-    reg |= (value) << bits##_LSB;
+static bool fm_write_dirty_registers(rda5807_t *radio) {
+    // Choose between a sequential write of 0x2..last (last = 0x1 for none) and random access
+    // writes for the dirty registers above it. Fewest transactions wins, then fewest bytes.
+    uint8_t dirty = radio->dirty_regs;
+    if (dirty == 0) {
+        return true;
+    }
+    uint8_t first_last = (dirty & 0x1) ? 0x2 : 0x1; // register 0x2 can only be written sequentially
+    // while seeking / tuning, rewriting SEEK in 0x2 or TUNE in 0x3 would restart the chip
+    assert(!(dirty & 0x1) || !fm_get_bit(radio->regs[0x2], SEEK)); // settings in 0x2 are deferred while seeking
+    uint8_t max_last = (radio->async.task != NULL) ? first_last : 0x8;
+    size_t best_transactions = SIZE_MAX;
+    size_t best_bytes = SIZE_MAX;
+    uint8_t best_last = 0x1;
+    for (uint8_t last = first_last; last <= max_last; last++) {
+        size_t transactions = (last == 0x1) ? 0 : 1;
+        size_t bytes = (last - 0x1) * 2;
+        for (uint8_t reg_index = last + 1; reg_index <= 0x8; reg_index++) {
+            if (dirty & (1 << (reg_index - 0x2))) {
+                transactions++;
+                bytes += 3;
+            }
+        }
+        if (transactions < best_transactions || (transactions == best_transactions && bytes < best_bytes)) {
+            best_transactions = transactions;
+            best_bytes = bytes;
+            best_last = last;
+        }
+    }
 
-#define fm_get_bits(reg, bits) \
-    (((reg)&bits##_BITS) >> bits##_LSB)
+    bool success = true;
+    radio->transport.setting_write = true;
+    if (best_last != 0x1) {
+        bool written = fm_write_registers_up_to(radio, best_last);
+        success &= fm_check_setting_write(radio, written, dirty & ((1 << (best_last - 0x1)) - 1));
+    }
+    for (uint8_t reg_index = best_last + 1; reg_index <= 0x8; reg_index++) {
+        uint8_t mask = 1 << (reg_index - 0x2);
+        if (radio->dirty_regs & mask) {
+            bool written = fm_write_single_register(radio, reg_index);
+            success &= fm_check_setting_write(radio, written, mask);
+        }
+    }
+    radio->transport.setting_write = false;
+    return success;
+}
 
 static void fm_set_channel_spacing_bits(uint16_t *regs, fm_channel_spacing_t channel_spacing) {
     switch (channel_spacing) {
@@ -209,123 +712,637 @@ static void fm_set_band_bits(uint16_t *regs, fm_band_t band) {
 }
 
 //
-// public interface
+// interrupts
 //
 
-void fm_init(rda5807_t *radio, i2c_inst_t *i2c_inst, uint8_t sdio_pin, uint8_t sclk_pin, bool enable_pull_ups) {
-    memset(radio, 0, sizeof(rda5807_t));
-
-    radio->i2c_inst = i2c_inst;
-    radio->sdio_pin = sdio_pin;
-    radio->sclk_pin = sclk_pin;
-    radio->enable_pull_ups = enable_pull_ups;
-    radio->seek_threshold = 8;
-    radio->mute = true;
-    radio->softmute = true;
+static rda5807_t *fm_interrupt_radios[NUM_BANK0_GPIOS];
+static uint32_t fm_interrupt_pin_mask; // pins with the raw handler installed
+
+static void fm_gpio_irq_handler(void) {
+    // raw handler shared with other users of the IO bank IRQ, handles only the radio pins
+    uint32_t pin_mask = fm_interrupt_pin_mask;
+    while (pin_mask != 0) {
+        uint gpio = __builtin_ctz(pin_mask);
+        pin_mask &= pin_mask - 1;
+        if (!(gpio_get_irq_event_mask(gpio) & GPIO_IRQ_EDGE_FALL)) {
+            continue;
+        }
+        gpio_acknowledge_irq(gpio, GPIO_IRQ_EDGE_FALL);
+        rda5807_t *radio = fm_interrupt_radios[gpio];
+        radio->interrupt_pending = true;
+        if (radio->interrupt_callback != NULL) {
+            radio->interrupt_callback(radio, radio->interrupt_callback_data);
+        }
+    }
 }
 
-void fm_power_up(rda5807_t *radio, fm_config_t config) {
-    assert(!fm_is_powered_up(radio));
-
-    radio->config = config;
-    radio->frequency_range = fm_frequency_range(config.band, config.channel_spacing);
+static uint64_t fm_poll_resume_time(rda5807_t *radio, uint poll_interval_ms, uint interrupt_timeout_ms) {
+    uint interval_ms = radio->interrupt_enabled ? interrupt_timeout_ms : poll_interval_ms;
+    return time_us_64() + interval_ms * 1000;
+}
 
-    // configure GPIO
-    i2c_inst_t *i2c_inst = radio->i2c_inst;
-    gpio_set_function(radio->sdio_pin, GPIO_FUNC_I2C);
-    gpio_set_function(radio->sclk_pin, GPIO_FUNC_I2C);
-    if (radio->enable_pull_ups) {
-        gpio_pull_up(radio->sdio_pin);
-        gpio_pull_up(radio->sclk_pin);
+static void fm_async_task_wait(rda5807_t *radio) {
+    // sleep until resume time, waking early if an interrupt is signalled
+    absolute_time_t resume_time = from_us_since_boot(radio->async.resume_time);
+    if (!radio->interrupt_enabled) {
+        sleep_until(resume_time);
+        return;
+    }
+    while (!fm_is_interrupt_pending(radio) && !best_effort_wfe_or_timeout(resume_time)) {
     }
+}
 
-    uint16_t *regs = radio->regs;
-    memset(regs, 0, sizeof(radio->regs));
+//
+// RDS
+//
 
-    if (!fm_read_single_register(i2c_inst, regs, 0x0)) {
-        panic("FM - couldn't read from I2C bus, check your wiring");
+static bool fm_copy_rds_group(rda5807_t *radio, uint16_t *blocks) {
+    uint16_t *regs = radio->regs;
+    bool rdsr = fm_get_bit(regs[0xA], RDSR);
+    if (!rdsr) {
+        return false; // not ready
     }
-    assert(regs[0] == 0x5804); // chip ID check
-
-    // reset
-    regs[0x2] = ENABLE_BIT | SOFT_RESET_BIT;
-    fm_write_single_register(i2c_inst, regs, 0x2);
-    sleep_ms(5);
-    // clear reset bit
-    regs[0x2] = ENABLE_BIT;
-    fm_write_single_register(i2c_inst, regs, 0x2);
-    sleep_ms(5);
+    if (fm_get_bit(regs[0xB], ABCD_E)) {
+        return false; // block E data, not RDS
+    }
+    memcpy(blocks, regs + 0xC, 4 * sizeof(uint16_t));
+    fm_stats_rds_group(radio);
+    return true;
+}
 
-    // initialize control registers
-    fm_read_single_register(i2c_inst, regs, 0x3);
-    fm_read_single_register(i2c_inst, regs, 0x4);
-    fm_read_single_register(i2c_inst, regs, 0x5);
-    fm_read_single_register(i2c_inst, regs, 0x6);
-    fm_read_single_register(i2c_inst, regs, 0x7);
-    fm_read_single_register(i2c_inst, regs, 0x8);
-
-    // setup
-    fm_set_bit(regs[0x2], NEW_METHOD, true);
-    fm_set_bit(regs[0x2], RDS_EN, true);
-    fm_set_bit(regs[0x2], BASS, radio->bass_boost);
-    fm_set_bit(regs[0x2], MONO, radio->mono);
-    fm_set_bit(regs[0x2], DMUTE, !radio->mute);
-    fm_set_bit(regs[0x2], DHIZ, true);
-    fm_set_bits(regs[0x3], CHAN, 0);
-    fm_set_bit(regs[0x4], SOFTMUTE_EN, radio->softmute);
-    fm_set_bit(regs[0x4], DE, config.deemphasis == FM_DEEMPHASIS_50);
-    fm_set_bits(regs[0x5], VOLUME, radio->volume);
-    fm_set_band_bits(regs, config.band);
-    fm_set_channel_spacing_bits(regs, config.channel_spacing);
-    fm_write_registers_up_to(i2c_inst, regs, 0x8);
+static bool fm_take_rds_interrupt(rda5807_t *radio) {
+    // returns false if RDS registers don't need polling
+    if (radio->interrupt_enabled) {
+        if (!fm_is_interrupt_pending(radio)) {
+            return false;
+        }
+        if (radio->async.task == NULL) {
+            radio->interrupt_pending = false; // otherwise left for the async task
+        }
+    }
+    return true;
+}
 
-    if (radio->frequency != 0.0f) {
-        // restore frequency if waking after power down
-        float frequency = radio->frequency;
-        radio->frequency = 0.0f;
-        fm_set_frequency_blocking(radio, frequency);
+static void fm_clear_rds_fifo(rda5807_t *radio) {
+    // drop groups buffered from the previous station
+    uint16_t *regs = radio->regs;
+    if (fm_get_bit(regs[0x4], RDS_FIFO_EN)) {
+        fm_set_bit(regs[0x4], RDS_FIFO_CLR, true);
+        fm_write_single_register(radio, 0x4);
+        fm_set_bit(regs[0x4], RDS_FIFO_CLR, false);
     }
 }
 
-void fm_power_down(rda5807_t *radio) {
-    assert(fm_is_powered_up(radio));
+//
+// resync
+//
 
-    if (radio->async.task != NULL) {
-        fm_async_task_cancel(radio);
+static void fm_resync_if_due(rda5807_t *radio) {
+    // called in the gap after an RDS poll found no new data, retune steps run even if disabled
+    bool enabled = radio->resync_period_us != 0 || radio->resync_state != FM_RESYNC_IDLE;
+    if (!enabled || radio->async.task != NULL || radio->update_pending
+        || time_us_64() < radio->next_resync_time) {
+        return;
     }
+    fm_resync_registers(radio);
+}
+
+//
+// tuning
+//
 
+static void fm_set_channel_mode(rda5807_t *radio) {
+    // leave direct frequency mode, before tuning by channel or seeking
     uint16_t *regs = radio->regs;
-    fm_set_bit(regs[0x2], ENABLE, false);
-    fm_write_single_register(radio->i2c_inst, regs, 0x2);
+    if (fm_get_bit(regs[0x7], FREQ_MODE)) {
+        fm_set_bit(regs[0x7], FREQ_MODE, false);
+        fm_write_single_register(radio, 0x7);
+    }
 }
 
-bool fm_is_powered_up(rda5807_t *radio) {
-    return fm_get_bit(radio->regs[0x2], ENABLE);
+static void fm_start_tune(rda5807_t *radio, uint16_t channel) {
+    // set channel and start tuning
+    fm_set_channel_mode(radio);
+    uint16_t *regs = radio->regs;
+    fm_set_bits(regs[0x3], CHAN, channel);
+    fm_set_bit(regs[0x3], TUNE, true);
+    radio->interrupt_pending = false;
+    radio->resync_state = FM_RESYNC_IDLE;
+    fm_quality_reset(radio);
+    fm_stats_begin_operation(radio);
+    fm_write_single_register(radio, 0x3);
+    radio->async.resume_time = fm_poll_resume_time(radio, TUNE_POLL_INTERVAL_MS, TUNE_INTERRUPT_TIMEOUT_MS);
 }
 
-fm_config_t fm_get_config(rda5807_t *radio) {
-    return radio->config;
+static uint32_t fm_round_direct_frequency_khz(uint32_t frequency_khz, fm_frequency_range_khz_t range) {
+    frequency_khz = MAX(frequency_khz, range.bottom);
+    frequency_khz = MIN(frequency_khz, range.top);
+    return (frequency_khz + 5) / 10 * 10;
+}
+
+static void fm_start_tune_direct(rda5807_t *radio, uint32_t frequency_khz) {
+    // set frequency offset from band bottom and start tuning
+    uint16_t *regs = radio->regs;
+    if (!fm_get_bit(regs[0x7], FREQ_MODE)) {
+        fm_set_bit(regs[0x7], FREQ_MODE, true);
+        fm_write_single_register(radio, 0x7);
+    }
+    regs[0x8] = (uint16_t)(frequency_khz - radio->frequency_range.bottom); // FREQ_DIRECT
+    fm_write_single_register(radio, 0x8);
+    fm_set_bit(regs[0x3], TUNE, true);
+    radio->interrupt_pending = false;
+    radio->resync_state = FM_RESYNC_IDLE;
+    fm_quality_reset(radio);
+    fm_stats_begin_operation(radio);
+    fm_write_single_register(radio, 0x3);
+    radio->async.resume_time = fm_poll_resume_time(radio, TUNE_POLL_INTERVAL_MS, TUNE_INTERRUPT_TIMEOUT_MS);
+}
+
+static void fm_restore_frequency(rda5807_t *radio, uint32_t frequency_khz) {
+    // retune after reconfiguration, using direct mode for frequencies off the channel grid
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    radio->frequency_khz = 0;
+    bool in_range = (range.bottom <= frequency_khz && frequency_khz <= range.top);
+    if (in_range && (frequency_khz - range.bottom) % range.spacing != 0) {
+        fm_set_frequency_direct_khz_blocking(radio, frequency_khz);
+    } else {
+        fm_set_frequency_khz_blocking(radio, frequency_khz);
+    }
+}
+
+static void fm_start_tune_khz(rda5807_t *radio, uint32_t frequency_khz) {
+    // tune by channel if on the channel grid, otherwise by direct frequency
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    frequency_khz = MAX(frequency_khz, range.bottom); // keep the grid check from wrapping
+    frequency_khz = MIN(frequency_khz, range.top);
+    if ((frequency_khz - range.bottom) % range.spacing == 0) {
+        fm_start_tune(radio, fm_frequency_khz_to_channel(frequency_khz, range));
+    } else {
+        fm_start_tune_direct(radio, fm_round_direct_frequency_khz(frequency_khz, range));
+    }
+}
+
+static bool fm_poll_tune_complete(rda5807_t *radio) {
+    // check seek / tune complete flag, otherwise schedule next poll
+    radio->interrupt_pending = false;
+    if (!fm_read_single_register(radio, 0xA) || !fm_get_bit(radio->regs[0xA], STC)) {
+        radio->async.resume_time = fm_poll_resume_time(radio, TUNE_POLL_INTERVAL_MS, TUNE_INTERRUPT_TIMEOUT_MS);
+        return false;
+    }
+    fm_stats_end_tune(radio);
+    return true;
+}
+
+static void fm_read_tuned_frequency(rda5807_t *radio, bool tuned) {
+    // in channel mode, the chip reports the channel it settled on, a direct frequency is only
+    // committed once tuned
+    uint16_t *regs = radio->regs;
+    if (fm_get_bit(regs[0x7], FREQ_MODE)) {
+        if (tuned) {
+            radio->frequency_khz = radio->frequency_range.bottom + regs[0x8]; // FREQ_DIRECT
+        }
+        return;
+    }
+    if (!tuned) {
+        fm_read_single_register(radio, 0xA); // otherwise fresh from the STC poll
+    }
+    uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
+    radio->frequency_khz = fm_channel_to_frequency_khz(channel, radio->frequency_range);
+}
+
+static void fm_finish_tune(rda5807_t *radio) {
+    // clear tune bit
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x3], TUNE, false);
+    fm_write_single_register(radio, 0x3);
+    fm_clear_rds_fifo(radio);
+}
+
+//
+// command queue
+//
+
+static bool fm_push_command(rda5807_t *radio, fm_command_type_t type, uint32_t value) {
+    fm_command_queue_t *queue = &radio->command_queue;
+    if (queue->count == FM_COMMAND_QUEUE_SIZE) {
+        return false; // full
+    }
+    size_t index = (queue->head + queue->count) % FM_COMMAND_QUEUE_SIZE;
+    queue->commands[index] = (fm_command_t){type, value};
+    queue->count++;
+    return true;
+}
+
+static bool fm_is_command_locked(rda5807_t *radio, fm_command_type_t type) {
+    // settings that conflict with the running task are deferred until it's done
+    return radio->async.task != NULL && (radio->async.locked_commands & (1 << type));
+}
+
+static bool fm_defer_command(rda5807_t *radio, fm_command_type_t type, uint32_t value) {
+    // replace a pending value of the same setting, unless a queued tune / seek comes after it
+    fm_command_queue_t *queue = &radio->command_queue;
+    for (size_t i = queue->count; 0 < i; i--) {
+        fm_command_t *command = &queue->commands[(queue->head + i - 1) % FM_COMMAND_QUEUE_SIZE];
+        if (command->type == type) {
+            command->value = value;
+            return true;
+        }
+        if (command->type == FM_COMMAND_FREQUENCY || command->type == FM_COMMAND_SEEK) {
+            break;
+        }
+    }
+    return fm_push_command(radio, type, value);
+}
+
+static void fm_run_commands(rda5807_t *radio, bool start_tasks) {
+    // apply queued commands in order, until one of them starts a new async task
+    fm_command_queue_t *queue = &radio->command_queue;
+    while (queue->count != 0 && radio->async.task == NULL) {
+        fm_command_t command = queue->commands[queue->head];
+        queue->head = (queue->head + 1) % FM_COMMAND_QUEUE_SIZE;
+        queue->count--;
+        switch (command.type) {
+        case FM_COMMAND_FREQUENCY:
+            if (start_tasks) {
+                fm_set_frequency_khz_async(radio, command.value);
+            }
+            break;
+#if FM_RDA5807_SEEK_ENABLE
+        case FM_COMMAND_SEEK:
+            if (start_tasks) {
+                fm_seek_async(radio, (fm_seek_direction_t)command.value);
+            }
+            break;
+#endif
+        case FM_COMMAND_VOLUME:
+            fm_set_volume(radio, (uint8_t)command.value);
+            break;
+        case FM_COMMAND_MUTE:
+            fm_set_mute(radio, command.value != 0);
+            break;
+        case FM_COMMAND_SOFTMUTE:
+            fm_set_softmute(radio, command.value != 0);
+            break;
+        case FM_COMMAND_BASS_BOOST:
+            fm_set_bass_boost(radio, command.value != 0);
+            break;
+        case FM_COMMAND_MONO:
+            fm_set_mono(radio, command.value != 0);
+            break;
+        default: // FM_COMMAND_SEEK_THRESHOLD
+            fm_set_seek_threshold(radio, (uint8_t)command.value);
+            break;
+        }
+    }
+}
+
+//
+// settings
+//
+
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
+#define fm_store_setting(radio, field, value) ((radio)->field = (value))
+#else
+#define fm_store_setting(radio, field, value) ((void)0) // read back from the register shadow
+#endif
+
+typedef struct fm_settings_t
+{
+    uint8_t volume;
+    uint8_t seek_threshold;
+    bool mute;
+    bool softmute;
+    bool bass_boost;
+    bool mono;
+    bool rds_fifo;
+} fm_settings_t;
+
+static fm_settings_t fm_save_settings(rda5807_t *radio) {
+    // must be taken before the register shadow is reset
+    return (fm_settings_t){
+        .volume = fm_get_volume(radio),
+        .seek_threshold = fm_get_seek_threshold(radio),
+        .mute = fm_get_mute(radio),
+        .softmute = fm_get_softmute(radio),
+        .bass_boost = fm_get_bass_boost(radio),
+        .mono = fm_get_mono(radio),
+        .rds_fifo = fm_get_rds_fifo(radio),
+    };
+}
+
+//
+// power up
+//
+
+static void fm_configure_pins(rda5807_t *radio) {
+    // configure GPIO
+    gpio_set_function(radio->sdio_pin, GPIO_FUNC_I2C);
+    gpio_set_function(radio->sclk_pin, GPIO_FUNC_I2C);
+    if (radio->enable_pull_ups) {
+        gpio_pull_up(radio->sdio_pin);
+        gpio_pull_up(radio->sclk_pin);
+    }
+    if (radio->interrupt_enabled) {
+        uint interrupt_pin = radio->interrupt_pin;
+        fm_interrupt_radios[interrupt_pin] = radio;
+        gpio_init(interrupt_pin);
+        gpio_set_dir(interrupt_pin, GPIO_IN);
+        gpio_pull_up(interrupt_pin);
+        if (!(fm_interrupt_pin_mask & (1u << interrupt_pin))) {
+            // once per pin, kept across power cycles
+            fm_interrupt_pin_mask |= 1u << interrupt_pin;
+            gpio_add_raw_irq_handler(interrupt_pin, &fm_gpio_irq_handler);
+        }
+        gpio_set_irq_enabled(interrupt_pin, GPIO_IRQ_EDGE_FALL, true);
+        irq_set_enabled(IO_IRQ_BANK0, true);
+    }
+}
+
+static void fm_setup_registers(rda5807_t *radio, const fm_settings_t *settings) {
+    // apply settings on top of the reset values
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], NEW_METHOD, true);
+    fm_set_bit(regs[0x2], RDS_EN, true);
+    fm_set_bit(regs[0x2], BASS, settings->bass_boost);
+    fm_set_bit(regs[0x2], MONO, settings->mono);
+    fm_set_bit(regs[0x2], DMUTE, !settings->mute);
+    fm_set_bit(regs[0x2], DHIZ, true);
+    fm_set_bits(regs[0x3], CHAN, 0);
+    fm_set_bit(regs[0x4], SOFTMUTE_EN, settings->softmute);
+    fm_set_bit(regs[0x4], RDS_FIFO_EN, settings->rds_fifo);
+    fm_set_bit(regs[0x4], RDS_FIFO_CLR, false);
+    fm_set_bit(regs[0x4], DE, radio->config.deemphasis == FM_DEEMPHASIS_50);
+    fm_set_bits(regs[0x5], VOLUME, settings->volume);
+    fm_set_bits(regs[0x5], SEEKTH, settings->seek_threshold);
+    if (radio->interrupt_enabled) {
+        fm_set_bits(regs[0x4], GPIO2, 0b01); // interrupt output
+        fm_set_bit(regs[0x4], STCIEN, true);
+        fm_set_bit(regs[0x4], RDSIEN, true); // RDS is always enabled
+        fm_set_bit(regs[0x5], INT_MODE, false); // 5ms pulse, so each RDS group raises an edge
+    }
+    fm_set_band_bits(regs, radio->config.band);
+    fm_set_channel_spacing_bits(regs, radio->config.channel_spacing);
+}
+
+//
+// public interface
+//
+
+void fm_init(rda5807_t *radio, i2c_inst_t *i2c_inst, uint8_t sdio_pin, uint8_t sclk_pin, bool enable_pull_ups) {
+    memset(radio, 0, sizeof(rda5807_t));
+
+    radio->i2c_inst = i2c_inst;
+    radio->i2c_addr_sequential = RDA5807_ADDR_SEQUENTIAL;
+    radio->i2c_addr_random_access = RDA5807_ADDR_RANDOM_ACCESS;
+    radio->sdio_pin = sdio_pin;
+    radio->sclk_pin = sclk_pin;
+    radio->enable_pull_ups = enable_pull_ups;
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
+    radio->seek_threshold = 8;
+    radio->mute = true;
+    radio->softmute = true;
+#else
+    // defaults in the register shadow, carried over on power up
+    fm_set_bit(radio->regs[0x4], SOFTMUTE_EN, true);
+    fm_set_bits(radio->regs[0x5], SEEKTH, 8);
+#endif
+    radio->quality_period_us = FM_QUALITY_DEFAULT_PERIOD_MS * 1000;
+    radio->resync_period_us = FM_RESYNC_DEFAULT_PERIOD_MS * 1000;
+#if FM_RDA5807_SEEK_ENABLE
+    radio->seek.config = fm_seek_config_default();
+#endif
+}
+
+void fm_set_i2c_addresses(rda5807_t *radio, uint8_t sequential_addr, uint8_t random_access_addr) {
+    assert(!fm_is_powered_up(radio));
+    assert(sequential_addr < 0x80 && random_access_addr < 0x80);
+
+    radio->i2c_addr_sequential = sequential_addr;
+    radio->i2c_addr_random_access = random_access_addr;
+}
+
+void fm_enable_interrupt(rda5807_t *radio, uint8_t interrupt_pin) {
+    assert(!fm_is_powered_up(radio));
+    assert(interrupt_pin < NUM_BANK0_GPIOS);
+
+    radio->interrupt_enabled = true;
+    radio->interrupt_pin = interrupt_pin;
+    radio->interrupt_pending = false;
+}
+
+void fm_set_interrupt_callback(rda5807_t *radio, fm_interrupt_callback_t interrupt_callback, void *user_data) {
+    uint32_t status = save_and_disable_interrupts();
+    radio->interrupt_callback = interrupt_callback;
+    radio->interrupt_callback_data = user_data;
+    restore_interrupts(status);
+}
+
+bool fm_is_interrupt_pending(rda5807_t *radio) {
+    if (!radio->interrupt_enabled) {
+        return true;
+    }
+    return radio->interrupt_pending;
+}
+
+bool fm_power_up(rda5807_t *radio, fm_config_t config) {
+    assert(!fm_is_powered_up(radio));
+
+    radio->config = config;
+    radio->frequency_range = fm_frequency_range_khz(config.band, config.channel_spacing);
+    radio->standby = false;
+    fm_configure_pins(radio);
+
+    fm_settings_t settings = fm_save_settings(radio);
+    uint16_t *regs = radio->regs;
+    memset(regs, 0, sizeof(radio->regs));
+
+    if (!fm_read_single_register(radio, 0x0)) {
+        panic("FM - couldn't read from I2C bus, check your wiring");
+    }
+    assert(regs[0] == 0x5804); // chip ID check
+
+    // reset
+    bool success = true;
+    regs[0x2] = ENABLE_BIT | SOFT_RESET_BIT;
+    success &= fm_write_single_register(radio, 0x2);
+    sleep_ms(5);
+    // clear reset bit
+    regs[0x2] = ENABLE_BIT;
+    success &= fm_write_single_register(radio, 0x2);
+    sleep_ms(5);
+
+    // initialize control registers
+    success &= fm_read_single_register(radio, 0x3);
+    success &= fm_read_single_register(radio, 0x4);
+    success &= fm_read_single_register(radio, 0x5);
+    success &= fm_read_single_register(radio, 0x6);
+    success &= fm_read_single_register(radio, 0x7);
+    success &= fm_read_single_register(radio, 0x8);
+
+    fm_setup_registers(radio, &settings);
+    if (!fm_write_registers_up_to(radio, 0x8)) {
+        radio->dirty_regs = 0x7F; // retried by the next fm_commit_update()
+        success = false;
+    }
+
+    if (radio->frequency_khz != 0) {
+        // restore frequency if waking after power down
+        fm_restore_frequency(radio, radio->frequency_khz);
+    }
+    return success;
+}
+
+static fm_async_progress_t fm_power_up_async_task(rda5807_t *radio, bool cancel) {
+    assert(radio->async.task == &fm_power_up_async_task);
+
+    uint16_t *regs = radio->regs;
+    uint64_t now = time_us_64();
+    switch (radio->async.state) {
+    case 1: // write register image
+        if (cancel) {
+            return (fm_async_progress_t){.done = true, -1};
+        }
+        if (!fm_write_registers_up_to(radio, 0x8)) {
+            break; // chip not on the bus yet
+        }
+        radio->async.state = 2;
+        // fall through
+    case 2: // wait for chip
+        if (cancel) {
+            return (fm_async_progress_t){.done = true, -1};
+        }
+        if (!fm_read_registers_up_to(radio, 0xB) || !fm_get_bit(regs[0xB], FM_READY)) {
+            break;
+        }
+        if (radio->frequency_khz == 0) {
+            return (fm_async_progress_t){.done = true, 0}; // untuned
+        }
+        fm_start_tune_khz(radio, radio->frequency_khz);
+        radio->async.state = 3;
+        return (fm_async_progress_t){.done = false};
+    default: { // 3: tune
+        int result = 0;
+        if (cancel) {
+            result = -1;
+        } else if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, result == 0);
+        return (fm_async_progress_t){.done = true, result};
+    }
+    }
+    if (radio->power_up_timeout_time <= now) {
+        int result = (radio->async.state == 1) ? FM_RESULT_I2C_ERROR : -1; // never answered, or not ready
+        return (fm_async_progress_t){.done = true, result};
+    }
+    radio->async.resume_time = now + POWER_UP_POLL_INTERVAL_MS * 1000;
+    return (fm_async_progress_t){.done = false};
+}
+
+void fm_power_up_async(rda5807_t *radio, fm_config_t config, uint32_t frequency_khz) {
+    assert(!fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+    assert(!radio->update_pending);
+
+    radio->async.i2c_failed = false;
+    uint16_t *regs = radio->regs;
+    bool resume = radio->standby && radio->config.band == config.band
+        && radio->config.channel_spacing == config.channel_spacing && radio->config.deemphasis == config.deemphasis;
+    radio->config = config;
+    radio->frequency_range = fm_frequency_range_khz(config.band, config.channel_spacing);
+    radio->standby = false;
+    fm_configure_pins(radio);
+
+    if (!resume) {
+        // registers hold their reset values after power-on, no need to reset and read them
+        fm_settings_t settings = fm_save_settings(radio);
+        memset(regs, 0, sizeof(radio->regs));
+        regs[0x3] = 0x4FC0;
+        regs[0x4] = 0x0400;
+        regs[0x5] = 0x888B;
+        regs[0x6] = 0x0000;
+        regs[0x7] = 0x42C6;
+        regs[0x8] = 0x0000;
+        fm_setup_registers(radio, &settings);
+        if (frequency_khz == 0) {
+            radio->frequency_khz = 0;
+        }
+    }
+    fm_set_bit(regs[0x2], ENABLE, true);
+    fm_set_bit(regs[0x2], SEEK, false);
+    fm_set_bit(regs[0x3], TUNE, false);
+    if (frequency_khz != 0) {
+        radio->frequency_khz = frequency_khz;
+    }
+
+    radio->power_up_timeout_time = time_us_64() + POWER_UP_TIMEOUT_MS * 1000;
+    radio->async.task = fm_power_up_async_task;
+    radio->async.state = 1;
+    radio->async.resume_time = time_us_64(); // due right away
+    // the chip isn't ready for writes yet, settings are applied once it's up
+    radio->async.locked_commands = (1 << FM_COMMAND_VOLUME) | (1 << FM_COMMAND_MUTE) | (1 << FM_COMMAND_SOFTMUTE)
+        | (1 << FM_COMMAND_BASS_BOOST) | (1 << FM_COMMAND_MONO) | (1 << FM_COMMAND_SEEK_THRESHOLD);
+}
+
+void fm_power_down(rda5807_t *radio) {
+    assert(fm_is_powered_up(radio));
+
+    if (radio->async.task != NULL) {
+        fm_async_task_cancel(radio);
+    }
+
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], ENABLE, false);
+    fm_write_single_register(radio, 0x2);
+    radio->standby = true;
+}
+
+bool fm_is_powered_up(rda5807_t *radio) {
+    return fm_get_bit(radio->regs[0x2], ENABLE);
+}
+
+fm_config_t fm_get_config(rda5807_t *radio) {
+    return radio->config;
 }
 
 fm_frequency_range_t fm_get_frequency_range(rda5807_t *radio) {
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    return (fm_frequency_range_t){
+        fm_khz_to_mhz(range.bottom),
+        fm_khz_to_mhz(range.top),
+        fm_khz_to_mhz(range.spacing),
+    };
+}
+
+fm_frequency_range_khz_t fm_get_frequency_range_khz(rda5807_t *radio) {
     return radio->frequency_range;
 }
 
 float fm_get_frequency(rda5807_t *radio) {
-    return radio->frequency;
+    return fm_khz_to_mhz(radio->frequency_khz);
+}
+
+uint32_t fm_get_frequency_khz(rda5807_t *radio) {
+    return radio->frequency_khz;
 }
 
 void fm_set_frequency_blocking(rda5807_t *radio, float frequency) {
+    fm_set_frequency_khz_blocking(radio, fm_mhz_to_khz(frequency));
+}
+
+void fm_set_frequency_khz_blocking(rda5807_t *radio, uint32_t frequency_khz) {
     assert(fm_is_powered_up(radio));
     assert(radio->async.task == NULL); // disallowed during async task
 
-    if (radio->frequency == frequency) {
-        return;
+    uint16_t channel = fm_frequency_khz_to_channel(frequency_khz, radio->frequency_range);
+    if (radio->frequency_khz == fm_channel_to_frequency_khz(channel, radio->frequency_range)) {
+        return; // already tuned
     }
-    fm_set_frequency_async(radio, frequency);
+    fm_set_frequency_khz_async(radio, frequency_khz);
     fm_async_progress_t progress;
     do {
-        sleep_ms(TUNE_POLL_INTERVAL_MS);
+        fm_async_task_wait(radio);
         progress = fm_async_task_tick(radio);
     } while (!progress.done);
 }
@@ -334,255 +1351,1160 @@ static fm_async_progress_t fm_set_frequency_async_task(rda5807_t *radio, bool ca
     assert(radio->async.task == &fm_set_frequency_async_task);
     assert(radio->async.state == 1);
 
-    i2c_inst_t *i2c_inst = radio->i2c_inst;
+    int result = 0;
+    if (cancel) {
+        result = -1;
+    } else if (!fm_poll_tune_complete(radio)) {
+        return (fm_async_progress_t){.done = false};
+    }
+    fm_finish_tune(radio);
+    fm_read_tuned_frequency(radio, result == 0);
+    return (fm_async_progress_t){.done = true, result};
+}
+
+void fm_set_frequency_async(rda5807_t *radio, float frequency) {
+    fm_set_frequency_khz_async(radio, fm_mhz_to_khz(frequency));
+}
+
+void fm_set_frequency_khz_async(rda5807_t *radio, uint32_t frequency_khz) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    radio->async.i2c_failed = false; // failures while starting are reported by the first tick
+    uint16_t channel = fm_frequency_khz_to_channel(frequency_khz, radio->frequency_range);
+    fm_start_tune(radio, channel);
+
+    radio->async.task = fm_set_frequency_async_task;
+    radio->async.state = 1;
+}
+
+void fm_set_frequency_direct_khz_blocking(rda5807_t *radio, uint32_t frequency_khz) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    fm_set_frequency_direct_khz_async(radio, frequency_khz);
+    fm_async_progress_t progress;
+    do {
+        fm_async_task_wait(radio);
+        progress = fm_async_task_tick(radio);
+    } while (!progress.done);
+}
+
+void fm_set_frequency_direct_khz_async(rda5807_t *radio, uint32_t frequency_khz) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    radio->async.i2c_failed = false;
+    frequency_khz = fm_round_direct_frequency_khz(frequency_khz, radio->frequency_range);
+    fm_start_tune_direct(radio, frequency_khz);
+
+    radio->async.task = fm_set_frequency_async_task;
+    radio->async.state = 1;
+}
+
+void fm_set_config(rda5807_t *radio, fm_config_t config) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    radio->config = config;
+    radio->frequency_range = fm_frequency_range_khz(config.band, config.channel_spacing);
+
+    uint16_t *regs = radio->regs;
+    uint16_t old_regs[16];
+    memcpy(old_regs, regs, sizeof(old_regs));
+    fm_set_bit(regs[0x4], DE, config.deemphasis == FM_DEEMPHASIS_50);
+    fm_set_band_bits(regs, config.band);
+    fm_set_channel_spacing_bits(regs, config.channel_spacing);
+    for (uint8_t reg_index = 0x4; reg_index <= 0x7; reg_index++) {
+        if (regs[reg_index] != old_regs[reg_index]) {
+            fm_write_single_register(radio, reg_index);
+        }
+    }
+    // band and spacing take effect on the next tune
+    if (radio->frequency_khz != 0) {
+        fm_restore_frequency(radio, radio->frequency_khz);
+    } else {
+        fm_write_single_register(radio, 0x3);
+    }
+}
+
+uint8_t fm_get_seek_threshold(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
+    return radio->seek_threshold;
+#else
+    return fm_get_bits(radio->regs[0x5], SEEKTH);
+#endif
+}
+
+bool fm_set_seek_threshold(rda5807_t *radio, uint8_t seek_threshold) {
+    assert(fm_is_powered_up(radio));
+
+    if (fm_is_command_locked(radio, FM_COMMAND_SEEK_THRESHOLD)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_SEEK_THRESHOLD, seek_threshold);
+    }
+    seek_threshold = MIN(seek_threshold, FM_MAX_SEEK_THRESHOLD);
+    if (seek_threshold == fm_get_seek_threshold(radio)) {
+        return true;
+    }
+    uint16_t *regs = radio->regs;
+    fm_set_bits(regs[0x5], SEEKTH, seek_threshold);
+    fm_store_setting(radio, seek_threshold, seek_threshold);
+    return fm_update_register(radio, 0x5);
+}
+
+#if FM_RDA5807_SEEK_ENABLE
+fm_seek_config_t fm_get_seek_config(rda5807_t *radio) {
+    return radio->seek.config;
+}
+
+void fm_set_seek_config(rda5807_t *radio, fm_seek_config_t config) {
+    assert(radio->async.task == NULL); // disallowed during async task
+    assert(config.rssi_threshold <= 63);
+
+    radio->seek.config = config;
+}
+
+bool fm_seek_blocking(rda5807_t *radio, fm_seek_direction_t direction) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    fm_seek_async(radio, direction);
+    fm_async_progress_t progress;
+    do {
+        fm_async_task_wait(radio);
+        progress = fm_async_task_tick(radio);
+    } while (!progress.done);
+    bool success = (progress.result == 0);
+    return success;
+}
+
+static void fm_apply_seek_config(rda5807_t *radio) {
+    // the old method threshold only matters for seeking, written when it changes
+    const fm_seek_config_t *config = &radio->seek.config;
+    uint16_t *regs = radio->regs;
+    uint16_t old_reg5 = regs[0x5];
+    uint16_t old_reg7 = regs[0x7];
+    fm_set_bits(regs[0x5], SEEK_MODE, config->rssi_mode ? 0b10 : 0b00);
+    fm_set_bits(regs[0x7], SEEK_TH_OLD, config->rssi_threshold);
+    if (regs[0x5] != old_reg5) {
+        fm_write_single_register(radio, 0x5);
+    }
+    if (regs[0x7] != old_reg7) {
+        fm_write_single_register(radio, 0x7);
+    }
+    fm_set_bit(regs[0x2], SKMODE, !config->wrap);
+}
+
+static void fm_start_seek(rda5807_t *radio) {
+    // SEEK is set in the register shadow, the chip starts on its rising edge
+    radio->interrupt_pending = false;
+    radio->resync_state = FM_RESYNC_IDLE;
+    fm_quality_reset(radio);
+    fm_write_single_register(radio, 0x2);
+    radio->async.resume_time = fm_poll_resume_time(radio, radio->seek.config.poll_interval_ms, SEEK_INTERRUPT_TIMEOUT_MS);
+}
+
+static bool fm_seek_is_station(rda5807_t *radio) {
+    // check the channel the chip stopped on against the seek config
+    const fm_seek_config_t *config = &radio->seek.config;
+    if (!config->require_fm_true && config->min_rssi == 0) {
+        return true;
+    }
+    uint16_t *regs = radio->regs;
+    if (!fm_read_registers_up_to(radio, 0xB)) {
+        return true; // keep the stop rather than seeking on blindly
+    }
+    if (config->require_fm_true && !fm_get_bit(regs[0xB], FM_TRUE)) {
+        return false;
+    }
+    return config->min_rssi <= fm_get_bits(regs[0xB], RSSI);
+}
+
+static fm_async_progress_t fm_seek_async_task(rda5807_t *radio, bool cancel) {
+    assert(radio->async.task == &fm_seek_async_task);
+    assert(radio->async.state == 1);
+
     uint16_t *regs = radio->regs;
     int result = 0;
     if (cancel) {
         result = -1;
     } else {
-        fm_read_single_register(i2c_inst, regs, 0xA);
+        radio->interrupt_pending = false;
+        fm_read_single_register(radio, 0xA);
         if (!fm_get_bit(regs[0xA], STC)) {
-            radio->async.resume_time = time_us_64() + TUNE_POLL_INTERVAL_MS * 1000;
+            uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
+            radio->frequency_khz = fm_channel_to_frequency_khz(channel, radio->frequency_range);
+            radio->async.resume_time = fm_poll_resume_time(radio, radio->seek.config.poll_interval_ms, SEEK_INTERRUPT_TIMEOUT_MS);
             return (fm_async_progress_t){.done = false};
         }
+
+        // seek done, check seek-failed flag and validate the stop
+        if (fm_get_bit(regs[0xA], SF)) {
+            result = -1;
+        } else if (!fm_seek_is_station(radio)) {
+            fm_seek_state_t *seek = &radio->seek;
+            if (seek->continues < seek->config.max_continues) {
+                // false stop, seek on from here
+                seek->continues++;
+                fm_set_bit(regs[0x2], SEEK, false);
+                fm_write_single_register(radio, 0x2);
+                fm_set_bit(regs[0x2], SEEK, true);
+                fm_start_seek(radio);
+                return (fm_async_progress_t){.done = false};
+            }
+            result = -1;
+        }
+        fm_stats_end_seek(radio);
     }
 
-    // clear tune bit
-    fm_set_bit(regs[0x3], TUNE, false);
-    fm_write_single_register(i2c_inst, regs, 0x3);
+    // clear seek bit
+    fm_set_bit(regs[0x2], SEEK, false);
+    fm_write_single_register(radio, 0x2);
+    fm_clear_rds_fifo(radio);
 
-    fm_read_single_register(i2c_inst, regs, 0xA);
+    fm_read_single_register(radio, 0xA);
     uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
-    radio->frequency = fm_channel_to_frequency(channel, radio->frequency_range);
+    radio->frequency_khz = fm_channel_to_frequency_khz(channel, radio->frequency_range);
     return (fm_async_progress_t){.done = true, result};
 }
 
-void fm_set_frequency_async(rda5807_t *radio, float frequency) {
+void fm_seek_async(rda5807_t *radio, fm_seek_direction_t direction) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    radio->async.i2c_failed = false;
+    fm_set_channel_mode(radio);
+    fm_apply_seek_config(radio);
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], SEEKUP, direction == FM_SEEK_UP);
+    fm_set_bit(regs[0x2], SEEK, true); // start seek
+    radio->seek.continues = 0;
+    fm_stats_begin_operation(radio);
+    fm_start_seek(radio);
+
+    radio->async.task = fm_seek_async_task;
+    radio->async.state = 1;
+    // writing register 0x2 would restart the seek
+    radio->async.locked_commands = (1 << FM_COMMAND_MUTE) | (1 << FM_COMMAND_BASS_BOOST) | (1 << FM_COMMAND_MONO)
+        | (1 << FM_COMMAND_SEEK_THRESHOLD);
+}
+#endif // FM_RDA5807_SEEK_ENABLE
+
+void fm_begin_update(rda5807_t *radio) {
+    assert(fm_is_powered_up(radio));
+    assert(!radio->update_pending);
+
+    radio->update_pending = true;
+}
+
+bool fm_commit_update(rda5807_t *radio) {
+    assert(radio->update_pending);
+
+    radio->update_pending = false;
+    return fm_write_dirty_registers(radio);
+}
+
+#if FM_RDA5807_SCAN_ENABLE
+size_t fm_scan_blocking(rda5807_t *radio, fm_station_t *stations, size_t capacity, fm_scan_config_t config) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+
+    fm_scan_async(radio, stations, capacity, config);
+    fm_async_progress_t progress;
+    do {
+        fm_async_task_wait(radio);
+        progress = fm_async_task_tick(radio);
+    } while (!progress.done);
+    return progress.result;
+}
+
+static void fm_scan_record(fm_scan_state_t *scan, fm_station_t station) {
+    if (scan->count == scan->capacity) {
+        // table full, keep the strongest stations
+        size_t weakest = 0;
+        for (size_t i = 1; i < scan->count; i++) {
+            if (scan->stations[i].rssi < scan->stations[weakest].rssi) {
+                weakest = i;
+            }
+        }
+        if (station.rssi <= scan->stations[weakest].rssi) {
+            return;
+        }
+        memmove(scan->stations + weakest, scan->stations + weakest + 1, (scan->count - weakest - 1) * sizeof(fm_station_t));
+        scan->count--;
+    }
+    // channels are scanned in order, so the table stays sorted
+    scan->stations[scan->count++] = station;
+}
+
+static void fm_scan_restore_mute(rda5807_t *radio) {
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], DMUTE, !radio->scan.original_mute);
+    fm_write_single_register(radio, 0x2);
+}
+
+static void fm_scan_start_seek(rda5807_t *radio) {
+    // seek up from the current channel to the next station, stopping at the band edge
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], SEEKUP, true);
+    fm_set_bit(regs[0x2], SKMODE, true);
+    fm_set_bit(regs[0x2], SEEK, true);
+    radio->interrupt_pending = false;
+    fm_write_single_register(radio, 0x2);
+    radio->async.resume_time = fm_poll_resume_time(radio, SCAN_SEEK_POLL_INTERVAL_MS, SCAN_SEEK_INTERRUPT_TIMEOUT_MS);
+}
+
+static void fm_scan_finish_seek(rda5807_t *radio) {
+    // clear seek bit, so that the next seek starts on a rising edge
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], SEEK, false);
+    fm_write_single_register(radio, 0x2);
+}
+
+static fm_async_progress_t fm_scan_async_task(rda5807_t *radio, bool cancel) {
+    assert(radio->async.task == &fm_scan_async_task);
+
+    uint16_t *regs = radio->regs;
+    fm_scan_state_t *scan = &radio->scan;
+    if (cancel) {
+        if (radio->async.state == 4) {
+            fm_scan_finish_seek(radio);
+            fm_read_tuned_frequency(radio, false);
+        } else if (radio->async.state != 2) {
+            fm_finish_tune(radio);
+        }
+        fm_scan_restore_mute(radio);
+        return (fm_async_progress_t){.done = true, -1};
+    }
+
+    switch (radio->async.state) {
+    case 1: // tuning to bottom channel
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        radio->async.state = 2;
+        radio->async.resume_time = time_us_64() + scan->config.dwell_ms * 1000;
+        return (fm_async_progress_t){.done = false};
+    case 2: { // sampling channel
+        if (time_us_64() < radio->async.resume_time) {
+            return (fm_async_progress_t){.done = false}; // woken by interrupt during dwell
+        }
+        fm_read_registers_up_to(radio, 0xB);
+        fm_station_t station = {
+            .channel = scan->channel,
+            .rssi = (uint8_t)fm_get_bits(regs[0xB], RSSI),
+            .flags = (fm_get_bit(regs[0xA], ST) ? FM_STATION_STEREO : 0)
+                | (fm_get_bit(regs[0xB], FM_TRUE) ? FM_STATION_FM_TRUE : 0),
+        };
+        bool fm_true = (station.flags & FM_STATION_FM_TRUE) != 0;
+        if (scan->config.min_rssi <= station.rssi && (fm_true || !scan->config.require_fm_true)) {
+            fm_scan_record(scan, station);
+        }
+        if (scan->channel < scan->last_channel) {
+            fm_scan_start_seek(radio);
+            radio->async.state = 4;
+        } else {
+            fm_start_tune_khz(radio, scan->original_frequency_khz);
+            radio->async.state = 3;
+        }
+        return (fm_async_progress_t){.done = false};
+    }
+    case 4: { // seeking to next station
+        radio->interrupt_pending = false;
+        fm_read_single_register(radio, 0xA);
+        uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
+        if (!fm_get_bit(regs[0xA], STC)) {
+            radio->frequency_khz = fm_channel_to_frequency_khz(channel, radio->frequency_range);
+            radio->async.resume_time = fm_poll_resume_time(radio, SCAN_SEEK_POLL_INTERVAL_MS, SCAN_SEEK_INTERRUPT_TIMEOUT_MS);
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_scan_finish_seek(radio);
+        if (fm_get_bit(regs[0xA], SF) || channel <= scan->channel) {
+            // band edge reached without another station
+            fm_start_tune_khz(radio, scan->original_frequency_khz);
+            radio->async.state = 3;
+            return (fm_async_progress_t){.done = false};
+        }
+        scan->channel = channel;
+        radio->frequency_khz = fm_channel_to_frequency_khz(channel, radio->frequency_range);
+        radio->async.state = 2;
+        radio->async.resume_time = time_us_64() + scan->config.dwell_ms * 1000;
+        return (fm_async_progress_t){.done = false};
+    }
+    default: // restoring original frequency
+        assert(radio->async.state == 3);
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_scan_restore_mute(radio);
+        fm_read_tuned_frequency(radio, true);
+        return (fm_async_progress_t){.done = true, scan->count};
+    }
+}
+
+void fm_scan_async(rda5807_t *radio, fm_station_t *stations, size_t capacity, fm_scan_config_t config) {
     assert(fm_is_powered_up(radio));
     assert(radio->async.task == NULL); // disallowed during async task
+    assert(0 < capacity && capacity <= UINT16_MAX);
 
-    frequency = MAX(frequency, radio->frequency_range.bottom);
-    frequency = MIN(frequency, radio->frequency_range.top);
+    radio->async.i2c_failed = false;
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    fm_scan_state_t *scan = &radio->scan;
     uint16_t *regs = radio->regs;
-    uint16_t channel = fm_frequency_to_channel(frequency, radio->frequency_range);
-    // set channel and start tuning
-    fm_set_bits(regs[0x3], CHAN, channel);
-    fm_set_bit(regs[0x3], TUNE, true);
-    fm_write_single_register(radio->i2c_inst, regs, 0x3);
-
-    radio->async.task = fm_set_frequency_async_task;
+    scan->config = config;
+    scan->stations = stations;
+    scan->capacity = capacity;
+    scan->count = 0;
+    scan->channel = 0;
+    scan->last_channel = fm_frequency_khz_to_channel(range.top, range);
+    scan->original_frequency_khz = radio->frequency_khz;
+    scan->original_mute = fm_get_mute(radio);
+
+    fm_set_bit(regs[0x2], DMUTE, false);
+    fm_write_single_register(radio, 0x2);
+    radio->frequency_khz = range.bottom;
+    fm_start_tune(radio, scan->channel);
+
+    radio->async.task = fm_scan_async_task;
     radio->async.state = 1;
-    radio->async.resume_time = time_us_64() + TUNE_POLL_INTERVAL_MS * 1000;
+    // mute is restored after the scan, writing register 0x2 would restart a seek
+    radio->async.locked_commands = (1 << FM_COMMAND_MUTE) | (1 << FM_COMMAND_BASS_BOOST) | (1 << FM_COMMAND_MONO)
+        | (1 << FM_COMMAND_SEEK_THRESHOLD);
 }
+#endif // FM_RDA5807_SCAN_ENABLE
 
-uint8_t fm_get_seek_threshold(rda5807_t *radio) {
-    return radio->seek_threshold;
+#if FM_RDA5807_AF_ENABLE || FM_RDA5807_TRACKER_ENABLE
+static bool fm_poll_pi(rda5807_t *radio, uint16_t *pi) {
+    // PI code from block A of the RDS group ready, if received intact
+    uint16_t *regs = radio->regs;
+    fm_read_registers_up_to(radio, 0xC);
+    bool has_pi = fm_get_bit(regs[0xA], RDSR) && !fm_get_bit(regs[0xB], ABCD_E)
+        && fm_get_bits(regs[0xB], BLERA) != 3;
+    if (has_pi) {
+        *pi = regs[0xC];
+    }
+    return has_pi;
+}
+#endif // FM_RDA5807_AF_ENABLE || FM_RDA5807_TRACKER_ENABLE
+
+#if FM_RDA5807_AF_ENABLE
+static size_t fm_af_next_candidate(rda5807_t *radio, size_t index) {
+    // skip frequencies outside the band, and the current one
+    fm_af_state_t *af = &radio->af;
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    for (; index < af->count; index++) {
+        uint32_t frequency_khz = af->frequencies_khz[index];
+        if (range.bottom <= frequency_khz && frequency_khz <= range.top
+            && frequency_khz != af->original_frequency_khz) {
+            break;
+        }
+    }
+    return index;
 }
 
-void fm_set_seek_threshold(rda5807_t *radio, uint8_t seek_threshold) {
-    assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
+static void fm_af_restore_mute(rda5807_t *radio) {
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], DMUTE, !radio->af.original_mute);
+    fm_write_single_register(radio, 0x2);
+}
+
+static fm_async_progress_t fm_probe_af_async_task(rda5807_t *radio, bool cancel) {
+    assert(radio->async.task == &fm_probe_af_async_task);
 
-    seek_threshold = MIN(seek_threshold, FM_MAX_SEEK_THRESHOLD);
-    if (seek_threshold == radio->seek_threshold) {
-        return;
-    }
     uint16_t *regs = radio->regs;
-    fm_set_bits(regs[0x5], SEEKTH, seek_threshold);
-    fm_write_single_register(radio->i2c_inst, regs, 0x5);
-    radio->seek_threshold = seek_threshold;
+    fm_af_state_t *af = &radio->af;
+    if (cancel) {
+        if (radio->async.state == 1 || radio->async.state == 3 || radio->async.state == 5) {
+            fm_finish_tune(radio);
+            fm_read_tuned_frequency(radio, false);
+        }
+        fm_af_restore_mute(radio);
+        return (fm_async_progress_t){.done = true, -1};
+    }
+
+    switch (radio->async.state) {
+    case 1: // tuning to alternative
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, true);
+        radio->async.state = 2;
+        radio->async.resume_time = time_us_64() + af->config.dwell_ms * 1000;
+        return (fm_async_progress_t){.done = false};
+    case 2: { // sampling alternative
+        if (time_us_64() < radio->async.resume_time) {
+            return (fm_async_progress_t){.done = false}; // woken by interrupt during dwell
+        }
+        fm_read_single_register(radio, 0xB);
+        uint8_t rssi = (uint8_t)fm_get_bits(regs[0xB], RSSI);
+        if (af->best_rssi <= rssi) {
+            af->best_rssi = rssi;
+            af->best_index = af->index;
+        }
+        af->index = fm_af_next_candidate(radio, af->index + 1);
+        if (af->index < af->count) {
+            fm_start_tune_khz(radio, af->frequencies_khz[af->index]);
+            radio->async.state = 1;
+        } else if (af->best_index < af->count) {
+            fm_start_tune_khz(radio, af->frequencies_khz[af->best_index]);
+            radio->async.state = 3;
+        } else {
+            fm_start_tune_khz(radio, af->original_frequency_khz);
+            radio->async.state = 5;
+        }
+        return (fm_async_progress_t){.done = false};
+    }
+    case 3: // tuning to best alternative
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, true);
+        radio->async.state = 4;
+        af->pi_timeout_time = time_us_64() + af->config.pi_timeout_ms * 1000;
+        radio->async.resume_time = time_us_64() + AF_PI_POLL_INTERVAL_MS * 1000;
+        return (fm_async_progress_t){.done = false};
+    case 4: { // verifying PI code
+        uint16_t pi;
+        bool has_pi = fm_poll_pi(radio, &pi);
+        if (has_pi && pi == af->pi) {
+            fm_af_restore_mute(radio);
+            return (fm_async_progress_t){.done = true, 0};
+        }
+        if (has_pi || af->pi_timeout_time <= time_us_64()) {
+            // another station, or no RDS
+            fm_start_tune_khz(radio, af->original_frequency_khz);
+            radio->async.state = 5;
+            return (fm_async_progress_t){.done = false};
+        }
+        radio->async.resume_time = time_us_64() + AF_PI_POLL_INTERVAL_MS * 1000;
+        return (fm_async_progress_t){.done = false};
+    }
+    case 5: // restoring original frequency
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, true);
+        fm_af_restore_mute(radio);
+        return (fm_async_progress_t){.done = true, -1};
+    default: // nothing to probe
+        assert(radio->async.state == 6);
+        return (fm_async_progress_t){.done = true, -1};
+    }
 }
 
-bool fm_seek_blocking(rda5807_t *radio, fm_seek_direction_t direction) {
+bool fm_probe_af_blocking(rda5807_t *radio, const uint32_t *frequencies_khz, size_t count, uint16_t pi, fm_af_config_t config) {
     assert(fm_is_powered_up(radio));
     assert(radio->async.task == NULL); // disallowed during async task
 
-    fm_seek_async(radio, direction);
+    fm_probe_af_async(radio, frequencies_khz, count, pi, config);
     fm_async_progress_t progress;
     do {
-        sleep_ms(SEEK_POLL_INTERVAL_MS);
+        fm_async_task_wait(radio);
         progress = fm_async_task_tick(radio);
     } while (!progress.done);
     bool success = (progress.result == 0);
     return success;
 }
 
-static fm_async_progress_t fm_seek_async_task(rda5807_t *radio, bool cancel) {
-    assert(radio->async.task == &fm_seek_async_task);
-    assert(radio->async.state == 1);
+void fm_probe_af_async(rda5807_t *radio, const uint32_t *frequencies_khz, size_t count, uint16_t pi, fm_af_config_t config) {
+    assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+    assert(count <= UINT8_MAX);
 
-    i2c_inst_t *i2c_inst = radio->i2c_inst;
+    radio->async.i2c_failed = false;
     uint16_t *regs = radio->regs;
-    int result = 0;
+    fm_af_state_t *af = &radio->af;
+    af->config = config;
+    af->frequencies_khz = frequencies_khz;
+    af->count = count;
+    af->pi = pi;
+    af->original_frequency_khz = radio->frequency_khz;
+    af->original_mute = fm_get_mute(radio);
+    fm_read_single_register(radio, 0xB);
+    af->best_rssi = (uint8_t)fm_get_bits(regs[0xB], RSSI) + config.min_rssi_gain;
+    af->best_index = count;
+    af->index = fm_af_next_candidate(radio, 0);
+
+    radio->async.task = fm_probe_af_async_task;
+    radio->async.locked_commands = 1 << FM_COMMAND_MUTE; // restored after probing
+    if (af->index == count) {
+        radio->async.state = 6; // nothing to probe, done on the first tick
+        radio->async.resume_time = 0;
+        return;
+    }
+    fm_set_bit(regs[0x2], DMUTE, false);
+    fm_write_single_register(radio, 0x2);
+    fm_start_tune_khz(radio, af->frequencies_khz[af->index]);
+    radio->async.state = 1;
+}
+#endif // FM_RDA5807_AF_ENABLE
+
+#if FM_RDA5807_TRACKER_ENABLE
+static void fm_tracker_update_ranking(fm_tracker_t *tracker) {
+    // insertion sort, strongest first, stations not sampled yet last
+    uint8_t *ranking = tracker->ranking;
+    for (size_t i = 1; i < tracker->count; i++) {
+        uint8_t index = ranking[i];
+        const fm_tracked_station_t *station = &tracker->stations[index];
+        size_t j = i;
+        for (; 0 < j; j--) {
+            const fm_tracked_station_t *other = &tracker->stations[ranking[j - 1]];
+            bool stronger = (station->sample_time != 0)
+                && (other->sample_time == 0 || other->rssi < station->rssi);
+            if (!stronger) {
+                break;
+            }
+            ranking[j] = ranking[j - 1];
+        }
+        ranking[j] = index;
+    }
+}
+
+static void fm_track_sample(rda5807_t *radio) {
+    // record the signal of the station being visited, refreshing registers 0xA..0xB
+    fm_track_state_t *track = &radio->track;
+    fm_tracked_station_t *station = &track->tracker->stations[track->index];
+    const fm_quality_t *quality = fm_get_quality(radio);
+    station->rssi = quality->rssi;
+    station->flags = (quality->stereo ? FM_STATION_STEREO : 0) | (quality->fm_true ? FM_STATION_FM_TRUE : 0);
+    station->sample_time = time_us_64();
+}
+
+static fm_async_progress_t fm_track_finish(rda5807_t *radio) {
+    fm_track_state_t *track = &radio->track;
+    fm_tracker_t *tracker = track->tracker;
+    fm_tracker_update_ranking(tracker);
+    tracker->next_index = (track->index + 1) % tracker->count;
+    tracker->next_visit_time = time_us_64() + tracker->config.interval_ms * 1000;
+    return (fm_async_progress_t){.done = true, track->index};
+}
+
+static void fm_track_restore_mute(rda5807_t *radio) {
+    uint16_t *regs = radio->regs;
+    fm_set_bit(regs[0x2], DMUTE, !radio->track.original_mute);
+    fm_write_single_register(radio, 0x2);
+}
+
+static void fm_track_start_restore(rda5807_t *radio) {
+    fm_start_tune_khz(radio, radio->track.original_frequency_khz);
+    radio->async.state = 4;
+}
+
+static fm_async_progress_t fm_track_stations_async_task(rda5807_t *radio, bool cancel) {
+    assert(radio->async.task == &fm_track_stations_async_task);
+
+    fm_track_state_t *track = &radio->track;
+    const fm_tracker_config_t *config = &track->tracker->config;
     if (cancel) {
-        result = -1;
-    } else {
-        fm_read_single_register(i2c_inst, regs, 0xA);
-        if (!fm_get_bit(regs[0xA], STC)) {
-            uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
-            radio->frequency = fm_channel_to_frequency(channel, radio->frequency_range);
-            radio->async.resume_time = time_us_64() + SEEK_POLL_INTERVAL_MS * 1000;
-            return (fm_async_progress_t){.done = false};
+        if (radio->async.state == 1 || radio->async.state == 4) {
+            fm_finish_tune(radio);
+            fm_read_tuned_frequency(radio, false);
+        }
+        if (radio->async.state != 5) {
+            fm_track_restore_mute(radio);
         }
+        return (fm_async_progress_t){.done = true, -1};
+    }
 
-        // seek done, check seek-failed flag
-        if (fm_get_bit(regs[0xA], SF)) {
-            result = -1;
+    switch (radio->async.state) {
+    case 1: // tuning to station
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
+        }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, true);
+        radio->async.state = 2;
+        radio->async.resume_time = time_us_64() + config->dwell_ms * 1000;
+        return (fm_async_progress_t){.done = false};
+    case 2: // sampling station
+        if (time_us_64() < radio->async.resume_time) {
+            return (fm_async_progress_t){.done = false}; // woken by interrupt during dwell
+        }
+        fm_track_sample(radio);
+        if (config->pi_timeout_ms != 0 && config->min_pi_rssi <= radio->quality.rssi) {
+            radio->async.state = 3;
+            track->pi_timeout_time = time_us_64() + config->pi_timeout_ms * 1000;
+            radio->async.resume_time = time_us_64() + AF_PI_POLL_INTERVAL_MS * 1000;
+        } else {
+            fm_track_start_restore(radio);
+        }
+        return (fm_async_progress_t){.done = false};
+    case 3: { // waiting for PI code
+        uint16_t pi;
+        if (fm_poll_pi(radio, &pi)) {
+            track->tracker->stations[track->index].pi = pi;
+            fm_track_start_restore(radio);
+        } else if (track->pi_timeout_time <= time_us_64()) {
+            fm_track_start_restore(radio); // keep the last known PI
+        } else {
+            radio->async.resume_time = time_us_64() + AF_PI_POLL_INTERVAL_MS * 1000;
+        }
+        return (fm_async_progress_t){.done = false};
+    }
+    case 4: // restoring original frequency
+        if (!fm_poll_tune_complete(radio)) {
+            return (fm_async_progress_t){.done = false};
         }
+        fm_finish_tune(radio);
+        fm_read_tuned_frequency(radio, true);
+        fm_track_restore_mute(radio);
+        return fm_track_finish(radio);
+    default: // sampled in place
+        assert(radio->async.state == 5);
+        return fm_track_finish(radio);
     }
+}
 
-    // clear seek bit
-    fm_set_bit(regs[0x2], SEEK, false);
-    fm_write_single_register(i2c_inst, regs, 0x2);
+void fm_tracker_init(fm_tracker_t *tracker, const uint32_t *frequencies_khz, size_t count, fm_tracker_config_t config) {
+    assert(0 < count && count <= FM_TRACKER_MAX_STATIONS);
 
-    fm_read_single_register(i2c_inst, regs, 0xA);
-    uint16_t channel = fm_get_bits(regs[0xA], READCHAN);
-    radio->frequency = fm_channel_to_frequency(channel, radio->frequency_range);
-    return (fm_async_progress_t){.done = true, result};
+    memset(tracker, 0, sizeof(fm_tracker_t));
+    tracker->config = config;
+    tracker->count = count;
+    for (size_t i = 0; i < count; i++) {
+        tracker->stations[i].frequency_khz = frequencies_khz[i];
+        tracker->ranking[i] = i;
+    }
 }
 
-void fm_seek_async(rda5807_t *radio, fm_seek_direction_t direction) {
+bool fm_tracker_is_due(const fm_tracker_t *tracker) {
+    return tracker->next_visit_time <= time_us_64();
+}
+
+int fm_tracker_find_best(const fm_tracker_t *tracker, uint16_t pi) {
+    for (size_t i = 0; i < tracker->count; i++) {
+        uint8_t index = tracker->ranking[i];
+        if (tracker->stations[index].pi == pi) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+void fm_track_stations_async(rda5807_t *radio, fm_tracker_t *tracker) {
     assert(fm_is_powered_up(radio));
     assert(radio->async.task == NULL); // disallowed during async task
 
+    radio->async.i2c_failed = false;
+    fm_track_state_t *track = &radio->track;
+    track->tracker = tracker;
+    track->index = tracker->next_index;
+    track->original_frequency_khz = radio->frequency_khz;
+    track->original_mute = fm_get_mute(radio);
+
+    radio->async.task = fm_track_stations_async_task;
+    radio->async.locked_commands = 1 << FM_COMMAND_MUTE; // restored after the visit
+    uint32_t frequency_khz = tracker->stations[track->index].frequency_khz;
+    fm_frequency_range_khz_t range = radio->frequency_range;
+    if (frequency_khz == radio->frequency_khz || frequency_khz < range.bottom || range.top < frequency_khz) {
+        if (frequency_khz == radio->frequency_khz) {
+            fm_track_sample(radio);
+        }
+        radio->async.state = 5; // done on the first tick
+        radio->async.resume_time = 0;
+        return;
+    }
     uint16_t *regs = radio->regs;
-    fm_set_bit(regs[0x2], SKMODE, false); // wrap mode
-    fm_set_bit(regs[0x2], SEEKUP, direction == FM_SEEK_UP);
-    fm_set_bit(regs[0x2], SEEK, true); // start seek
-    fm_write_single_register(radio->i2c_inst, regs, 0x2);
-
-    radio->async.task = fm_seek_async_task;
+    fm_set_bit(regs[0x2], DMUTE, false);
+    fm_write_single_register(radio, 0x2);
+    fm_start_tune_khz(radio, frequency_khz);
     radio->async.state = 1;
-    radio->async.resume_time = time_us_64() + SEEK_POLL_INTERVAL_MS * 1000;
+}
+#endif // FM_RDA5807_TRACKER_ENABLE
+
+#if FM_RDA5807_SCAN_ENABLE
+size_t fm_get_scan_station_count(rda5807_t *radio) {
+    return radio->scan.count;
+}
+#endif
+
+float fm_get_channel_frequency(rda5807_t *radio, uint16_t channel) {
+    return fm_khz_to_mhz(fm_get_channel_frequency_khz(radio, channel));
+}
+
+uint32_t fm_get_channel_frequency_khz(rda5807_t *radio, uint16_t channel) {
+    return fm_channel_to_frequency_khz(channel, radio->frequency_range);
 }
 
 bool fm_get_mute(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     return radio->mute;
+#else
+    return !fm_get_bit(radio->regs[0x2], DMUTE);
+#endif
 }
 
-void fm_set_mute(rda5807_t *radio, bool mute) {
+bool fm_set_mute(rda5807_t *radio, bool mute) {
     assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
 
-    if (radio->mute == mute) {
-        return;
+    if (fm_is_command_locked(radio, FM_COMMAND_MUTE)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_MUTE, mute);
+    }
+    if (fm_get_mute(radio) == mute) {
+        return true;
     }
     uint16_t *regs = radio->regs;
     fm_set_bit(regs[0x2], DMUTE, !mute);
-    fm_write_single_register(radio->i2c_inst, regs, 0x2);
-    radio->mute = mute;
+    fm_store_setting(radio, mute, mute);
+    return fm_update_register(radio, 0x2);
 }
 
 bool fm_get_softmute(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     return radio->softmute;
+#else
+    return fm_get_bit(radio->regs[0x4], SOFTMUTE_EN);
+#endif
 }
 
-void fm_set_softmute(rda5807_t *radio, bool softmute) {
+bool fm_set_softmute(rda5807_t *radio, bool softmute) {
     assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
 
-    if (radio->softmute == softmute) {
-        return;
+    if (fm_is_command_locked(radio, FM_COMMAND_SOFTMUTE)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_SOFTMUTE, softmute);
+    }
+    if (fm_get_softmute(radio) == softmute) {
+        return true;
     }
     uint16_t *regs = radio->regs;
     fm_set_bit(regs[0x4], SOFTMUTE_EN, softmute);
-    fm_write_registers_up_to(radio->i2c_inst, regs, 0x4);
-    radio->softmute = softmute;
+    fm_store_setting(radio, softmute, softmute);
+    return fm_update_register(radio, 0x4);
 }
 
 bool fm_get_bass_boost(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     return radio->bass_boost;
+#else
+    return fm_get_bit(radio->regs[0x2], BASS);
+#endif
 }
 
-void fm_set_bass_boost(rda5807_t *radio, bool bass_boost) {
+bool fm_set_bass_boost(rda5807_t *radio, bool bass_boost) {
     assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
 
-    if (radio->bass_boost == bass_boost) {
-        return;
+    if (fm_is_command_locked(radio, FM_COMMAND_BASS_BOOST)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_BASS_BOOST, bass_boost);
+    }
+    if (fm_get_bass_boost(radio) == bass_boost) {
+        return true;
     }
     uint16_t *regs = radio->regs;
     fm_set_bit(regs[0x2], BASS, bass_boost);
-    fm_write_single_register(radio->i2c_inst, regs, 0x2);
-    radio->bass_boost = bass_boost;
+    fm_store_setting(radio, bass_boost, bass_boost);
+    return fm_update_register(radio, 0x2);
 }
 
 bool fm_get_mono(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     return radio->mono;
+#else
+    return fm_get_bit(radio->regs[0x2], MONO);
+#endif
 }
 
-void fm_set_mono(rda5807_t *radio, bool mono) {
+bool fm_set_mono(rda5807_t *radio, bool mono) {
     assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
 
-    if (radio->mono == mono) {
-        return;
+    if (fm_is_command_locked(radio, FM_COMMAND_MONO)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_MONO, mono);
+    }
+    if (fm_get_mono(radio) == mono) {
+        return true;
     }
     uint16_t *regs = radio->regs;
     fm_set_bit(regs[0x2], MONO, mono);
-    fm_write_single_register(radio->i2c_inst, regs, 0x2);
-    radio->mono = mono;
+    fm_store_setting(radio, mono, mono);
+    return fm_update_register(radio, 0x2);
 }
 
 uint8_t fm_get_volume(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     return radio->volume;
+#else
+    return fm_get_bits(radio->regs[0x5], VOLUME);
+#endif
 }
 
-void fm_set_volume(rda5807_t *radio, uint8_t volume) {
+bool fm_set_volume(rda5807_t *radio, uint8_t volume) {
     assert(fm_is_powered_up(radio));
-    assert(radio->async.task == NULL); // disallowed during async task
 
+    if (fm_is_command_locked(radio, FM_COMMAND_VOLUME)) {
+        // applied once the async task is done
+        return fm_defer_command(radio, FM_COMMAND_VOLUME, volume);
+    }
     volume = MIN(volume, FM_MAX_VOLUME);
-    if (volume == radio->volume) {
-        return;
+    if (volume == fm_get_volume(radio)) {
+        return true;
     }
     uint16_t *regs = radio->regs;
     fm_set_bits(regs[0x5], VOLUME, volume);
-    fm_write_single_register(radio->i2c_inst, regs, 0x5);
-    radio->volume = volume;
+    fm_store_setting(radio, volume, volume);
+    return fm_update_register(radio, 0x5);
+}
+
+void fm_set_quality_period(rda5807_t *radio, uint16_t period_ms) {
+    radio->quality_period_us = period_ms * 1000;
+}
+
+const fm_quality_t *fm_get_quality(rda5807_t *radio) {
+    assert(fm_is_powered_up(radio));
+
+    fm_quality_t *quality = &radio->quality;
+    if (quality->sample_time == 0 || quality->sample_time + radio->quality_period_us <= time_us_64()) {
+        fm_read_registers_up_to(radio, 0xB); // samples on success
+    }
+    return quality;
+}
+
+size_t fm_get_rssi_history(rda5807_t *radio, uint8_t *rssi, size_t capacity) {
+    const fm_quality_t *quality = &radio->quality;
+    size_t count = MIN(capacity, quality->history_count);
+    size_t index = (quality->history_head + FM_QUALITY_HISTORY_SIZE - count) % FM_QUALITY_HISTORY_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        rssi[i] = quality->rssi_history[index];
+        index = (index + 1) % FM_QUALITY_HISTORY_SIZE;
+    }
+    return count;
 }
 
 uint8_t fm_get_rssi(rda5807_t *radio) {
+    return fm_get_quality(radio)->rssi;
+}
+
+bool fm_get_stereo_indicator(rda5807_t *radio) {
+    return fm_get_quality(radio)->stereo;
+}
+
+bool fm_read_rds_group(rda5807_t *radio, uint16_t *blocks) {
     assert(fm_is_powered_up(radio));
 
+    if (!fm_take_rds_interrupt(radio)) {
+        fm_resync_if_due(radio);
+        return false; // not ready, skip polling
+    }
+    fm_read_registers_up_to(radio, 0xF);
+    if (!fm_copy_rds_group(radio, blocks)) {
+        fm_resync_if_due(radio);
+        return false;
+    }
+    return true;
+}
+
+uint8_t fm_get_rds_block_errors(rda5807_t *radio) {
     uint16_t *regs = radio->regs;
-    fm_read_single_register(radio->i2c_inst, regs, 0xB);
-    uint8_t rssi = (uint8_t)fm_get_bits(regs[0xB], RSSI);
-    return rssi;
+    uint8_t blera = fm_get_bits(regs[0xB], BLERA);
+    uint8_t blerb = fm_get_bits(regs[0xB], BLERB);
+    return blera | (blerb << 2) | (blerb << 4) | (blerb << 6);
 }
 
-bool fm_get_stereo_indicator(rda5807_t *radio) {
+bool fm_get_rds_sync(rda5807_t *radio) {
+    return fm_get_bit(radio->regs[0xA], RDSS);
+}
+
+bool fm_get_rds_fifo(rda5807_t *radio) {
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
+    return radio->rds_fifo;
+#else
+    return fm_get_bit(radio->regs[0x4], RDS_FIFO_EN);
+#endif
+}
+
+void fm_set_rds_fifo(rda5807_t *radio, bool rds_fifo) {
     assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
 
+    if (fm_get_rds_fifo(radio) == rds_fifo) {
+        return;
+    }
     uint16_t *regs = radio->regs;
-    fm_read_single_register(radio->i2c_inst, regs, 0xA);
-    bool stereo = fm_get_bit(regs[0xA], ST);
-    return stereo;
+    fm_set_bit(regs[0x4], RDS_FIFO_EN, rds_fifo);
+    fm_set_bit(regs[0x4], RDS_FIFO_CLR, rds_fifo);
+    fm_write_single_register(radio, 0x4); // not batched, the clear pulse would be lost before the commit
+    fm_set_bit(regs[0x4], RDS_FIFO_CLR, false);
+    fm_store_setting(radio, rds_fifo, rds_fifo);
 }
 
-bool fm_read_rds_group(rda5807_t *radio, uint16_t *blocks) {
+size_t fm_read_rds_groups(rda5807_t *radio, uint16_t *groups, size_t max_groups) {
+    assert(fm_is_powered_up(radio));
+
+    if (!fm_take_rds_interrupt(radio)) {
+        fm_resync_if_due(radio);
+        return 0; // not ready, skip polling
+    }
+    // without FIFO only the latest group is available
+    size_t n = fm_get_rds_fifo(radio) ? max_groups : MIN(max_groups, 1);
+    size_t count = 0;
+    while (count < n) {
+        if (!fm_read_registers_up_to(radio, 0xF)) {
+            break;
+        }
+        if (!fm_copy_rds_group(radio, groups + 4 * count)) {
+            break; // RDSR clear, FIFO empty
+        }
+        count++;
+    }
+    fm_resync_if_due(radio); // drained
+    return count;
+}
+
+bool fm_resync_registers(rda5807_t *radio) {
     assert(fm_is_powered_up(radio));
+    assert(radio->async.task == NULL); // disallowed during async task
+    assert(!radio->update_pending);
 
     uint16_t *regs = radio->regs;
-    fm_read_registers_up_to(radio->i2c_inst, regs, 0xF);
-    bool rdsr = fm_get_bit(regs[0xA], RDSR);
-    if (!rdsr) {
-        return false; // not ready
+    uint64_t now = time_us_64();
+    radio->next_resync_time = now + radio->resync_period_us;
+    switch (radio->resync_state) {
+    case FM_RESYNC_RETUNE:
+        // chip has started after the repair, CHAN in the shadow is stale after a seek or scan
+        fm_start_tune_khz(radio, radio->frequency_khz);
+        radio->resync_state = FM_RESYNC_FINISH_TUNE;
+        radio->next_resync_time = now + TUNE_POLL_INTERVAL_MS * 1000;
+        return false;
+    case FM_RESYNC_FINISH_TUNE:
+        fm_read_single_register(radio, 0xA);
+        if (fm_get_bit(regs[0xA], STC)) {
+            fm_finish_tune(radio);
+            radio->resync_state = FM_RESYNC_IDLE;
+        } else {
+            radio->next_resync_time = now + TUNE_POLL_INTERVAL_MS * 1000;
+        }
+        return false;
+    default:
+        break;
+    }
+
+    // random access reads continue into the following registers
+    uint8_t addr_buf[1] = {0x2};
+    uint8_t buf[7 * sizeof(uint16_t)];
+    if (!fm_transfer(radio, radio->i2c_addr_random_access, addr_buf, 1, buf, sizeof(buf))) {
+        return false;
+    }
+    uint16_t chip_regs[7];
+    fm_decode_registers(chip_regs, buf, sizeof(buf));
+    static const uint16_t SELF_CLEARING_BITS[7] = {SEEK_BIT | SOFT_RESET_BIT, TUNE_BIT};
+    bool repaired = false;
+    for (size_t i = 0; i < count_of(chip_regs); i++) {
+        if ((chip_regs[i] ^ regs[0x2 + i]) & ~SELF_CLEARING_BITS[i]) {
+            repaired = true;
+        }
+    }
+    fm_stats_resync(radio, repaired);
+    if (!repaired) {
+        return false;
+    }
+    fm_write_registers_up_to(radio, 0x8);
+    // retune if the chip lost power, or channel / direct frequency
+    bool lost_power = !fm_get_bit(chip_regs[0x2 - 0x2], ENABLE);
+    bool direct_mode = fm_get_bit(regs[0x7], FREQ_MODE);
+    bool lost_tuning = ((chip_regs[0x3 - 0x2] ^ regs[0x3]) & ~TUNE_BIT)
+        || ((chip_regs[0x7 - 0x2] ^ regs[0x7]) & (FREQ_MODE_BIT | BAND_65M_50M_MODE_BIT))
+        || (direct_mode && chip_regs[0x8 - 0x2] != regs[0x8]);
+    if (radio->frequency_khz != 0 && (lost_power || lost_tuning)) {
+        radio->resync_state = FM_RESYNC_RETUNE;
+        radio->next_resync_time = now + RESYNC_RETUNE_DELAY_MS * 1000;
+    }
+    return true;
+}
+
+void fm_set_resync_period(rda5807_t *radio, uint32_t period_ms) {
+    radio->resync_period_us = period_ms * 1000;
+    radio->next_resync_time = time_us_64() + radio->resync_period_us;
+}
+
+void fm_enable_dma(rda5807_t *radio, uint8_t tx_dma_channel, uint8_t rx_dma_channel) {
+    assert(!radio->transport.dma_enabled);
+
+    fm_transport_t *transport = &radio->transport;
+    transport->dma_enabled = true;
+    transport->tx_dma_channel = tx_dma_channel;
+    transport->rx_dma_channel = rx_dma_channel;
+    transport->status = FM_TRANSFER_IDLE;
+    i2c_get_hw(radio->i2c_inst)->dma_cr = I2C_IC_DMA_CR_TDMAE_BITS | I2C_IC_DMA_CR_RDMAE_BITS;
+}
+
+bool fm_start_read_rds_group(rda5807_t *radio) {
+    assert(fm_is_powered_up(radio));
+
+    return fm_begin_read_registers_up_to(radio, 0xF);
+}
+
+bool fm_start_read_rssi(rda5807_t *radio) {
+    assert(fm_is_powered_up(radio));
+
+    return fm_begin_read_registers_up_to(radio, 0xB);
+}
+
+bool fm_is_read_done(rda5807_t *radio) {
+    if (radio->transport.dma_enabled) {
+        if (fm_dma_poll(radio) == FM_TRANSFER_BUSY) {
+            return false;
+        }
+        fm_dma_complete(radio);
     }
-    memcpy(blocks, regs + 0xC, 4 * sizeof(uint16_t));
     return true;
 }
 
+bool fm_finish_read_rds_group(rda5807_t *radio, uint16_t *blocks) {
+    bool done = fm_is_read_done(radio); // also completes the DMA transfer, so not inside assert()
+    assert(done); // must be called once the read is done
+    (void)done;
+
+    bool success = (radio->transport.status == FM_TRANSFER_DONE);
+    radio->transport.status = FM_TRANSFER_IDLE;
+    return success && fm_copy_rds_group(radio, blocks);
+}
+
+bool fm_finish_read_rssi(rda5807_t *radio, uint8_t *rssi) {
+    bool done = fm_is_read_done(radio); // also completes the DMA transfer, so not inside assert()
+    assert(done); // must be called once the read is done
+    (void)done;
+
+    bool success = (radio->transport.status == FM_TRANSFER_DONE);
+    radio->transport.status = FM_TRANSFER_IDLE;
+    if (success) {
+        *rssi = (uint8_t)fm_get_bits(radio->regs[0xB], RSSI); // registers are only decoded on success
+    }
+    return success;
+}
+
 fm_async_progress_t fm_async_task_tick(rda5807_t *radio) {
     assert(radio->async.task != NULL); // must have an async task running
 
-    if (time_us_64() < radio->async.resume_time) {
+    if (!fm_async_task_is_due(radio)) {
         // skip until resume time
         return (fm_async_progress_t){.done = false};
     }
+    radio->interrupt_pending = false; // handled by this tick, so a stale edge can't wake the next poll early
+#if FM_RDA5807_STATS_ENABLE
+    uint64_t start_time = time_us_64();
+    fm_async_progress_t progress = radio->async.task(radio, false /* cancel */);
+    radio->stats.async_ticks++;
+    radio->stats.async_tick_us += time_us_64() - start_time;
+#else
     fm_async_progress_t progress = radio->async.task(radio, false /* cancel */);
+#endif
+    if (radio->async.i2c_failed) {
+        if (!progress.done) {
+            radio->async.task(radio, true /* cancel */);
+        }
+        progress = (fm_async_progress_t){.done = true, FM_RESULT_I2C_ERROR};
+    }
     if (progress.done) {
         radio->async = (fm_async_state_t){};
+        fm_run_commands(radio, true /* start_tasks */);
     }
     return progress;
 }
@@ -592,4 +2514,92 @@ void fm_async_task_cancel(rda5807_t *radio) {
 
     radio->async.task(radio, true /* cancel */);
     radio->async = (fm_async_state_t){};
+    fm_run_commands(radio, false /* start_tasks */);
+}
+
+bool fm_enqueue_frequency_khz(rda5807_t *radio, uint32_t frequency_khz) {
+    assert(fm_is_powered_up(radio));
+
+    if (radio->async.task == NULL) {
+        fm_set_frequency_khz_async(radio, frequency_khz);
+        return true;
+    }
+    return fm_push_command(radio, FM_COMMAND_FREQUENCY, frequency_khz);
+}
+
+#if FM_RDA5807_SEEK_ENABLE
+bool fm_enqueue_seek(rda5807_t *radio, fm_seek_direction_t direction) {
+    assert(fm_is_powered_up(radio));
+
+    if (radio->async.task == NULL) {
+        fm_seek_async(radio, direction);
+        return true;
+    }
+    return fm_push_command(radio, FM_COMMAND_SEEK, direction);
+}
+#endif // FM_RDA5807_SEEK_ENABLE
+
+size_t fm_get_queued_command_count(rda5807_t *radio) {
+    return radio->command_queue.count;
+}
+
+bool fm_async_task_is_running(rda5807_t *radio) {
+    return radio->async.task != NULL;
+}
+
+bool fm_async_task_is_due(rda5807_t *radio) {
+    assert(radio->async.task != NULL); // must have an async task running
+
+    bool interrupted = radio->interrupt_enabled && fm_is_interrupt_pending(radio);
+    return interrupted || radio->async.resume_time <= time_us_64();
+}
+
+uint64_t fm_async_task_get_resume_time(rda5807_t *radio) {
+    assert(radio->async.task != NULL); // must have an async task running
+
+    return radio->async.resume_time;
+}
+
+#if FM_RDA5807_STATS_ENABLE
+const fm_stats_t *fm_get_stats(rda5807_t *radio) {
+    return &radio->stats;
+}
+
+void fm_reset_stats(rda5807_t *radio) {
+    radio->stats = (fm_stats_t){};
+}
+#endif // FM_RDA5807_STATS_ENABLE
+
+void fm_histogram_add(fm_histogram_t *histogram, uint64_t duration_us) {
+    uint32_t us = (uint32_t)MIN(duration_us, UINT32_MAX);
+    size_t bucket = 0;
+    for (uint32_t v = us; v > 1 && bucket < FM_HISTOGRAM_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    histogram->buckets[bucket]++;
+    if (histogram->count == 0 || us < histogram->min_us) {
+        histogram->min_us = us;
+    }
+    histogram->max_us = MAX(histogram->max_us, us);
+    histogram->total_us += us;
+    histogram->count++;
+}
+
+uint32_t fm_histogram_percentile_us(const fm_histogram_t *histogram, uint8_t percent) {
+    assert(percent <= 100);
+
+    if (histogram->count == 0) {
+        return 0;
+    }
+    uint64_t rank = ((uint64_t)histogram->count * percent + 99) / 100; // 1-based, rounded up
+    rank = MAX(rank, 1);
+    uint32_t seen = 0;
+    for (size_t bucket = 0; bucket < FM_HISTOGRAM_BUCKETS; bucket++) {
+        seen += histogram->buckets[bucket];
+        if (rank <= seen) {
+            uint32_t upper_us = (2u << bucket) - 1;
+            return MIN(MAX(upper_us, histogram->min_us), histogram->max_us);
+        }
+    }
+    return histogram->max_us;
 }
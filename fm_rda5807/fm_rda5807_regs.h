@@ -59,6 +59,7 @@
 #define RDS_FIFO_EN_BIT     (1 << 12) // default: 0
 #define RBDS_BIT            (1 << 13) // default: 0
 #define STCIEN_BIT          (1 << 14) // default: 0
+#define RDSIEN_BIT          (1 << 15) // default: 0
 
 // Register 0x5 - default: 0x888B
 #define VOLUME_LSB          0 // default: 0b1011
@@ -8,7 +8,9 @@
 #define _RDA5807_H_
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include <fm_rda5807_config.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -102,6 +104,16 @@ typedef struct fm_frequency_range_t
     float spacing; // MHz
 } fm_frequency_range_t;
 
+/**
+ * \brief Frequency range in kHz corresponding to an fm_band_t.
+ */
+typedef struct fm_frequency_range_khz_t
+{
+    uint32_t bottom; // kHz
+    uint32_t top; // kHz
+    uint32_t spacing; // kHz
+} fm_frequency_range_khz_t;
+
 /**
  * \brief Direction of seek.
  */
@@ -120,8 +132,121 @@ typedef struct fm_async_progress_t
     int result;
 } fm_async_progress_t;
 
+/**
+ * \brief Async task result when the chip stopped answering on the I2C bus.
+ *
+ * Reported after FM_I2C_RETRIES retries of a transaction have failed. The task is cancelled,
+ * and the register shadow may no longer match the chip.
+ */
+#define FM_RESULT_I2C_ERROR (-2)
+
+/**
+ * \brief Seek settings.
+ */
+typedef struct fm_seek_config_t
+{
+    bool wrap; // continue from the other end of the band, otherwise fail at the band edge
+    bool rssi_mode; // chip also requires rssi_threshold to stop (SEEK_MODE 0b10)
+    uint8_t rssi_threshold; // old seek method threshold, up to 63 (SEEK_TH_OLD)
+    bool require_fm_true; // seek on past stops not detected as a real station
+    uint8_t min_rssi; // seek on past weaker stops, 0 to accept any
+    uint8_t max_continues; // false stops skipped before the seek fails
+    uint16_t poll_interval_ms; // progress poll without interrupts, large to reduce electrical interference from I2C
+} fm_seek_config_t;
+
+static inline fm_seek_config_t fm_seek_config_default() {
+    // plain chip seek
+    return (fm_seek_config_t){true, false, 49, false, 0, 8, 200};
+}
+
+/**
+ * \brief Station found by a band scan.
+ */
+typedef struct fm_station_t
+{
+    uint16_t channel; // channel index in the frequency range
+    uint8_t rssi;
+    uint8_t flags; // FM_STATION_xxx
+} fm_station_t;
+
+#define FM_STATION_STEREO 0x01 // stereo signal detected
+#define FM_STATION_FM_TRUE 0x02 // detected as a real station by the chip
+
+/**
+ * \brief Band scan settings.
+ */
+typedef struct fm_scan_config_t
+{
+    uint8_t min_rssi; // weaker channels are skipped
+    uint8_t dwell_ms; // settling time on each channel before sampling
+    bool require_fm_true; // skip channels not detected as a real station
+} fm_scan_config_t;
+
+static inline fm_scan_config_t fm_scan_config_default() {
+    return (fm_scan_config_t){20, 20, true};
+}
+
+/**
+ * \brief Alternative frequency probe settings.
+ */
+typedef struct fm_af_config_t
+{
+    uint8_t min_rssi_gain; // an alternative must beat the current RSSI by this much
+    uint8_t dwell_ms; // settling time on each alternative before sampling RSSI
+    uint16_t pi_timeout_ms; // how long to wait for the PI code on the best alternative
+} fm_af_config_t;
+
+static inline fm_af_config_t fm_af_config_default() {
+    return (fm_af_config_t){6, 5, 250};
+}
+
+/**
+ * \brief Station tracker settings.
+ */
+typedef struct fm_tracker_config_t
+{
+    uint16_t interval_ms; // between visits, each visit samples one station
+    uint8_t dwell_ms; // settling time on the station before sampling RSSI
+    uint16_t pi_timeout_ms; // how long to wait for the PI code, 0 to only sample RSSI
+    uint8_t min_pi_rssi; // don't wait for PI on weaker stations
+} fm_tracker_config_t;
+
+static inline fm_tracker_config_t fm_tracker_config_default() {
+    return (fm_tracker_config_t){5000, 5, 250, 20};
+}
+
+/**
+ * \brief Station followed by a tracker.
+ */
+typedef struct fm_tracked_station_t
+{
+    uint32_t frequency_khz;
+    uint16_t pi; // last PI code received, 0 if unknown
+    uint8_t rssi; // last sample
+    uint8_t flags; // FM_STATION_xxx
+    uint64_t sample_time; // µs since boot, 0 if not sampled yet
+} fm_tracked_station_t;
+
+/**
+ * \brief Live ranking of a station table by signal, see fm_track_stations_async().
+ */
+typedef struct fm_tracker_t
+{
+    fm_tracker_config_t config;
+    fm_tracked_station_t stations[FM_TRACKER_MAX_STATIONS];
+    uint8_t ranking[FM_TRACKER_MAX_STATIONS]; // station indexes, strongest first
+    uint8_t count;
+    uint8_t next_index; // private, round robin cursor
+    uint64_t next_visit_time; // private
+} fm_tracker_t;
+
 struct rda5807_t;
 
+/**
+ * \brief Called from the GPIO interrupt handler when the chip raises an interrupt.
+ */
+typedef void (*fm_interrupt_callback_t)(struct rda5807_t *radio, void *user_data);
+
 // private
 typedef fm_async_progress_t (*fm_async_task_t)(struct rda5807_t *radio, bool cancel);
 
@@ -130,29 +255,239 @@ typedef struct fm_async_state_t
 {
     fm_async_task_t task;
     uint8_t state;
+    uint8_t locked_commands; // bitmask of fm_command_type_t that must wait for the task
+    bool i2c_failed; // a task transaction failed all retries, setting writes excluded
     uint64_t resume_time;
 } fm_async_state_t;
 
+// private
+typedef enum fm_resync_state_t
+{
+    FM_RESYNC_IDLE,
+    FM_RESYNC_RETUNE, // chip was repaired after losing power or tuning, retune once it has started
+    FM_RESYNC_FINISH_TUNE, // clear the tune bit after STC
+} fm_resync_state_t;
+
+// private
+typedef enum fm_command_type_t
+{
+    FM_COMMAND_FREQUENCY,
+    FM_COMMAND_SEEK,
+    FM_COMMAND_VOLUME,
+    FM_COMMAND_MUTE,
+    FM_COMMAND_SOFTMUTE,
+    FM_COMMAND_BASS_BOOST,
+    FM_COMMAND_MONO,
+    FM_COMMAND_SEEK_THRESHOLD,
+} fm_command_type_t;
+
+// private
+typedef struct fm_command_t
+{
+    uint8_t type; // fm_command_type_t
+    uint32_t value;
+} fm_command_t;
+
+// private
+typedef struct fm_command_queue_t
+{
+    fm_command_t commands[FM_COMMAND_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+} fm_command_queue_t;
+
+// private
+typedef struct fm_seek_state_t
+{
+    fm_seek_config_t config;
+    uint8_t continues; // false stops skipped so far
+} fm_seek_state_t;
+
+// private
+typedef struct fm_scan_state_t
+{
+    fm_scan_config_t config;
+    fm_station_t *stations;
+    uint16_t capacity;
+    uint16_t count;
+    uint16_t channel;
+    uint16_t last_channel;
+    uint32_t original_frequency_khz;
+    bool original_mute;
+} fm_scan_state_t;
+
+// private
+typedef struct fm_af_state_t
+{
+    fm_af_config_t config;
+    const uint32_t *frequencies_khz;
+    uint8_t count;
+    uint8_t index;
+    uint8_t best_index;
+    uint8_t best_rssi;
+    uint16_t pi;
+    uint32_t original_frequency_khz;
+    bool original_mute;
+    uint64_t pi_timeout_time;
+} fm_af_state_t;
+
+// private
+typedef struct fm_track_state_t
+{
+    fm_tracker_t *tracker;
+    uint8_t index;
+    uint32_t original_frequency_khz;
+    bool original_mute;
+    uint64_t pi_timeout_time;
+} fm_track_state_t;
+
+/**
+ * \brief Status of a non-blocking register transfer.
+ */
+typedef enum fm_transfer_status_t
+{
+    FM_TRANSFER_IDLE,
+    FM_TRANSFER_BUSY,
+    FM_TRANSFER_DONE,
+    FM_TRANSFER_FAILED,
+} fm_transfer_status_t;
+
+// private
+typedef struct fm_transport_t
+{
+    bool dma_enabled;
+    uint8_t tx_dma_channel;
+    uint8_t rx_dma_channel;
+    uint8_t status; // fm_transfer_status_t
+    uint8_t rx_size; // bytes to decode into registers 0xA..0xF
+    uint8_t addr; // target of the queued transfer
+    uint8_t cmd_count;
+    uint8_t attempts; // retries of the queued transfer
+    uint8_t retry_regs; // dirty_regs bits restored if the queued setting write fails
+    bool setting_write; // setter transfer, a failure leaves the running task alone
+    uint64_t timeout_time;
+    uint32_t cmd_buf[15]; // I2C data commands
+    uint8_t rx_buf[14];
+} fm_transport_t;
+
+/**
+ * \brief Signal quality, sampled from registers 0xA and 0xB.
+ */
+typedef struct fm_quality_t
+{
+    uint64_t sample_time; // µs since boot, 0 if no valid sample
+    uint16_t channel; // channel of the samples
+    uint8_t rssi; // latest sample
+    uint8_t rssi_smoothed; // moving average since tuning to the channel
+    bool stereo; // stereo indicator
+    bool fm_true; // channel is a station
+    bool fm_ready;
+    uint8_t history_count;
+    uint8_t history_head; // private
+    uint16_t rssi_smoothed_fp; // private, rssi_smoothed with 8 fractional bits
+    uint8_t rssi_history[FM_QUALITY_HISTORY_SIZE]; // private, see fm_get_rssi_history()
+} fm_quality_t;
+
+/**
+ * \brief Number of fm_histogram_t buckets.
+ */
+#define FM_HISTOGRAM_BUCKETS 24
+
+/**
+ * \brief Histogram of durations in µs.
+ *
+ * Bucket i counts samples in [2^i, 2^(i+1)) µs, bucket 0 also counts 0. The last bucket
+ * counts everything above.
+ */
+typedef struct fm_histogram_t
+{
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;
+    uint32_t buckets[FM_HISTOGRAM_BUCKETS];
+} fm_histogram_t;
+
+/**
+ * \brief Driver instrumentation, only tracked if FM_RDA5807_STATS_ENABLE is set.
+ */
+typedef struct fm_stats_t
+{
+    uint32_t i2c_transactions;
+    uint32_t i2c_bytes_written;
+    uint32_t i2c_bytes_read;
+    uint32_t i2c_errors; // failed attempts, including retried ones
+    uint32_t i2c_retries;
+    uint32_t i2c_timeouts;
+    uint32_t i2c_bus_recoveries;
+    uint32_t rds_groups;
+    uint32_t resyncs; // shadow register checks
+    uint32_t resync_repairs; // checks that found the chip out of sync
+    uint32_t async_ticks; // ticks that ran the async task
+    uint64_t async_tick_us; // total time spent in those ticks
+    fm_histogram_t tune; // tune start to STC
+    fm_histogram_t seek; // seek start to STC
+    fm_histogram_t rds_group_interval; // between RDS groups on the same station
+    uint64_t operation_start_time; // private
+    uint64_t last_rds_group_time; // private
+} fm_stats_t;
+
 /**
  * \brief FM radio.
  */
 typedef struct rda5807_t
 {
     i2c_inst_t *i2c_inst;
+    uint8_t i2c_addr_sequential;
+    uint8_t i2c_addr_random_access;
     uint8_t sdio_pin;
     uint8_t sclk_pin;
     bool enable_pull_ups;
+    bool interrupt_enabled;
+    uint8_t interrupt_pin;
+    volatile bool interrupt_pending;
+    fm_interrupt_callback_t interrupt_callback;
+    void *interrupt_callback_data;
     fm_config_t config;
-    fm_frequency_range_t frequency_range;
+    fm_frequency_range_khz_t frequency_range;
+    uint32_t frequency_khz;
+#if FM_RDA5807_SETTINGS_CACHE_ENABLE
     uint8_t seek_threshold;
-    float frequency;
     uint8_t volume;
     bool mute;
     bool softmute;
     bool bass_boost;
     bool mono;
+    bool rds_fifo;
+#endif
     uint16_t regs[16];
+    uint8_t dirty_regs; // bitmask for registers 0x2..0x8
+    bool update_pending;
+    bool standby; // powered down, with the register image kept for a fast resume
+    uint8_t resync_state; // fm_resync_state_t
+    uint64_t power_up_timeout_time;
+    fm_transport_t transport;
+#if FM_RDA5807_SEEK_ENABLE
+    fm_seek_state_t seek;
+#endif
+#if FM_RDA5807_SCAN_ENABLE
+    fm_scan_state_t scan;
+#endif
+#if FM_RDA5807_AF_ENABLE
+    fm_af_state_t af;
+#endif
+#if FM_RDA5807_TRACKER_ENABLE
+    fm_track_state_t track;
+#endif
+    fm_command_queue_t command_queue;
     fm_async_state_t async;
+    uint32_t quality_period_us;
+    uint32_t resync_period_us;
+    uint64_t next_resync_time;
+    fm_quality_t quality;
+#if FM_RDA5807_STATS_ENABLE
+    fm_stats_t stats;
+#endif
 } rda5807_t;
 
 /**
@@ -166,6 +501,61 @@ typedef struct rda5807_t
  */
 void fm_init(rda5807_t *radio, i2c_inst_t *i2c_inst, uint8_t sdio_pin, uint8_t sclk_pin, bool enable_pull_ups);
 
+/**
+ * \brief Override the I2C addresses of the chip.
+ *
+ * RDA5807 answers on fixed addresses, 0x10 for sequential and 0x11 for random access. To run
+ * several chips on one bus they must sit behind an address translator (e.g. LTC4316), with
+ * each radio configured for its translated addresses.
+ *
+ * Must be called before fm_power_up().
+ *
+ * @param radio Radio handle.
+ * @param sequential_addr Address for sequential register access (default 0x10).
+ * @param random_access_addr Address for random register access (default 0x11).
+ */
+void fm_set_i2c_addresses(rda5807_t *radio, uint8_t sequential_addr, uint8_t random_access_addr);
+
+/**
+ * \brief Enable interrupt signalling.
+ *
+ * The RDA5807 GPIO2 pin is configured as an active-low interrupt output, raised on
+ * seek / tune complete and on RDS data ready. Once enabled, async tasks and
+ * fm_read_rds_group() skip I2C polling while no interrupt is pending, and tune completion
+ * is handled as soon as fm_async_task_tick() runs after the interrupt.
+ *
+ * Must be called before fm_power_up(). The pin gets a raw IRQ handler (see
+ * gpio_add_raw_irq_handler()), so the application may still install its own GPIO callback
+ * for other pins, and several radios may use interrupts on separate pins.
+ *
+ * @param radio Radio handle.
+ * @param interrupt_pin GPIO connected to RDA5807 GPIO2.
+ */
+void fm_enable_interrupt(rda5807_t *radio, uint8_t interrupt_pin);
+
+/**
+ * \brief Set a function to be notified of interrupts.
+ *
+ * The callback runs in interrupt context, after the interrupt has been flagged as pending.
+ * It's meant for waking an event loop (e.g. async_context_set_work_pending()), and shouldn't
+ * access the radio.
+ *
+ * @param radio Radio handle.
+ * @param interrupt_callback Callback, or NULL.
+ * @param user_data Passed to the callback.
+ */
+void fm_set_interrupt_callback(rda5807_t *radio, fm_interrupt_callback_t interrupt_callback, void *user_data);
+
+/**
+ * \brief Check whether an interrupt has been signalled and not yet handled.
+ *
+ * Always true if interrupts are disabled. May be used to sleep (e.g. with __wfe())
+ * until the radio needs attention.
+ *
+ * @param radio Radio handle.
+ */
+bool fm_is_interrupt_pending(rda5807_t *radio);
+
 /**
  * \brief Power up the radio chip.
  * 
@@ -173,13 +563,40 @@ void fm_init(rda5807_t *radio, i2c_inst_t *i2c_inst, uint8_t sdio_pin, uint8_t s
  * 
  * @param radio Radio handle.
  * @param config FM regional settings.
+ * @return False if an I2C transfer failed, the control registers are then written again by
+ *   the next fm_commit_update().
  */
-void fm_power_up(rda5807_t *radio, fm_config_t config);
+bool fm_power_up(rda5807_t *radio, fm_config_t config);
+
+/**
+ * \brief Power up the radio chip and tune as an async task.
+ * 
+ * Fast alternative to fm_power_up() + fm_set_frequency_khz_blocking(). Instead of
+ * resetting the chip and reading back its registers, the complete register image is
+ * written in a single sequential burst: the reset defaults on a cold start, or the image
+ * kept by fm_power_down() when resuming from standby with the same config. The task then
+ * polls FM_READY and tunes, so the CPU is free during chip start-up. The burst is retried
+ * until the chip responds on the bus, so there's no need to wait after power-on.
+ * 
+ * There is no chip ID check, fm_power_up() is better suited for detecting wiring problems.
+ * Settings may be changed as soon as this returns, they're queued like during a seek and
+ * applied once the task is done.
+ * 
+ * Fails with result -1 if the chip doesn't become ready within a second, or with
+ * FM_RESULT_I2C_ERROR if it never answered on the bus.
+ * 
+ * @param radio Radio handle.
+ * @param config FM regional settings.
+ * @param frequency_khz Frequency to tune, or 0 to restore the frequency from before
+ *   fm_power_down() (stays untuned on a cold start).
+ */
+void fm_power_up_async(rda5807_t *radio, fm_config_t config, uint32_t frequency_khz);
 
 /**
  * \brief Power down the radio chip.
  * 
- * Puts the chip in a low power state while maintaining register configuration.
+ * Puts the chip in a low power state while maintaining register configuration. The
+ * register image is kept, for fm_power_up_async() to resume from standby.
  * 
  * @param radio Radio handle.
  */
@@ -199,6 +616,19 @@ bool fm_is_powered_up(rda5807_t *radio);
  */
 fm_config_t fm_get_config(rda5807_t *radio);
 
+/**
+ * \brief Change the FM regional settings while powered up.
+ * 
+ * Updates band, channel spacing and de-emphasis in place, without a power cycle, then
+ * retunes to the current frequency. If it's outside the new band it's clamped to the nearest
+ * channel. Frequencies inside the band but off the new channel grid are kept with direct
+ * frequency tuning.
+ * 
+ * @param radio Radio handle.
+ * @param config FM regional settings.
+ */
+void fm_set_config(rda5807_t *radio, fm_config_t config);
+
 /**
  * \brief Get the frequency range for the configured FM band.
  * 
@@ -206,6 +636,15 @@ fm_config_t fm_get_config(rda5807_t *radio);
  */
 fm_frequency_range_t fm_get_frequency_range(rda5807_t *radio);
 
+/**
+ * \brief Get the frequency range in kHz for the configured FM band.
+ * 
+ * Unlike fm_get_frequency_range(), all values are exact.
+ * 
+ * @param radio Radio handle.
+ */
+fm_frequency_range_khz_t fm_get_frequency_range_khz(rda5807_t *radio);
+
 /**
  * \brief Get the current FM frequency.
  * 
@@ -214,6 +653,16 @@ fm_frequency_range_t fm_get_frequency_range(rda5807_t *radio);
  */
 float fm_get_frequency(rda5807_t *radio);
 
+/**
+ * \brief Get the current FM frequency in kHz.
+ * 
+ * The frequency is tracked in kHz internally, so this avoids float conversion.
+ * 
+ * @param radio Radio handle.
+ * @return FM frequency in kHz.
+ */
+uint32_t fm_get_frequency_khz(rda5807_t *radio);
+
 /**
  * \brief Set the current FM frequency.
  * 
@@ -226,6 +675,16 @@ float fm_get_frequency(rda5807_t *radio);
  */
 void fm_set_frequency_blocking(rda5807_t *radio, float frequency);
 
+/**
+ * \brief Set the current FM frequency in kHz.
+ * 
+ * See fm_set_frequency_blocking(). The frequency is rounded to the nearest channel.
+ * 
+ * @param radio Radio handle.
+ * @param frequency_khz FM frequency in kHz.
+ */
+void fm_set_frequency_khz_blocking(rda5807_t *radio, uint32_t frequency_khz);
+
 /**
  * \brief Set the current FM frequency without blocking.
  *
@@ -240,6 +699,44 @@ void fm_set_frequency_blocking(rda5807_t *radio, float frequency);
  */
 void fm_set_frequency_async(rda5807_t *radio, float frequency);
 
+/**
+ * \brief Set the current FM frequency in kHz without blocking.
+ *
+ * See fm_set_frequency_async(). The frequency is rounded to the nearest channel.
+ * 
+ * @param radio Radio handle.
+ * @param frequency_khz FM frequency in kHz.
+ *
+ * @sa fm_async_task_tick(), fm_async_task_cancel()
+ */
+void fm_set_frequency_khz_async(rda5807_t *radio, uint32_t frequency_khz);
+
+/**
+ * \brief Set the current FM frequency in kHz, ignoring channel spacing.
+ * 
+ * Uses the direct frequency mode of the chip, so any frequency in the band can be tuned in
+ * 10kHz steps. Channel based tuning and seek switch back to channel mode.
+ * 
+ * @param radio Radio handle.
+ * @param frequency_khz FM frequency in kHz, rounded to 10kHz.
+ */
+void fm_set_frequency_direct_khz_blocking(rda5807_t *radio, uint32_t frequency_khz);
+
+/**
+ * \brief Set the current FM frequency in kHz ignoring channel spacing, without blocking.
+ *
+ * See fm_set_frequency_direct_khz_blocking(). fm_get_frequency_khz() reports the new
+ * frequency once tuned; if canceled before completion, it keeps the previous one.
+ * 
+ * May not be called while another async task is running.
+ * 
+ * @param radio Radio handle.
+ * @param frequency_khz FM frequency in kHz, rounded to 10kHz.
+ *
+ * @sa fm_async_task_tick(), fm_async_task_cancel()
+ */
+void fm_set_frequency_direct_khz_async(rda5807_t *radio, uint32_t frequency_khz);
+
 /**
  * \brief Get the seek threshold.
  * 
@@ -252,18 +749,49 @@ uint8_t fm_get_seek_threshold(rda5807_t *radio);
 /**
  * \brief Set the seek threshold.
  * 
- * Increase the seek threshold to filter out weak stations during seek.
+ * Increase the seek threshold to filter out weak stations during seek. If a seek is running,
+ * the change is queued until it's done, and fm_get_seek_threshold() returns the previous value
+ * until then.
  * 
  * @param radio Radio handle.
  * @param seek_threshold Seek threshold.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
+ */
+bool fm_set_seek_threshold(rda5807_t *radio, uint8_t seek_threshold);
+
+#if FM_RDA5807_SEEK_ENABLE
+/**
+ * \brief Get the seek settings.
+ * 
+ * @param radio Radio handle.
+ */
+fm_seek_config_t fm_get_seek_config(rda5807_t *radio);
+
+/**
+ * \brief Set how seeks stop.
+ * 
+ * The chip stops on the first channel passing its seek threshold, which can be a noise
+ * spur or an adjacent channel of a strong station. With config.require_fm_true and / or
+ * config.min_rssi, each stop is checked and the seek continues on its own past up to
+ * config.max_continues false stops, so one seek call lands on a real station.
+ * 
+ * Applies from the next seek, the default is fm_seek_config_default().
+ * 
+ * May not be called while an async task is running.
+ * 
+ * @param radio Radio handle.
+ * @param config Seek settings.
  */
-void fm_set_seek_threshold(rda5807_t *radio, uint8_t seek_threshold);
+void fm_set_seek_config(rda5807_t *radio, fm_seek_config_t config);
 
 /**
  * \brief Seek the next station.
  * 
  * Seeks in the given direction until a station is detected. If the frequency range limit
- * is reached, it will wrap to the other end.
+ * is reached, it will wrap to the other end, unless disabled in the seek config
+ * (see fm_set_seek_config()). The seek fails if no station passes the seek config, leaving
+ * the tuner where the chip stopped.
  * 
  * Seeking may take a few seconds depending on how far the next station is. To avoid blocking,
  * use fm_seek_async().
@@ -278,8 +806,8 @@ bool fm_seek_blocking(rda5807_t *radio, fm_seek_direction_t direction);
 /**
  * \brief Seek the next radio station without blocking.
  * 
- * Seeks in the given direction until a station is detected. If the frequency range limit
- * is reached, it will wrap to the other end.
+ * See fm_seek_blocking(). When the task is done, the result is 0 if a station was found,
+ * or -1 otherwise.
  * 
  * fm_get_frequency() may be used during the seek operation to monitor progress.
  * 
@@ -293,12 +821,206 @@ bool fm_seek_blocking(rda5807_t *radio, fm_seek_direction_t direction);
  * @sa fm_async_task_tick(), fm_async_task_cancel()
  */
 void fm_seek_async(rda5807_t *radio, fm_seek_direction_t direction);
+#endif // FM_RDA5807_SEEK_ENABLE
+
+/**
+ * \brief Start a batch of control changes.
+ * 
+ * Until fm_commit_update() is called, fm_set_volume(), fm_set_mute(), fm_set_softmute(),
+ * fm_set_bass_boost(), fm_set_mono() and fm_set_seek_threshold() only update the register
+ * shadow. Changes to several controls are then sent in as few I2C writes as possible.
+ * While an async task is running, registers holding the SEEK / TUNE bits are only written
+ * if changed, since rewriting them would restart the seek or tune.
+ * 
+ * Batches may not be nested.
+ * 
+ * @param radio Radio handle.
+ */
+void fm_begin_update(rda5807_t *radio);
+
+/**
+ * \brief Write all control changes since fm_begin_update().
+ * 
+ * Registers that failed to write stay pending, and are written again by the next commit.
+ * 
+ * @param radio Radio handle.
+ * @return False if an I2C write failed.
+ */
+bool fm_commit_update(rda5807_t *radio);
+
+#if FM_RDA5807_SCAN_ENABLE
+/**
+ * \brief Scan the whole frequency range for stations.
+ * 
+ * Tunes to the bottom channel, then seeks up the band with audio muted. On the bottom channel
+ * and every channel the seek stops on, signal strength is sampled after a short dwell time.
+ * Channels passing the scan config are stored in the station table, sorted by frequency.
+ * If the table fills up, the weakest stations are dropped.
+ * 
+ * Only channels above the chip seek threshold are sampled, see fm_set_seek_threshold().
+ * The scan takes one seek across the band plus the dwell time per stop. When done, the
+ * original frequency and mute are restored.
+ * 
+ * @param radio Radio handle.
+ * @param stations Output station table.
+ * @param capacity Capacity of the station table.
+ * @param config Scan settings, see fm_scan_config_default().
+ * @return Number of stations found.
+ */
+size_t fm_scan_blocking(rda5807_t *radio, fm_station_t *stations, size_t capacity, fm_scan_config_t config);
+
+/**
+ * \brief Scan the whole frequency range for stations without blocking.
+ * 
+ * See fm_scan_blocking(). When the task is done, the result is the number of stations
+ * found. fm_get_frequency() may be used during the scan to monitor progress.
+ * 
+ * If canceled before completion, the tuner is stopped without restoring the original frequency.
+ * Stations found so far are kept, fm_get_scan_station_count() returns their number.
+ * 
+ * May not be called while another async task is running. The station table must stay
+ * valid until the task is done.
+ * 
+ * @param radio Radio handle.
+ * @param stations Output station table.
+ * @param capacity Capacity of the station table.
+ * @param config Scan settings, see fm_scan_config_default().
+ * 
+ * @sa fm_async_task_tick(), fm_async_task_cancel()
+ */
+void fm_scan_async(rda5807_t *radio, fm_station_t *stations, size_t capacity, fm_scan_config_t config);
+
+/**
+ * \brief Get the number of stations found by the last scan.
+ * 
+ * @param radio Radio handle.
+ */
+size_t fm_get_scan_station_count(rda5807_t *radio);
+#endif // FM_RDA5807_SCAN_ENABLE
+
+/**
+ * \brief Get the frequency of a channel in the configured frequency range.
+ * 
+ * @param radio Radio handle.
+ * @param channel Channel index, e.g. from fm_station_t.
+ * @return FM frequency in MHz.
+ */
+float fm_get_channel_frequency(rda5807_t *radio, uint16_t channel);
+
+/**
+ * \brief Get the frequency of a channel in kHz.
+ * 
+ * @param radio Radio handle.
+ * @param channel Channel index, e.g. from fm_station_t.
+ * @return FM frequency in kHz.
+ */
+uint32_t fm_get_channel_frequency_khz(rda5807_t *radio, uint16_t channel);
+
+#if FM_RDA5807_AF_ENABLE
+/**
+ * \brief Switch to a stronger alternative frequency of the current station.
+ * 
+ * Audio is muted while each alternative is tuned and its RSSI sampled, taking ~10-15ms per
+ * frequency. The strongest one beating the current RSSI by config.min_rssi_gain is then
+ * kept if its RDS PI code matches, otherwise the original frequency is restored.
+ * 
+ * Frequencies outside the configured band are skipped. Those off the channel grid are tuned
+ * directly (see fm_set_frequency_direct_khz_blocking()).
+ * 
+ * @param radio Radio handle.
+ * @param frequencies_khz Alternative frequencies in kHz, e.g. decoded from RDS.
+ * @param count Number of frequencies.
+ * @param pi PI code of the current station.
+ * @param config Probe settings, see fm_af_config_default().
+ * @return True if switched to an alternative frequency.
+ */
+bool fm_probe_af_blocking(rda5807_t *radio, const uint32_t *frequencies_khz, size_t count, uint16_t pi, fm_af_config_t config);
+
+/**
+ * \brief Switch to a stronger alternative frequency without blocking.
+ * 
+ * See fm_probe_af_blocking(). When the task is done, the result is 0 if switched to an
+ * alternative frequency, or -1 otherwise. The frequencies must remain valid until then.
+ * 
+ * If canceled before completion, the tuner is stopped on the frequency being probed and mute
+ * is restored.
+ * 
+ * May not be called while another async task is running.
+ * 
+ * @param radio Radio handle.
+ * @param frequencies_khz Alternative frequencies in kHz.
+ * @param count Number of frequencies.
+ * @param pi PI code of the current station.
+ * @param config Probe settings, see fm_af_config_default().
+ *
+ * @sa fm_async_task_tick(), fm_async_task_cancel()
+ */
+void fm_probe_af_async(rda5807_t *radio, const uint32_t *frequencies_khz, size_t count, uint16_t pi, fm_af_config_t config);
+#endif // FM_RDA5807_AF_ENABLE
+
+#if FM_RDA5807_TRACKER_ENABLE
+/**
+ * \brief Initialize a station tracker.
+ *
+ * @param tracker Station tracker.
+ * @param frequencies_khz Stations to follow, e.g. presets or a scanned station table.
+ * @param count Number of stations, 1 to FM_TRACKER_MAX_STATIONS.
+ * @param config Tracker settings, see fm_tracker_config_default().
+ */
+void fm_tracker_init(fm_tracker_t *tracker, const uint32_t *frequencies_khz, size_t count, fm_tracker_config_t config);
+
+/**
+ * \brief Check whether the tracker's next visit is due.
+ *
+ * @param tracker Station tracker.
+ */
+bool fm_tracker_is_due(const fm_tracker_t *tracker);
+
+/**
+ * \brief Find the strongest station of a programme.
+ *
+ * Doesn't access the chip.
+ *
+ * @param tracker Station tracker.
+ * @param pi PI code of the programme.
+ * @return Station index, or -1 if no tracked station carries this PI code.
+ */
+int fm_tracker_find_best(const fm_tracker_t *tracker, uint16_t pi);
+
+/**
+ * \brief Sample the next tracked station in the background.
+ *
+ * Each call visits one station, round robin, keeping the time away from the current station
+ * short: audio is muted, the station is tuned, its RSSI and stereo / FM_TRUE flags sampled
+ * after config.dwell_ms, and if strong enough its RDS PI code awaited for up to
+ * config.pi_timeout_ms. The original frequency and mute are then restored, and the ranking
+ * updated. The station currently tuned is sampled in place, without retuning, and stations
+ * outside the configured band are skipped.
+ *
+ * Call it whenever fm_tracker_is_due() and no other task is running. When the task is done,
+ * the result is the index of the station sampled.
+ *
+ * If canceled before completion, the tuner is stopped on the station being visited and mute
+ * is restored.
+ *
+ * May not be called while another async task is running.
+ *
+ * @param radio Radio handle.
+ * @param tracker Station tracker, must remain valid until the task is done.
+ *
+ * @sa fm_async_task_tick(), fm_async_task_cancel()
+ */
+void fm_track_stations_async(rda5807_t *radio, fm_tracker_t *tracker);
+#endif // FM_RDA5807_TRACKER_ENABLE
 
 /**
  * \brief Check whether audio is muted.
  * 
  * The audio is muted by default. After power up, you should disable mute and set the desired volume.
- * 
+ *
+ * Without FM_RDA5807_SETTINGS_CACHE_ENABLE this is the chip state, so it also reads true while
+ * a scan, AF probe or station tracker visit has muted the audio.
+ *
  * @param radio Radio handle.
  */
 bool fm_get_mute(rda5807_t *radio);
@@ -306,10 +1028,15 @@ bool fm_get_mute(rda5807_t *radio);
 /**
  * \brief Set whether audio is muted.
  * 
+ * If a seek, scan, AF probe or station tracker visit is running, the change is queued until
+ * it's done, and fm_get_mute() returns the previous value until then.
+ * 
  * @param radio Radio handle.
  * @param mute Mute value.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
  */
-void fm_set_mute(rda5807_t *radio, bool mute);
+bool fm_set_mute(rda5807_t *radio, bool mute);
 
 /**
  * \brief Check whether softmute is enabled.
@@ -323,12 +1050,15 @@ bool fm_get_softmute(rda5807_t *radio);
 /**
  * \brief Set whether softmute is enabled.
  * 
- * Softmute reduces noise when the FM signal is too weak.
+ * Softmute reduces noise when the FM signal is too weak. Applied immediately, even while an
+ * async task is running, except during fm_power_up_async().
  * 
  * @param radio Radio handle.
  * @param softmute Softmute value.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
  */
-void fm_set_softmute(rda5807_t *radio, bool softmute);
+bool fm_set_softmute(rda5807_t *radio, bool softmute);
 
 /**
  * \brief Check whether bass boost is enabled.
@@ -342,10 +1072,15 @@ bool fm_get_bass_boost(rda5807_t *radio);
 /**
  * \brief Set whether bass boost is enabled.
  * 
+ * If a seek is running, the change is queued until it's done, and fm_get_bass_boost() returns
+ * the previous value until then.
+ * 
  * @param radio Radio handle.
  * @param bass_boost Bass boost value.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
  */
-void fm_set_bass_boost(rda5807_t *radio, bool bass_boost);
+bool fm_set_bass_boost(rda5807_t *radio, bool bass_boost);
 
 /**
  * \brief Check whether mono output is enabled.
@@ -359,12 +1094,15 @@ bool fm_get_mono(rda5807_t *radio);
 /**
  * \brief Set whether mono output is disabled.
  * 
- * Forcing mono output may improve reception of weak stations.
+ * Forcing mono output may improve reception of weak stations. If a seek is running, the change
+ * is queued until it's done, and fm_get_mono() returns the previous value until then.
  * 
  * @param radio Radio handle.
  * @param mono Mono value.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
  */
-void fm_set_mono(rda5807_t *radio, bool mono);
+bool fm_set_mono(rda5807_t *radio, bool mono);
 
 /**
  * \brief Get audio volume.
@@ -380,12 +1118,15 @@ uint8_t fm_get_volume(rda5807_t *radio);
  * \brief Set audio volume.
  * 
  * Values above 15 are clamped. Volume 0 is still hearable, use fm_set_mute() instead to
- * silence the output.
+ * silence the output. Applied immediately, even while an async task is running, except
+ * during fm_power_up_async().
  * 
  * @param radio Radio handle.
  * @param volume Volume value in range 0-15.
+ * @return False if the change had to be queued and the command queue is full, or the write
+ *   failed. A failed write is retried by the next fm_commit_update().
  */
-void fm_set_volume(rda5807_t *radio, uint8_t volume);
+bool fm_set_volume(rda5807_t *radio, uint8_t volume);
 
 /**
  * \brief Get current FM signal strength.
@@ -398,6 +1139,41 @@ void fm_set_volume(rda5807_t *radio, uint8_t volume);
  */
 uint8_t fm_get_rssi(rda5807_t *radio);
 
+/**
+ * \brief Set how long sampled signal quality is served from cache.
+ *
+ * Signal quality getters (fm_get_rssi(), fm_get_stereo_indicator(), fm_get_quality()) only
+ * read the chip once the cached sample is older than this, refreshing registers 0xA and 0xB
+ * in a single sequential read. The cache is also refreshed for free by RDS reads and tune
+ * polling, and is invalidated whenever a tune or seek starts.
+ *
+ * @param radio Radio handle.
+ * @param period_ms Maximum sample age, 0 to read on every call (default FM_QUALITY_DEFAULT_PERIOD_MS).
+ */
+void fm_set_quality_period(rda5807_t *radio, uint16_t period_ms);
+
+/**
+ * \brief Get the signal quality.
+ *
+ * Refreshes the sample if it's older than the quality period.
+ *
+ * @param radio Radio handle.
+ * @return Latest sample, with RSSI smoothed over the current channel.
+ */
+const fm_quality_t *fm_get_quality(rda5807_t *radio);
+
+/**
+ * \brief Get RSSI samples taken on the current channel.
+ *
+ * Doesn't access the chip.
+ *
+ * @param radio Radio handle.
+ * @param rssi Output samples, oldest first.
+ * @param capacity Maximum number of samples.
+ * @return Number of samples copied, up to FM_QUALITY_HISTORY_SIZE.
+ */
+size_t fm_get_rssi_history(rda5807_t *radio, uint8_t *rssi, size_t capacity);
+
 /**
  * \brief Check whether stereo signal is available.
  * 
@@ -413,7 +1189,8 @@ bool fm_get_stereo_indicator(rda5807_t *radio);
 /**
  * \brief Read an RDS data group.
  * 
- * Should be called every 40ms.
+ * Should be called every 40ms. If interrupts are enabled, the registers are only read
+ * after RDS ready has been signalled, so calling it more often is cheap.
  * 
  * @param radio Radio handle.
  * @param blocks Output buffer.
@@ -422,13 +1199,179 @@ bool fm_get_stereo_indicator(rda5807_t *radio);
  */
 bool fm_read_rds_group(rda5807_t *radio, uint16_t *blocks);
 
+/**
+ * \brief Get error levels for the last RDS group.
+ * 
+ * Each block has a 2-bit level: 0 - no errors, 1 - 1-2 corrected errors, 2 - 3-5 corrected
+ * errors, 3 - uncorrectable. Block A is in bits 0-1, B in bits 2-3, C in bits 4-5, and D
+ * in bits 6-7. The chip only reports levels for blocks A and B, so C and D take the level
+ * of block B.
+ * 
+ * Uses registers cached by the last RDS read, without I2C traffic.
+ * 
+ * @param radio Radio handle.
+ */
+uint8_t fm_get_rds_block_errors(rda5807_t *radio);
+
+/**
+ * \brief Check whether the decoder is synchronized to an RDS stream.
+ * 
+ * Uses registers cached by the last RDS read, without I2C traffic.
+ * 
+ * @param radio Radio handle.
+ */
+bool fm_get_rds_sync(rda5807_t *radio);
+
+/**
+ * \brief Check whether the RDS FIFO is enabled.
+ * 
+ * The FIFO is disabled by default.
+ * 
+ * @param radio Radio handle.
+ */
+bool fm_get_rds_fifo(rda5807_t *radio);
+
+/**
+ * \brief Set whether RDS groups are buffered in the chip FIFO.
+ * 
+ * With the FIFO enabled, fm_read_rds_groups() can be called much less often than every
+ * 40ms without losing groups. The FIFO is cleared after each tune or seek.
+ * 
+ * Written immediately, also within fm_begin_update() / fm_commit_update().
+ * 
+ * @param radio Radio handle.
+ * @param rds_fifo FIFO value.
+ */
+void fm_set_rds_fifo(rda5807_t *radio, bool rds_fifo);
+
+/**
+ * \brief Read all buffered RDS data groups.
+ * 
+ * Drains the RDS FIFO until RDS ready is clear, or reads at most one group if the FIFO is
+ * disabled. Identical consecutive groups are all returned.
+ * 
+ * @param radio Radio handle.
+ * @param groups Output buffer, 4 blocks per group.
+ * @param max_groups Capacity of the output buffer in groups.
+ * @return Number of groups read.
+ */
+size_t fm_read_rds_groups(rda5807_t *radio, uint16_t *groups, size_t max_groups);
+
+/**
+ * \brief Check the chip registers against the register shadow, and repair any drift.
+ *
+ * Registers 0x2..0x8 are read back in one random access burst and compared with the
+ * shadow, ignoring the self-clearing SEEK, TUNE and SOFT_RESET bits. On a mismatch, e.g.
+ * after a brown-out or a spurious reset, the shadow is written back. If the chip had lost
+ * power or its tuning, the current frequency is retuned by the following resyncs, which are
+ * due right after the repair.
+ *
+ * @param radio Radio handle.
+ * @return true if the chip was out of sync.
+ */
+bool fm_resync_registers(rda5807_t *radio);
+
+/**
+ * \brief Set how often registers are resynced in the background.
+ *
+ * fm_read_rds_group() and fm_read_rds_groups() run fm_resync_registers() once it's due,
+ * right after a poll that came back without new RDS data, so it never delays a group. No
+ * resync runs while an async task or a batched update is pending.
+ *
+ * @param radio Radio handle.
+ * @param period_ms Interval between checks, 0 to disable (default FM_RESYNC_DEFAULT_PERIOD_MS).
+ */
+void fm_set_resync_period(rda5807_t *radio, uint32_t period_ms);
+
+/**
+ * \brief Enable DMA transfers on the I2C bus.
+ *
+ * Register reads and writes are queued as DMA transfers. Writes return as soon as they
+ * are queued, and fm_start_read_rds_group() / fm_start_read_rssi() can be issued without
+ * waiting for the bus.
+ *
+ * Since writes complete in the background, the setters and fm_commit_update() can't report
+ * a failed write. The registers of a failed setting write are marked pending again, and
+ * written by the next fm_commit_update().
+ *
+ * Must be called after i2c_init(). The DMA channels should be claimed by the caller,
+ * and the I2C instance may not be shared with other devices.
+ *
+ * @param radio Radio handle.
+ * @param tx_dma_channel DMA channel for I2C commands.
+ * @param rx_dma_channel DMA channel for received data.
+ */
+void fm_enable_dma(rda5807_t *radio, uint8_t tx_dma_channel, uint8_t rx_dma_channel);
+
+/**
+ * \brief Start reading an RDS data group without blocking.
+ *
+ * Without DMA the registers are read immediately. Poll fm_is_read_done(), then collect
+ * the group with fm_finish_read_rds_group().
+ *
+ * @param radio Radio handle.
+ * @return true Read started.
+ * @return false Another transfer is still in progress.
+ */
+bool fm_start_read_rds_group(rda5807_t *radio);
+
+/**
+ * \brief Start reading the FM signal strength without blocking.
+ *
+ * Without DMA the registers are read immediately. Poll fm_is_read_done(), then collect
+ * the value with fm_finish_read_rssi().
+ *
+ * @param radio Radio handle.
+ * @return true Read started.
+ * @return false Another transfer is still in progress.
+ */
+bool fm_start_read_rssi(rda5807_t *radio);
+
+/**
+ * \brief Check whether a read started by fm_start_read_xxx() has completed.
+ *
+ * @param radio Radio handle.
+ */
+bool fm_is_read_done(rda5807_t *radio);
+
+/**
+ * \brief Collect the result of fm_start_read_rds_group().
+ *
+ * May only be called once fm_is_read_done() returns true.
+ *
+ * @param radio Radio handle.
+ * @param blocks Output buffer.
+ * @return true RDS data ready, blocks filled.
+ * @return false RDS data not yet ready, or the transfer failed.
+ */
+bool fm_finish_read_rds_group(rda5807_t *radio, uint16_t *blocks);
+
+/**
+ * \brief Collect the result of fm_start_read_rssi().
+ *
+ * May only be called once fm_is_read_done() returns true.
+ *
+ * @param radio Radio handle.
+ * @param rssi Output RSSI level, up to 75dBµV.
+ * @return true RSSI read.
+ * @return false The transfer failed, rssi is left unchanged.
+ */
+bool fm_finish_read_rssi(rda5807_t *radio, uint8_t *rssi);
+
 /**
  * \brief Update the current asynchronous task.
  * 
  * Long running operations like seeking can be run asynchronously to free up the
  * CPU for other work. After calling fm_xxx_async(), the tick function must be
  * called periodically until the task is done. The tick interval is up to the user
- * (every 40ms should be fine).
+ * (every 40ms should be fine). If interrupts are enabled, the task is resumed early
+ * when an interrupt is pending.
+ * 
+ * I2C transactions time out after FM_I2C_BYTE_TIMEOUT_US per byte, and are retried up
+ * to FM_I2C_RETRIES times, recovering the bus by clocking SCL if it got stuck. If a
+ * task transaction still fails, the task is cancelled and finishes with FM_RESULT_I2C_ERROR.
+ * A failed setting write made while the task runs (e.g. fm_set_volume()) doesn't cancel it,
+ * the setting stays pending until the next fm_commit_update().
  * 
  * @param radio Radio handle.
  * @return Task status.
@@ -438,10 +1381,112 @@ fm_async_progress_t fm_async_task_tick(rda5807_t *radio);
 /**
  * \brief Abort the current asynchronous task.
  * 
+ * Queued tune and seek operations are dropped, queued settings are applied.
+ * 
  * @param radio Radio handle.
  */
 void fm_async_task_cancel(rda5807_t *radio);
 
+/**
+ * \brief Tune to a frequency after any running or queued operations.
+ *
+ * Starts right away as an async task if the radio is idle. Otherwise it's queued, and started
+ * by fm_async_task_tick() once the operations before it are done. The tick that completes a
+ * task may thus leave the next queued task running.
+ *
+ * Settings are queued in order with it only while the running task locks them (see
+ * fm_set_mute()), and a repeated change replaces the value still pending. Other settings,
+ * e.g. fm_set_volume() during a seek, are applied immediately and so overtake a tune queued
+ * earlier.
+ *
+ * @param radio Radio handle.
+ * @param frequency_khz FM frequency in kHz.
+ * @return False if the queue is full.
+ */
+bool fm_enqueue_frequency_khz(rda5807_t *radio, uint32_t frequency_khz);
+
+#if FM_RDA5807_SEEK_ENABLE
+/**
+ * \brief Seek after any running or queued operations.
+ *
+ * See fm_enqueue_frequency_khz().
+ *
+ * @param radio Radio handle.
+ * @param direction Direction of seek.
+ * @return False if the queue is full.
+ */
+bool fm_enqueue_seek(rda5807_t *radio, fm_seek_direction_t direction);
+#endif // FM_RDA5807_SEEK_ENABLE
+
+/**
+ * \brief Get the number of operations waiting for the current async task.
+ *
+ * @param radio Radio handle.
+ */
+size_t fm_get_queued_command_count(rda5807_t *radio);
+
+/**
+ * \brief Check if an asynchronous task is running.
+ * 
+ * @param radio Radio handle.
+ */
+bool fm_async_task_is_running(rda5807_t *radio);
+
+/**
+ * \brief Check if the current asynchronous task would make progress on the next tick.
+ *
+ * True once the resume time is reached, or early if an interrupt is pending.
+ * 
+ * @param radio Radio handle.
+ */
+bool fm_async_task_is_due(rda5807_t *radio);
+
+/**
+ * \brief Get the time at which the current asynchronous task resumes.
+ *
+ * With interrupts enabled the task may resume earlier.
+ * 
+ * @param radio Radio handle.
+ * @return Absolute time in µs since boot.
+ */
+uint64_t fm_async_task_get_resume_time(rda5807_t *radio);
+
+#if FM_RDA5807_STATS_ENABLE
+/**
+ * \brief Get the driver instrumentation counters.
+ *
+ * Tune and seek durations are measured when completion is observed, so their resolution
+ * is the poll interval, or interrupt latency if interrupts are enabled.
+ *
+ * @param radio Radio handle.
+ */
+const fm_stats_t *fm_get_stats(rda5807_t *radio);
+
+/**
+ * \brief Reset the driver instrumentation counters.
+ *
+ * @param radio Radio handle.
+ */
+void fm_reset_stats(rda5807_t *radio);
+#endif // FM_RDA5807_STATS_ENABLE
+
+/**
+ * \brief Add a duration sample to a histogram.
+ *
+ * @param histogram Histogram, zero-initialized before first use.
+ * @param duration_us Duration in µs.
+ */
+void fm_histogram_add(fm_histogram_t *histogram, uint64_t duration_us);
+
+/**
+ * \brief Estimate a percentile of the histogram samples.
+ *
+ * @param histogram Histogram.
+ * @param percent Percentile, from 0 to 100.
+ * @return Upper bound in µs of the bucket holding the percentile, or 0 if empty.
+ */
+uint32_t fm_histogram_percentile_us(const fm_histogram_t *histogram, uint8_t percent);
+
 #ifdef __cplusplus
 }
 #endif
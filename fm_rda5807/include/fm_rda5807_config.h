@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDA5807_CONFIG_H_
+#define _RDA5807_CONFIG_H_
+
+/** \file fm_rda5807_config.h
+ *
+ * \brief Compile-time driver profile.
+ *
+ * Override any of these with target_compile_definitions(). FM_RDA5807_MINIMAL flips the
+ * defaults of all optional features to off, individual switches still take precedence.
+ *
+ * sizeof(rda5807_t) with an ILP32 layout, as on the RP2040:
+ * - 432 bytes with the defaults
+ * - seek, scan, AF and tracker state add 8, 16, 32 and 24 bytes, the settings cache 8 bytes
+ * - 336 bytes with FM_RDA5807_MINIMAL
+ * - 272 bytes with FM_RDA5807_MINIMAL, FM_COMMAND_QUEUE_SIZE 2 and FM_QUALITY_HISTORY_SIZE 4
+ *
+ * See rds_parser.h for the RDS parser, RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE 0 saves
+ * another 68 bytes per rds_parser_t.
+ */
+
+#ifndef FM_RDA5807_MINIMAL
+#define FM_RDA5807_MINIMAL 0 // strip all optional features by default
+#endif
+
+#ifndef FM_RDA5807_SEEK_ENABLE
+#define FM_RDA5807_SEEK_ENABLE !FM_RDA5807_MINIMAL // fm_seek_xxx(), fm_enqueue_seek()
+#endif
+
+#ifndef FM_RDA5807_SCAN_ENABLE
+#define FM_RDA5807_SCAN_ENABLE !FM_RDA5807_MINIMAL // fm_scan_xxx()
+#endif
+
+#ifndef FM_RDA5807_AF_ENABLE
+#define FM_RDA5807_AF_ENABLE !FM_RDA5807_MINIMAL // fm_probe_af_xxx()
+#endif
+
+#ifndef FM_RDA5807_TRACKER_ENABLE
+#define FM_RDA5807_TRACKER_ENABLE !FM_RDA5807_MINIMAL // fm_tracker_xxx(), fm_track_stations_async()
+#endif
+
+/**
+ * \brief Keep a copy of the user settings besides the register shadow.
+ *
+ * Without it, mute, softmute, bass boost, mono, volume, seek threshold and RDS FIFO are read
+ * back from the register shadow. The only visible difference is that fm_get_mute() reports the
+ * chip state while scan, AF probing or station tracking keep the audio muted.
+ */
+#ifndef FM_RDA5807_SETTINGS_CACHE_ENABLE
+#define FM_RDA5807_SETTINGS_CACHE_ENABLE !FM_RDA5807_MINIMAL
+#endif
+
+#ifndef FM_RDA5807_STATS_ENABLE
+#define FM_RDA5807_STATS_ENABLE 0 // instrumentation build, see fm_get_stats()
+#endif
+
+#ifndef FM_I2C_RETRIES
+#define FM_I2C_RETRIES 2 // extra attempts after an I2C transaction fails, 0 to disable
+#endif
+
+#ifndef FM_I2C_BYTE_TIMEOUT_US
+#define FM_I2C_BYTE_TIMEOUT_US 200 // transaction timeout per byte, generous for 100 kHz with clock stretching
+#endif
+
+#ifndef FM_RESYNC_DEFAULT_PERIOD_MS
+#define FM_RESYNC_DEFAULT_PERIOD_MS 0 // shadow register check interval, see fm_set_resync_period()
+#endif
+
+#ifndef FM_COMMAND_QUEUE_SIZE
+#define FM_COMMAND_QUEUE_SIZE 8 // operations queued behind a running async task
+#endif
+
+#ifndef FM_TRACKER_MAX_STATIONS
+#define FM_TRACKER_MAX_STATIONS 16 // stations ranked by a station tracker
+#endif
+
+#ifndef FM_QUALITY_HISTORY_SIZE
+#define FM_QUALITY_HISTORY_SIZE 16 // RSSI samples kept by the signal quality monitor
+#endif
+
+#ifndef FM_QUALITY_DEFAULT_PERIOD_MS
+#define FM_QUALITY_DEFAULT_PERIOD_MS 20 // max age of cached signal quality, see fm_set_quality_period()
+#endif
+
+#endif // _RDA5807_CONFIG_H_
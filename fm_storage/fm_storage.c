@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_storage.h>
+#include <hardware/sync.h>
+#include <string.h>
+
+#define FM_STORAGE_MAGIC (0x464D0000u | sizeof(fm_storage_data_t)) // 'FM' + data size
+#define FM_STORAGE_RECORD_SIZE (sizeof(fm_storage_header_t) + sizeof(fm_storage_data_t))
+#define FM_STORAGE_SLOT_SIZE ((FM_STORAGE_RECORD_SIZE + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE)
+#define FM_STORAGE_SLOTS_PER_SECTOR (FLASH_SECTOR_SIZE / FM_STORAGE_SLOT_SIZE)
+#define FM_STORAGE_SLOT_COUNT (FM_STORAGE_SECTOR_COUNT * FM_STORAGE_SLOTS_PER_SECTOR)
+
+static_assert(sizeof(fm_storage_data_t) <= 0xFFFF, "data too large for magic");
+static_assert(FM_STORAGE_SLOTS_PER_SECTOR != 0, "data too large for a flash sector");
+static_assert(FM_STORAGE_FLASH_OFFSET % FLASH_SECTOR_SIZE == 0, "");
+
+//
+// flash
+//
+
+static size_t fm_storage_get_slot_offset(size_t slot_index) {
+    // slots don't straddle sectors, the tail of each sector is unused
+    size_t sector_index = slot_index / FM_STORAGE_SLOTS_PER_SECTOR;
+    return FM_STORAGE_FLASH_OFFSET + sector_index * FLASH_SECTOR_SIZE
+        + (slot_index % FM_STORAGE_SLOTS_PER_SECTOR) * FM_STORAGE_SLOT_SIZE;
+}
+
+static const uint8_t *fm_storage_get_slot(size_t slot_index) {
+    return (const uint8_t *)(XIP_BASE + fm_storage_get_slot_offset(slot_index));
+}
+
+static uint32_t fm_storage_crc(const uint8_t *data, size_t size) {
+    // CRC-32, bitwise to avoid a table in RAM
+    uint32_t crc = 0xFFFFFFFF;
+    for (size_t i = 0; i < size; i++) {
+        crc ^= data[i];
+        for (size_t bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+        }
+    }
+    return ~crc;
+}
+
+static bool fm_storage_is_valid(const uint8_t *slot) {
+    const fm_storage_header_t *header = (const fm_storage_header_t *)slot;
+    return header->magic == FM_STORAGE_MAGIC
+        && header->crc == fm_storage_crc(slot + sizeof(fm_storage_header_t), sizeof(fm_storage_data_t));
+}
+
+static bool fm_storage_is_erased(const uint8_t *slot) {
+    for (size_t i = 0; i < FM_STORAGE_SLOT_SIZE; i++) {
+        if (slot[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// public interface
+//
+
+void fm_storage_init(fm_storage_t *storage) {
+    storage->slot_index = -1;
+    storage->sequence = 0;
+    for (size_t i = 0; i < FM_STORAGE_SLOT_COUNT; i++) {
+        const uint8_t *slot = fm_storage_get_slot(i);
+        const fm_storage_header_t *header = (const fm_storage_header_t *)slot;
+        if (fm_storage_is_valid(slot) && (storage->slot_index < 0 || storage->sequence < header->sequence)) {
+            storage->slot_index = i;
+            storage->sequence = header->sequence;
+        }
+    }
+}
+
+bool fm_storage_load(fm_storage_t *storage, fm_storage_data_t *data) {
+    if (storage->slot_index < 0) {
+        return false;
+    }
+    const uint8_t *slot = fm_storage_get_slot(storage->slot_index);
+    memcpy(data, slot + sizeof(fm_storage_header_t), sizeof(fm_storage_data_t));
+    return true;
+}
+
+void fm_storage_save(fm_storage_t *storage, const fm_storage_data_t *data) {
+    if (storage->slot_index >= 0) {
+        const uint8_t *slot = fm_storage_get_slot(storage->slot_index);
+        if (memcmp(slot + sizeof(fm_storage_header_t), data, sizeof(fm_storage_data_t)) == 0) {
+            return; // unchanged
+        }
+    }
+
+    static uint8_t buf[FM_STORAGE_SLOT_SIZE]; // flash is programmed in whole pages
+    memset(buf, 0xFF, sizeof(buf));
+    fm_storage_header_t header = {
+        .magic = FM_STORAGE_MAGIC,
+        .sequence = storage->sequence + 1,
+        .crc = fm_storage_crc((const uint8_t *)data, sizeof(fm_storage_data_t)),
+    };
+    memcpy(buf, &header, sizeof(header));
+    memcpy(buf + sizeof(header), data, sizeof(fm_storage_data_t));
+
+    // Sectors are used in turn, and only the one without the latest record is erased, so
+    // power loss while erasing or programming still leaves that record to fall back to.
+    size_t slot_index = (size_t)(storage->slot_index + 1) % FM_STORAGE_SLOT_COUNT;
+    bool erase = !fm_storage_is_erased(fm_storage_get_slot(slot_index));
+    if (erase && 0 <= storage->slot_index) {
+        size_t latest_sector = (size_t)storage->slot_index / FM_STORAGE_SLOTS_PER_SECTOR;
+        if (slot_index / FM_STORAGE_SLOTS_PER_SECTOR == latest_sector) {
+            // torn write after the latest record, move on to the other sector
+            slot_index = (latest_sector + 1) % FM_STORAGE_SECTOR_COUNT * FM_STORAGE_SLOTS_PER_SECTOR;
+        }
+    }
+    size_t offset = fm_storage_get_slot_offset(slot_index);
+    uint32_t interrupts = save_and_disable_interrupts();
+    if (erase) {
+        flash_range_erase(offset - offset % FLASH_SECTOR_SIZE, FLASH_SECTOR_SIZE);
+    }
+    flash_range_program(offset, buf, sizeof(buf));
+    restore_interrupts(interrupts);
+
+    storage->slot_index = slot_index;
+    storage->sequence = header.sequence;
+}
+
+void fm_storage_capture_radio(fm_storage_data_t *data, rda5807_t *radio) {
+    data->config = fm_get_config(radio);
+    data->frequency_khz = fm_get_frequency_khz(radio);
+    data->volume = fm_get_volume(radio);
+    data->mute = fm_get_mute(radio);
+    data->softmute = fm_get_softmute(radio);
+    data->bass_boost = fm_get_bass_boost(radio);
+    data->mono = fm_get_mono(radio);
+    data->seek_threshold = fm_get_seek_threshold(radio);
+}
+
+void fm_storage_restore_radio(const fm_storage_data_t *data, rda5807_t *radio) {
+    fm_power_up_async(radio, data->config, data->frequency_khz);
+    fm_begin_update(radio);
+    fm_set_volume(radio, data->volume);
+    fm_set_mute(radio, data->mute);
+    fm_set_softmute(radio, data->softmute);
+    fm_set_bass_boost(radio, data->bass_boost);
+    fm_set_mono(radio, data->mono);
+    fm_set_seek_threshold(radio, data->seek_threshold);
+    fm_commit_update(radio);
+}
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _FM_STORAGE_H_
+#define _FM_STORAGE_H_
+
+#include <fm_rda5807.h>
+#include <rds_station_cache.h>
+#include <hardware/flash.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file fm_storage.h
+ *
+ * \brief Tuner state persisted to flash.
+ *
+ * Keeps the band config, last frequency, audio settings, scanned stations and the RDS
+ * station cache across resets, so the last station can be tuned and named right after
+ * boot.
+ *
+ * Records are appended to successive slots of two flash sectors used in turn, by default
+ * the last two. A sector is only erased once the other one holds the latest record and all
+ * of its slots are used, and saving unchanged data is skipped, which spreads wear. Each
+ * record carries a sequence number and a CRC, so a save interrupted by power loss, even
+ * while erasing, falls back to the previous record.
+ *
+ * Flash is unavailable to XIP while it's written, and interrupts are disabled for the
+ * duration (tens of ms when erasing). If the other core is running it must be paused,
+ * e.g. with multicore_lockout_start_blocking().
+ */
+
+#define FM_STORAGE_SECTOR_COUNT 2
+
+#ifndef FM_STORAGE_FLASH_OFFSET
+#define FM_STORAGE_FLASH_OFFSET (PICO_FLASH_SIZE_BYTES - FM_STORAGE_SECTOR_COUNT * FLASH_SECTOR_SIZE) // must not overlap the program
+#endif
+
+#ifndef FM_STORAGE_MAX_STATIONS
+#define FM_STORAGE_MAX_STATIONS 32
+#endif
+
+/**
+ * \brief Persisted state.
+ */
+typedef struct fm_storage_data_t
+{
+    fm_config_t config;
+    uint32_t frequency_khz;
+    uint8_t volume;
+    bool mute;
+    bool softmute;
+    bool bass_boost;
+    bool mono;
+    uint8_t seek_threshold;
+    uint16_t station_count;
+    fm_station_t stations[FM_STORAGE_MAX_STATIONS];
+    rds_station_cache_t station_cache;
+} fm_storage_data_t;
+
+/**
+ * \brief Flash record header.
+ */
+typedef struct fm_storage_header_t
+{
+    uint32_t magic; // includes the data size, records from other builds are ignored
+    uint32_t sequence;
+    uint32_t crc; // of data
+} fm_storage_header_t;
+
+/**
+ * \brief Storage handle.
+ */
+typedef struct fm_storage_t
+{
+    int slot_index; // slot of the latest record, -1 if none
+    uint32_t sequence; // of the latest record
+} fm_storage_t;
+
+/**
+ * \brief Find the latest record in flash.
+ *
+ * @param storage Storage handle.
+ */
+void fm_storage_init(fm_storage_t *storage);
+
+/**
+ * \brief Load the latest record.
+ *
+ * @param storage Storage handle.
+ * @param data Output data.
+ * @return False if nothing has been saved.
+ */
+bool fm_storage_load(fm_storage_t *storage, fm_storage_data_t *data);
+
+/**
+ * \brief Save a new record.
+ *
+ * Does nothing if the data matches the latest record, so data should be zeroed before
+ * it's filled in. Blocks for up to ~50ms, with interrupts disabled.
+ *
+ * @param storage Storage handle.
+ * @param data Data to persist.
+ */
+void fm_storage_save(fm_storage_t *storage, const fm_storage_data_t *data);
+
+/**
+ * \brief Capture tuner settings and frequency.
+ *
+ * Stations and the station cache are left to the caller.
+ *
+ * @param data Persisted state.
+ * @param radio Radio handle.
+ */
+void fm_storage_capture_radio(fm_storage_data_t *data, rda5807_t *radio);
+
+/**
+ * \brief Power up with persisted settings and tune the persisted frequency.
+ *
+ * Uses fm_power_up_async(), the async task must be run to completion by the caller. The
+ * settings are queued behind it, and written once the chip is up.
+ *
+ * @param data Persisted state.
+ * @param radio Radio handle.
+ */
+void fm_storage_restore_radio(const fm_storage_data_t *data, rda5807_t *radio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FM_STORAGE_H_
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_telemetry.h>
+#include <string.h>
+
+#define FM_TELEMETRY_TX_MASK (FM_TELEMETRY_TX_BUFFER_SIZE - 1)
+
+typedef enum fm_telemetry_rx_state_t
+{
+    FM_TELEMETRY_RX_SYNC,
+    FM_TELEMETRY_RX_TYPE,
+    FM_TELEMETRY_RX_LENGTH,
+    FM_TELEMETRY_RX_PAYLOAD,
+    FM_TELEMETRY_RX_CRC,
+} fm_telemetry_rx_state_t;
+
+static uint8_t fm_telemetry_crc_update(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static size_t fm_telemetry_put_u16(uint8_t *dst, uint16_t value) {
+    dst[0] = value >> 8;
+    dst[1] = value & 0xFF;
+    return 2;
+}
+
+static size_t fm_telemetry_put_u32(uint8_t *dst, uint32_t value) {
+    fm_telemetry_put_u16(dst, value >> 16);
+    fm_telemetry_put_u16(&dst[2], value & 0xFFFF);
+    return 4;
+}
+
+static uint16_t fm_telemetry_saturate_u16(uint32_t value) {
+    return value < UINT16_MAX ? value : UINT16_MAX;
+}
+
+static void fm_telemetry_put_byte(fm_telemetry_t *telemetry, uint8_t byte) {
+    telemetry->tx_buf[telemetry->tx_head & FM_TELEMETRY_TX_MASK] = byte;
+    telemetry->tx_head++;
+}
+
+static bool fm_telemetry_put_frame(fm_telemetry_t *telemetry, uint8_t type, const uint8_t *payload, size_t length) {
+    if (FM_TELEMETRY_TX_BUFFER_SIZE - fm_telemetry_get_pending(telemetry) < length + FM_TELEMETRY_FRAME_OVERHEAD) {
+        return false; // full
+    }
+    uint8_t crc = fm_telemetry_crc_update(fm_telemetry_crc_update(0, type), length);
+    fm_telemetry_put_byte(telemetry, FM_TELEMETRY_SYNC);
+    fm_telemetry_put_byte(telemetry, type);
+    fm_telemetry_put_byte(telemetry, length);
+    for (size_t i = 0; i < length; i++) {
+        fm_telemetry_put_byte(telemetry, payload[i]);
+        crc = fm_telemetry_crc_update(crc, payload[i]);
+    }
+    fm_telemetry_put_byte(telemetry, crc);
+    return true;
+}
+
+//
+// public interface
+//
+
+void fm_telemetry_init(fm_telemetry_t *telemetry) {
+    memset(telemetry, 0, sizeof(fm_telemetry_t));
+    telemetry->rx_state = FM_TELEMETRY_RX_SYNC;
+}
+
+bool fm_telemetry_send(fm_telemetry_t *telemetry, uint8_t type, const uint8_t *payload, size_t length) {
+    assert(length <= FM_TELEMETRY_MAX_PAYLOAD);
+
+    if (telemetry->unreported_drops != 0) {
+        // tell the host about the gap before resuming the stream
+        uint8_t event[5];
+        event[0] = FM_TELEMETRY_EVENT_OVERFLOW;
+        fm_telemetry_put_u32(&event[1], telemetry->unreported_drops);
+        if (fm_telemetry_put_frame(telemetry, FM_TELEMETRY_MSG_EVENT, event, sizeof(event))) {
+            telemetry->unreported_drops = 0;
+        }
+    }
+    if (telemetry->unreported_drops != 0 || !fm_telemetry_put_frame(telemetry, type, payload, length)) {
+        telemetry->dropped_frames++;
+        telemetry->unreported_drops++;
+        return false;
+    }
+    return true;
+}
+
+bool fm_telemetry_send_ack(fm_telemetry_t *telemetry, uint8_t command, uint8_t status) {
+    uint8_t payload[2] = {command, status};
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_ACK, payload, sizeof(payload));
+}
+
+bool fm_telemetry_send_event(fm_telemetry_t *telemetry, uint8_t event, uint32_t value) {
+    uint8_t payload[5];
+    payload[0] = event;
+    fm_telemetry_put_u32(&payload[1], value);
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_EVENT, payload, sizeof(payload));
+}
+
+bool fm_telemetry_send_rds_group(fm_telemetry_t *telemetry, const uint16_t *blocks, uint8_t block_errors, uint64_t now) {
+    uint8_t payload[13];
+    size_t size = fm_telemetry_put_u32(payload, (uint32_t)now);
+    payload[size++] = block_errors;
+    for (size_t i = 0; i < 4; i++) {
+        size += fm_telemetry_put_u16(&payload[size], blocks[i]);
+    }
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_RDS_GROUP, payload, size);
+}
+
+bool fm_telemetry_send_quality(fm_telemetry_t *telemetry, uint8_t rssi, uint8_t rssi_smoothed, uint8_t flags, uint64_t now) {
+    uint8_t payload[7];
+    size_t size = fm_telemetry_put_u32(payload, (uint32_t)now);
+    payload[size++] = rssi;
+    payload[size++] = rssi_smoothed;
+    payload[size++] = flags;
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_QUALITY, payload, size);
+}
+
+bool fm_telemetry_send_station(fm_telemetry_t *telemetry, uint32_t frequency_khz, uint8_t rssi, uint8_t flags) {
+    uint8_t payload[6];
+    size_t size = fm_telemetry_put_u32(payload, frequency_khz);
+    payload[size++] = rssi;
+    payload[size++] = flags;
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_STATION, payload, size);
+}
+
+bool fm_telemetry_send_status(fm_telemetry_t *telemetry, const fm_telemetry_status_t *status) {
+    uint8_t payload[13];
+    size_t size = fm_telemetry_put_u32(payload, status->frequency_khz);
+    payload[size++] = status->volume;
+    payload[size++] = status->flags;
+    payload[size++] = status->stream_flags;
+    size += fm_telemetry_put_u16(&payload[size], status->quality_period_ms);
+    size += fm_telemetry_put_u16(&payload[size], fm_telemetry_saturate_u16(telemetry->dropped_frames));
+    size += fm_telemetry_put_u16(&payload[size], fm_telemetry_saturate_u16(telemetry->rx_errors));
+    return fm_telemetry_send(telemetry, FM_TELEMETRY_MSG_STATUS, payload, size);
+}
+
+size_t fm_telemetry_drain(fm_telemetry_t *telemetry, fm_telemetry_write_t write, void *user_data) {
+    size_t sent = 0;
+    while (telemetry->tx_tail != telemetry->tx_head) {
+        // contiguous run up to the end of the buffer
+        size_t offset = telemetry->tx_tail & FM_TELEMETRY_TX_MASK;
+        size_t size = FM_TELEMETRY_TX_BUFFER_SIZE - offset;
+        if (fm_telemetry_get_pending(telemetry) < size) {
+            size = fm_telemetry_get_pending(telemetry);
+        }
+        size_t written = write(&telemetry->tx_buf[offset], size, user_data);
+        assert(written <= size);
+        telemetry->tx_tail += written;
+        sent += written;
+        if (written < size) {
+            break; // link busy
+        }
+    }
+    return sent;
+}
+
+bool fm_telemetry_receive(fm_telemetry_t *telemetry, uint8_t byte) {
+    fm_telemetry_frame_t *frame = &telemetry->rx_frame;
+    switch (telemetry->rx_state) {
+    case FM_TELEMETRY_RX_SYNC:
+        if (byte == FM_TELEMETRY_SYNC) {
+            telemetry->rx_state = FM_TELEMETRY_RX_TYPE;
+        }
+        return false;
+    case FM_TELEMETRY_RX_TYPE:
+        frame->type = byte;
+        telemetry->rx_crc = fm_telemetry_crc_update(0, byte);
+        telemetry->rx_state = FM_TELEMETRY_RX_LENGTH;
+        return false;
+    case FM_TELEMETRY_RX_LENGTH:
+        if (FM_TELEMETRY_MAX_PAYLOAD < byte) {
+            telemetry->rx_errors++;
+            telemetry->rx_state = FM_TELEMETRY_RX_SYNC;
+            return false;
+        }
+        frame->length = byte;
+        telemetry->rx_offset = 0;
+        telemetry->rx_crc = fm_telemetry_crc_update(telemetry->rx_crc, byte);
+        telemetry->rx_state = byte == 0 ? FM_TELEMETRY_RX_CRC : FM_TELEMETRY_RX_PAYLOAD;
+        return false;
+    case FM_TELEMETRY_RX_PAYLOAD:
+        frame->payload[telemetry->rx_offset++] = byte;
+        telemetry->rx_crc = fm_telemetry_crc_update(telemetry->rx_crc, byte);
+        if (telemetry->rx_offset == frame->length) {
+            telemetry->rx_state = FM_TELEMETRY_RX_CRC;
+        }
+        return false;
+    default: // FM_TELEMETRY_RX_CRC
+        telemetry->rx_state = FM_TELEMETRY_RX_SYNC;
+        if (byte != telemetry->rx_crc) {
+            telemetry->rx_errors++;
+            return false;
+        }
+        return true;
+    }
+}
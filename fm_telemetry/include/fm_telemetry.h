@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _FM_TELEMETRY_H_
+#define _FM_TELEMETRY_H_
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file fm_telemetry.h
+ *
+ * \brief Framed binary protocol for driving the tuner from host software.
+ *
+ * Commands from the host (tune, seek, scan, volume, streaming selection) and messages from
+ * the device (acks, events, RDS groups, signal quality samples) share one frame layout,
+ * multi-byte fields big-endian:
+ *
+ * | field   | size   | notes                                                  |
+ * | ------- | ------ | ------------------------------------------------------ |
+ * | sync    | 1      | FM_TELEMETRY_SYNC                                      |
+ * | type    | 1      | FM_TELEMETRY_CMD_xxx to the device, FM_TELEMETRY_MSG_xxx from it |
+ * | length  | 1      | payload size, at most FM_TELEMETRY_MAX_PAYLOAD         |
+ * | payload | length |                                                        |
+ * | crc     | 1      | CRC-8 (polynomial 0x07) over type, length and payload  |
+ *
+ * The receiver hunts for the sync byte again after a bad length or CRC, so it recovers from
+ * line noise and from text output sent before the binary stream.
+ *
+ * Outgoing frames are queued in a ring buffer and drained by fm_telemetry_drain() as fast
+ * as the link accepts them, so senders never block. A frame that doesn't fit is dropped
+ * whole, and a FM_TELEMETRY_EVENT_OVERFLOW event with the number of dropped frames is
+ * queued ahead of the next frame that fits.
+ */
+
+#ifndef FM_TELEMETRY_TX_BUFFER_SIZE
+#define FM_TELEMETRY_TX_BUFFER_SIZE 1024 // must be a power of two
+#endif
+
+static_assert((FM_TELEMETRY_TX_BUFFER_SIZE & (FM_TELEMETRY_TX_BUFFER_SIZE - 1)) == 0, "buffer size must be a power of two");
+
+#define FM_TELEMETRY_SYNC 0xA5
+#define FM_TELEMETRY_MAX_PAYLOAD 32
+#define FM_TELEMETRY_FRAME_OVERHEAD 4 // sync, type, length, crc
+
+//
+// commands, host to device
+//
+
+#define FM_TELEMETRY_CMD_PING 0x01 // no payload
+#define FM_TELEMETRY_CMD_TUNE 0x02 // u32 frequency_khz, FM_TELEMETRY_EVENT_TUNED when done
+#define FM_TELEMETRY_CMD_SEEK 0x03 // u8 direction (0 down, 1 up), FM_TELEMETRY_EVENT_SEEK_xxx when done
+#define FM_TELEMETRY_CMD_SCAN 0x04 // no payload, FM_TELEMETRY_MSG_STATION per station, then FM_TELEMETRY_EVENT_SCAN_COMPLETE
+#define FM_TELEMETRY_CMD_VOLUME 0x05 // u8 volume, 0 to FM_MAX_VOLUME
+#define FM_TELEMETRY_CMD_MUTE 0x06 // u8 mute
+#define FM_TELEMETRY_CMD_STREAM 0x07 // u8 FM_TELEMETRY_STREAM_xxx flags, u16 quality_period_ms
+#define FM_TELEMETRY_CMD_STATUS 0x08 // no payload, answered with FM_TELEMETRY_MSG_STATUS
+#define FM_TELEMETRY_CMD_EXIT 0x09 // no payload, back to the text console
+
+//
+// messages, device to host
+//
+
+#define FM_TELEMETRY_MSG_ACK 0x81 // u8 command type, u8 FM_TELEMETRY_ACK_xxx
+#define FM_TELEMETRY_MSG_EVENT 0x82 // u8 FM_TELEMETRY_EVENT_xxx, u32 value
+#define FM_TELEMETRY_MSG_RDS_GROUP 0x83 // u32 time_us, u8 block_errors, u16 blocks A-D
+#define FM_TELEMETRY_MSG_QUALITY 0x84 // u32 time_us, u8 rssi, u8 rssi_smoothed, u8 FM_TELEMETRY_QUALITY_xxx flags
+#define FM_TELEMETRY_MSG_STATION 0x85 // u32 frequency_khz, u8 rssi, u8 FM_STATION_xxx flags
+#define FM_TELEMETRY_MSG_STATUS 0x86 // see fm_telemetry_status_t
+
+#define FM_TELEMETRY_ACK_OK 0
+#define FM_TELEMETRY_ACK_BUSY 1 // async task running
+#define FM_TELEMETRY_ACK_INVALID 2 // unknown command, bad payload
+#define FM_TELEMETRY_ACK_POWERED_DOWN 3
+
+#define FM_TELEMETRY_EVENT_TUNED 1 // value: frequency_khz
+#define FM_TELEMETRY_EVENT_SEEK_COMPLETE 2 // value: frequency_khz
+#define FM_TELEMETRY_EVENT_SEEK_FAILED 3 // value: frequency_khz
+#define FM_TELEMETRY_EVENT_SCAN_COMPLETE 4 // value: station count
+#define FM_TELEMETRY_EVENT_OVERFLOW 5 // value: frames dropped since the last overflow event
+
+#define FM_TELEMETRY_STREAM_RDS 0x01 // FM_TELEMETRY_MSG_RDS_GROUP for each group read
+#define FM_TELEMETRY_STREAM_QUALITY 0x02 // FM_TELEMETRY_MSG_QUALITY every quality_period_ms
+
+#define FM_TELEMETRY_QUALITY_STEREO 0x01
+#define FM_TELEMETRY_QUALITY_FM_TRUE 0x02
+
+#define FM_TELEMETRY_STATUS_POWERED 0x01
+#define FM_TELEMETRY_STATUS_BUSY 0x02
+#define FM_TELEMETRY_STATUS_MUTE 0x04
+#define FM_TELEMETRY_STATUS_SOFTMUTE 0x08
+#define FM_TELEMETRY_STATUS_MONO 0x10
+#define FM_TELEMETRY_STATUS_BASS_BOOST 0x20
+
+/**
+ * \brief Device state, payload of FM_TELEMETRY_MSG_STATUS.
+ */
+typedef struct fm_telemetry_status_t
+{
+    uint32_t frequency_khz;
+    uint8_t volume;
+    uint8_t flags; // FM_TELEMETRY_STATUS_xxx
+    uint8_t stream_flags; // FM_TELEMETRY_STREAM_xxx
+    uint16_t quality_period_ms;
+    uint16_t dropped_frames; // total, saturated
+    uint16_t rx_errors; // frames with a bad length or CRC, saturated
+} fm_telemetry_status_t;
+
+/**
+ * \brief Received frame.
+ */
+typedef struct fm_telemetry_frame_t
+{
+    uint8_t type;
+    uint8_t length;
+    uint8_t payload[FM_TELEMETRY_MAX_PAYLOAD];
+} fm_telemetry_frame_t;
+
+/**
+ * \brief Sends queued bytes, e.g. to a USB CDC endpoint.
+ *
+ * Must not block.
+ *
+ * @return Bytes accepted, less than size once the link is busy.
+ */
+typedef size_t (*fm_telemetry_write_t)(const uint8_t *data, size_t size, void *user_data);
+
+/**
+ * \brief Protocol endpoint, framing in both directions.
+ */
+typedef struct fm_telemetry_t
+{
+    uint8_t tx_buf[FM_TELEMETRY_TX_BUFFER_SIZE];
+    uint32_t tx_head; // write index, wraps
+    uint32_t tx_tail; // read index, wraps
+    uint32_t dropped_frames; // total
+    uint32_t unreported_drops; // since the last overflow event
+    fm_telemetry_frame_t rx_frame;
+    uint8_t rx_state;
+    uint8_t rx_offset;
+    uint8_t rx_crc;
+    uint32_t rx_errors;
+} fm_telemetry_t;
+
+/**
+ * \brief Initialize the endpoint, discarding queued and partially received frames.
+ *
+ * @param telemetry Protocol endpoint.
+ */
+void fm_telemetry_init(fm_telemetry_t *telemetry);
+
+/**
+ * \brief Queue a frame.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param type Frame type.
+ * @param payload Payload bytes.
+ * @param length Payload size, at most FM_TELEMETRY_MAX_PAYLOAD.
+ * @return true Frame queued.
+ * @return false Not enough space, frame dropped.
+ */
+bool fm_telemetry_send(fm_telemetry_t *telemetry, uint8_t type, const uint8_t *payload, size_t length);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_ACK.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param command Acknowledged command type.
+ * @param status FM_TELEMETRY_ACK_xxx.
+ */
+bool fm_telemetry_send_ack(fm_telemetry_t *telemetry, uint8_t command, uint8_t status);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_EVENT.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param event FM_TELEMETRY_EVENT_xxx.
+ * @param value Event value.
+ */
+bool fm_telemetry_send_event(fm_telemetry_t *telemetry, uint8_t event, uint32_t value);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_RDS_GROUP.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param blocks RDS blocks A-D.
+ * @param block_errors Error levels, as returned by fm_get_rds_block_errors().
+ * @param now Time the group was read in µs since boot, sent modulo 2^32.
+ */
+bool fm_telemetry_send_rds_group(fm_telemetry_t *telemetry, const uint16_t *blocks, uint8_t block_errors, uint64_t now);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_QUALITY.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param rssi Signal strength.
+ * @param rssi_smoothed Averaged signal strength.
+ * @param flags FM_TELEMETRY_QUALITY_xxx.
+ * @param now Sample time in µs since boot, sent modulo 2^32.
+ */
+bool fm_telemetry_send_quality(fm_telemetry_t *telemetry, uint8_t rssi, uint8_t rssi_smoothed, uint8_t flags, uint64_t now);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_STATION.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param frequency_khz Station frequency.
+ * @param rssi Signal strength.
+ * @param flags FM_STATION_xxx.
+ */
+bool fm_telemetry_send_station(fm_telemetry_t *telemetry, uint32_t frequency_khz, uint8_t rssi, uint8_t flags);
+
+/**
+ * \brief Queue a FM_TELEMETRY_MSG_STATUS.
+ *
+ * The dropped frame and receive error counters are filled in from the endpoint.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param status Device state.
+ */
+bool fm_telemetry_send_status(fm_telemetry_t *telemetry, const fm_telemetry_status_t *status);
+
+/**
+ * \brief Send queued bytes until the link is busy.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param write Output callback.
+ * @param user_data Passed to the output callback.
+ * @return Bytes sent.
+ */
+size_t fm_telemetry_drain(fm_telemetry_t *telemetry, fm_telemetry_write_t write, void *user_data);
+
+/**
+ * \brief Get the number of queued bytes.
+ *
+ * @param telemetry Protocol endpoint.
+ */
+static inline size_t fm_telemetry_get_pending(const fm_telemetry_t *telemetry) {
+    return telemetry->tx_head - telemetry->tx_tail;
+}
+
+/**
+ * \brief Feed one received byte to the frame decoder.
+ *
+ * @param telemetry Protocol endpoint.
+ * @param byte Received byte.
+ * @return true A valid frame is complete, see fm_telemetry_get_frame().
+ * @return false Frame incomplete, or discarded.
+ */
+bool fm_telemetry_receive(fm_telemetry_t *telemetry, uint8_t byte);
+
+/**
+ * \brief Get the last received frame.
+ *
+ * Valid after fm_telemetry_receive() returned true, until the next byte is received.
+ *
+ * @param telemetry Protocol endpoint.
+ */
+static inline const fm_telemetry_frame_t *fm_telemetry_get_frame(const fm_telemetry_t *telemetry) {
+    return &telemetry->rx_frame;
+}
+
+/**
+ * \brief Read a big-endian u16 from a payload.
+ */
+static inline uint16_t fm_telemetry_get_u16(const uint8_t *src) {
+    return (src[0] << 8) | src[1];
+}
+
+/**
+ * \brief Read a big-endian u32 from a payload.
+ */
+static inline uint32_t fm_telemetry_get_u32(const uint8_t *src) {
+    return ((uint32_t)fm_telemetry_get_u16(src) << 16) | fm_telemetry_get_u16(&src[2]);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FM_TELEMETRY_H_
@@ -0,0 +1,627 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <fm_manager.h>
+#include <fm_rda5807.h>
+#include <rds_parser.h>
+#include <rda5807_sim.h>
+#include <pico_mock.h>
+#include <hardware/i2c.h>
+#include <pico/stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+// Runs the driver against the simulated chip and prints bus traffic and simulated latency
+// per API call. Compare the output before and after a driver change to catch I2C regressions.
+// Scenario outcomes are checked as well, the exit status is non-zero if any check failed.
+
+static const uint SDIO_PIN = 4;
+static const uint SCLK_PIN = 5;
+static const uint INTERRUPT_PIN = 6;
+static const uint APP_INTERRUPT_PIN = 7; // the application's own GPIO callback
+static const uint8_t SECOND_ADDR_SEQUENTIAL = 0x30; // second tuner behind an address translator
+static const uint8_t SECOND_ADDR_RANDOM_ACCESS = 0x31;
+
+#define FM_CONFIG fm_config_europe()
+
+static const uint RDS_TIMEOUT_MS = 15000;
+static const uint RDS_POLL_INTERVAL_MS = 40; // below the ~87.6ms group period
+
+#define PS_GROUP_COUNT 4
+#define RT_GROUP_COUNT 16
+#define RDS_GROUP_COUNT (PS_GROUP_COUNT + RT_GROUP_COUNT)
+
+typedef struct sim_station_t
+{
+    uint32_t frequency_khz;
+    uint8_t rssi;
+    uint16_t pi;
+    const char *ps; // 8 chars
+    const char *rt; // 64 chars
+    uint8_t block_errors; // applied to every other group
+    uint16_t groups[RDS_GROUP_COUNT][4];
+    uint8_t group_block_errors[RDS_GROUP_COUNT];
+    rda5807_sim_station_t sim;
+} sim_station_t;
+
+static sim_station_t stations[] = {
+    {.frequency_khz = 88800, .rssi = 45, .pi = 0x5401, .ps = "ACTUALIT", .rt = "Radio Romania Actualitati - stiri, sport si meteo in fiecare ora", .block_errors = 0},
+    {.frequency_khz = 91700, .rssi = 38, .pi = 0xF201, .ps = "RFI     ", .rt = "RFI Romania - informatie si muzica, in direct de la Bucuresti   ", .block_errors = 0},
+    {.frequency_khz = 95600, .rssi = 30, .pi = 0x5403, .ps = "R CLUJ  ", .rt = "Radio Cluj - postul regional al Transilvaniei, din anul 1954    ", .block_errors = 0x15},
+    {.frequency_khz = 107300, .rssi = 50, .pi = 0x5C11, .ps = "ITSYBITS", .rt = "Itsy Bitsy Radio - muzica si voie buna pentru toata familia     ", .block_errors = 0},
+};
+
+static rda5807_t radio;
+static rds_parser_t rds_parser;
+static rda5807_t second_radio;
+static rds_parser_t manager_rds_parsers[2];
+static int manager_seek_result;
+static uint failure_count;
+
+//
+// stations
+//
+
+static void build_rds_groups(sim_station_t *station) {
+    // cycle 0A (PS) and 2A (RT) groups, like a real encoder interleaving them
+    for (uint i = 0; i < PS_GROUP_COUNT; i++) {
+        uint16_t *group = station->groups[i];
+        const char *ps = &station->ps[i * 2];
+        group[0] = station->pi;
+        group[1] = (0x0 << 12) | (0 << 11) | i;
+        group[2] = 0xE0CD; // AF codes: none
+        group[3] = (ps[0] << 8) | ps[1];
+    }
+    for (uint i = 0; i < RT_GROUP_COUNT; i++) {
+        uint16_t *group = station->groups[PS_GROUP_COUNT + i];
+        const char *rt = &station->rt[i * 4];
+        group[0] = station->pi;
+        group[1] = (0x2 << 12) | (0 << 11) | i;
+        group[2] = (rt[0] << 8) | rt[1];
+        group[3] = (rt[2] << 8) | rt[3];
+    }
+    for (uint i = 0; i < RDS_GROUP_COUNT; i++) {
+        station->group_block_errors[i] = (i % 2 == 1) ? station->block_errors : 0;
+    }
+    station->sim = (rda5807_sim_station_t){
+        .frequency_khz = station->frequency_khz,
+        .rssi = station->rssi,
+        .stereo = true,
+        .rds_groups = station->groups,
+        .rds_block_errors = station->group_block_errors,
+        .rds_group_count = RDS_GROUP_COUNT,
+    };
+}
+
+static uint app_interrupt_count;
+
+static void on_app_gpio_irq(uint gpio, uint32_t events) {
+    (void)events;
+    if (gpio == APP_INTERRUPT_PIN) {
+        app_interrupt_count++;
+    }
+}
+
+static void reset_sim(bool interrupt_mode) {
+    mock_reset();
+    rda5807_sim_config_t config = rda5807_sim_config_default();
+    config.interrupt_pin = interrupt_mode ? (int)INTERRUPT_PIN : -1;
+    rda5807_sim_init(config);
+    for (size_t i = 0; i < count_of(stations); i++) {
+        rda5807_sim_add_station(&stations[i].sim);
+    }
+}
+
+//
+// measurements
+//
+
+typedef struct measurement_t
+{
+    uint64_t start_time;
+} measurement_t;
+
+static measurement_t begin_measurement() {
+    rda5807_sim_reset_stats();
+    return (measurement_t){time_us_64()};
+}
+
+static void end_measurement(measurement_t measurement, const char *name) {
+    const rda5807_sim_stats_t *stats = rda5807_sim_get_stats();
+    uint64_t elapsed_us = time_us_64() - measurement.start_time;
+    printf("%-18s %6lu xfers %6lu wr %6lu rd %4lu nak %8llu bus_us %8llu.%03llu ms\n",
+        name,
+        (unsigned long)stats->transactions,
+        (unsigned long)stats->bytes_written,
+        (unsigned long)stats->bytes_read,
+        (unsigned long)stats->naks,
+        (unsigned long long)stats->bus_us,
+        (unsigned long long)(elapsed_us / 1000),
+        (unsigned long long)(elapsed_us % 1000));
+}
+
+static void expect(bool condition, const char *name, const char *description) {
+    // scenario outcome, reported next to the measurement
+    if (!condition) {
+        printf("%-18s FAILED: %s\n", name, description);
+        failure_count++;
+    }
+}
+
+static bool is_on_frequency(rda5807_t *tuner, uint32_t frequency_khz, size_t chip) {
+    // driver and chip agree on the expected frequency
+    rda5807_sim_select_chip(chip);
+    uint32_t chip_frequency_khz = rda5807_sim_get_frequency_khz();
+    rda5807_sim_select_chip(0);
+    return fm_get_frequency_khz(tuner) == frequency_khz && chip_frequency_khz == frequency_khz;
+}
+
+static fm_async_progress_t run_async_task(void) {
+    // sleep until the task is due, the simulator wakes us early on interrupts
+    fm_async_progress_t progress;
+    do {
+        if (!fm_async_task_is_due(&radio)) {
+            uint64_t resume_time = fm_async_task_get_resume_time(&radio);
+            while (!fm_async_task_is_due(&radio) && !best_effort_wfe_or_timeout(from_us_since_boot(resume_time))) {
+            }
+        }
+        progress = fm_async_task_tick(&radio);
+    } while (!progress.done);
+    return progress;
+}
+
+static void benchmark_fault(const char *name, uint32_t frequency_khz, uint32_t nak_count, uint32_t stall_count) {
+    // tune through injected I2C faults
+    measurement_t measurement = begin_measurement();
+    rda5807_sim_inject_faults(nak_count, stall_count);
+    fm_set_frequency_khz_async(&radio, frequency_khz);
+    fm_async_progress_t progress = run_async_task();
+    end_measurement(measurement, name);
+    rda5807_sim_inject_faults(0, 0);
+    printf("%-18s result %d, %lu stalls, on %.1f MHz\n", "", progress.result,
+        (unsigned long)rda5807_sim_get_stats()->stalls, fm_get_frequency_khz(&radio) / 1000.0);
+    if (stall_count < 1000) {
+        expect(progress.result == 0 && is_on_frequency(&radio, frequency_khz, 0), name, "tuned despite the faults");
+    } else {
+        expect(progress.result == FM_RESULT_I2C_ERROR, name, "I2C error reported");
+    }
+}
+
+static void benchmark_ps(const char *name, uint32_t frequency_khz, const char *ps) {
+    // tune, then poll RDS until the PS name is decoded
+    measurement_t measurement = begin_measurement();
+    fm_set_frequency_khz_blocking(&radio, frequency_khz);
+    rds_parser_reset(&rds_parser);
+    uint64_t timeout_time = time_us_64() + RDS_TIMEOUT_MS * 1000;
+    while (rds_get_program_service_name_str(&rds_parser)[0] == '\0' && time_us_64() < timeout_time) {
+        union
+        {
+            uint16_t group_data[4];
+            rds_group_t group;
+        } rds;
+        if (fm_read_rds_group(&radio, rds.group_data)) {
+            rds_parser_update_with_errors(&rds_parser, &rds.group, fm_get_rds_block_errors(&radio));
+        }
+        sleep_ms(RDS_POLL_INTERVAL_MS);
+    }
+    end_measurement(measurement, name);
+    printf("%-18s PS '%s', %lu groups dropped\n", "",
+        rds_get_program_service_name_str(&rds_parser),
+        (unsigned long)rda5807_sim_get_stats()->rds_groups_dropped);
+    expect(strcmp(rds_get_program_service_name_str(&rds_parser), ps) == 0, name, "PS decoded");
+}
+
+static void run_benchmark(bool interrupt_mode) {
+    printf("== %s mode\n", interrupt_mode ? "interrupt" : "polling");
+    reset_sim(interrupt_mode);
+    i2c_init(i2c_default, rda5807_sim_get_config()->i2c_baudrate);
+    fm_init(&radio, i2c_default, SDIO_PIN, SCLK_PIN, true /* enable_pull_ups */);
+    if (interrupt_mode) {
+        fm_enable_interrupt(&radio, INTERRUPT_PIN);
+    }
+
+    measurement_t measurement = begin_measurement();
+    fm_power_up(&radio, FM_CONFIG);
+    end_measurement(measurement, "power_up");
+    fm_power_down(&radio);
+
+    reset_sim(interrupt_mode);
+    fm_init(&radio, i2c_default, SDIO_PIN, SCLK_PIN, true);
+    if (interrupt_mode) {
+        fm_enable_interrupt(&radio, INTERRUPT_PIN);
+    }
+    measurement = begin_measurement();
+    fm_power_up_async(&radio, FM_CONFIG, stations[0].frequency_khz);
+    run_async_task();
+    end_measurement(measurement, "power_up_async");
+    expect(is_on_frequency(&radio, stations[0].frequency_khz, 0), "power_up_async", "tuned to the start frequency");
+
+    if (interrupt_mode) {
+        // the radio's raw IRQ handler leaves the application callback in place
+        app_interrupt_count = 0;
+        gpio_set_irq_enabled_with_callback(APP_INTERRUPT_PIN, GPIO_IRQ_EDGE_FALL, true, &on_app_gpio_irq);
+        mock_raise_gpio_irq(APP_INTERRUPT_PIN);
+        fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+        printf("%-18s %u app callbacks, radio on %.1f MHz\n", "shared gpio irq", app_interrupt_count,
+            fm_get_frequency_khz(&radio) / 1000.0);
+        expect(app_interrupt_count == 1 && is_on_frequency(&radio, stations[0].frequency_khz, 0), "shared gpio irq",
+            "application callback kept, radio tuned by interrupt");
+    }
+
+    measurement = begin_measurement();
+    for (size_t i = 0; i < count_of(stations); i++) {
+        fm_set_frequency_khz_blocking(&radio, stations[i].frequency_khz);
+    }
+    end_measurement(measurement, "tune x4");
+    expect(is_on_frequency(&radio, stations[count_of(stations) - 1].frequency_khz, 0), "tune x4", "on the last station");
+
+    measurement = begin_measurement();
+    for (size_t i = 0; i < count_of(stations); i++) {
+        fm_set_frequency_khz_async(&radio, stations[i].frequency_khz);
+        run_async_task();
+    }
+    end_measurement(measurement, "tune_async x4");
+    expect(is_on_frequency(&radio, stations[count_of(stations) - 1].frequency_khz, 0), "tune_async x4",
+        "on the last station");
+
+    // a direct tune cancelled before STC keeps the last tuned frequency
+    measurement = begin_measurement();
+    fm_set_frequency_direct_khz_async(&radio, stations[0].frequency_khz + 30);
+    fm_async_task_cancel(&radio);
+    end_measurement(measurement, "direct cancel");
+    printf("%-18s on %.2f MHz\n", "", fm_get_frequency_khz(&radio) / 1000.0);
+    expect(fm_get_frequency_khz(&radio) == stations[count_of(stations) - 1].frequency_khz, "direct cancel",
+        "last tuned frequency kept");
+
+    fm_set_frequency_khz_blocking(&radio, fm_get_frequency_range_khz(&radio).bottom);
+    measurement = begin_measurement();
+    for (size_t i = 0; i < count_of(stations); i++) {
+        fm_seek_blocking(&radio, FM_SEEK_UP);
+    }
+    end_measurement(measurement, "seek x4");
+    expect(is_on_frequency(&radio, stations[count_of(stations) - 1].frequency_khz, 0), "seek x4", "on the last station");
+
+    fm_set_frequency_khz_blocking(&radio, fm_get_frequency_range_khz(&radio).bottom);
+    measurement = begin_measurement();
+    for (size_t i = 0; i < count_of(stations); i++) {
+        fm_seek_async(&radio, FM_SEEK_UP);
+        run_async_task();
+    }
+    end_measurement(measurement, "seek_async x4");
+    expect(is_on_frequency(&radio, stations[count_of(stations) - 1].frequency_khz, 0), "seek_async x4",
+        "on the last station");
+
+    // chained seeks, about 1.9 s in the sim, against 12.9 s tuning to every channel in turn;
+    // started off the channel grid, the direct frequency is restored
+    fm_station_t found[16];
+    fm_set_frequency_direct_khz_blocking(&radio, stations[2].frequency_khz + 30);
+    measurement = begin_measurement();
+    size_t found_count = fm_scan_blocking(&radio, found, count_of(found), fm_scan_config_default());
+    end_measurement(measurement, "scan");
+    printf("%-18s %u stations found, driver %.2f MHz, chip %.2f MHz\n", "", (unsigned)found_count,
+        fm_get_frequency_khz(&radio) / 1000.0, rda5807_sim_get_frequency_khz() / 1000.0);
+    bool found_all = found_count == count_of(stations);
+    for (size_t i = 0; found_all && i < found_count; i++) {
+        uint32_t frequency_khz = fm_get_channel_frequency_khz(&radio, found[i].channel);
+        found_all = frequency_khz == stations[i].frequency_khz;
+    }
+    expect(found_all, "scan", "every station found");
+    expect(is_on_frequency(&radio, stations[2].frequency_khz + 30, 0), "scan", "direct frequency restored");
+
+    for (size_t i = 0; i < count_of(stations); i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "ps %.1f MHz", stations[i].frequency_khz / 1000.0);
+        benchmark_ps(name, stations[i].frequency_khz, stations[i].ps);
+    }
+
+    // dashboard style sampling, back to back and then every 10ms
+    sleep_ms(100);
+    measurement = begin_measurement();
+    for (uint i = 0; i < 10; i++) {
+        fm_get_rssi(&radio);
+        fm_get_stereo_indicator(&radio);
+    }
+    end_measurement(measurement, "quality x10");
+    measurement = begin_measurement();
+    for (uint i = 0; i < 10; i++) {
+        fm_get_quality(&radio);
+        sleep_ms(10);
+    }
+    end_measurement(measurement, "quality 10ms x10");
+
+    // background tracker, one visit per station plus an empty channel
+    uint32_t tracked_khz[count_of(stations) + 1];
+    for (size_t i = 0; i < count_of(stations); i++) {
+        tracked_khz[i] = stations[i].frequency_khz;
+    }
+    tracked_khz[count_of(stations)] = 100000;
+    fm_tracker_t tracker;
+    fm_tracker_init(&tracker, tracked_khz, count_of(tracked_khz), fm_tracker_config_default());
+    for (size_t i = 0; i < count_of(tracked_khz); i++) {
+        measurement = begin_measurement();
+        fm_track_stations_async(&radio, &tracker);
+        run_async_task();
+        char name[32];
+        snprintf(name, sizeof(name), "track %.1f MHz", tracked_khz[i] / 1000.0);
+        end_measurement(measurement, name);
+    }
+    printf("%-18s ranking:", "");
+    for (size_t i = 0; i < tracker.count; i++) {
+        const fm_tracked_station_t *station = &tracker.stations[tracker.ranking[i]];
+        printf(" %.1f (%u, %04X)", station->frequency_khz / 1000.0, station->rssi, station->pi);
+    }
+    printf(", now on %.1f MHz\n", fm_get_frequency_khz(&radio) / 1000.0);
+
+    measurement = begin_measurement();
+    fm_begin_update(&radio);
+    fm_set_volume(&radio, 5);
+    fm_set_mute(&radio, false);
+    fm_set_bass_boost(&radio, true);
+    fm_set_mono(&radio, false);
+    fm_commit_update(&radio);
+    end_measurement(measurement, "batched update");
+
+    measurement = begin_measurement();
+    fm_set_volume(&radio, 6);
+    fm_set_mute(&radio, false);
+    fm_set_bass_boost(&radio, false);
+    fm_set_mono(&radio, false);
+    end_measurement(measurement, "separate updates");
+
+    // a batch dirtying 0x4 and 0x5 mid-seek, must not rewrite SEEK in 0x2
+    fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+    measurement = begin_measurement();
+    fm_seek_async(&radio, FM_SEEK_UP);
+    fm_begin_update(&radio);
+    fm_set_softmute(&radio, !fm_get_softmute(&radio));
+    fm_set_volume(&radio, 8);
+    fm_commit_update(&radio);
+    run_async_task();
+    end_measurement(measurement, "update during seek");
+    printf("%-18s %lu restarts, on %.1f MHz\n", "", (unsigned long)rda5807_sim_get_stats()->restarts,
+        fm_get_frequency_khz(&radio) / 1000.0);
+    expect(rda5807_sim_get_stats()->restarts == 0 && is_on_frequency(&radio, stations[1].frequency_khz, 0),
+        "update during seek", "seek not restarted, stopped on the next station");
+
+    // repeated changes to a setting locked by the seek share one queue entry
+    fm_seek_async(&radio, FM_SEEK_UP);
+    bool accepted = true;
+    for (int i = 0; i < 2 * FM_COMMAND_QUEUE_SIZE; i++) {
+        accepted &= fm_set_mute(&radio, i % 2 == 0);
+    }
+    printf("%-18s %s, %zu queued\n", "mute during seek", accepted ? "accepted" : "dropped",
+        fm_get_queued_command_count(&radio));
+    expect(accepted && fm_get_queued_command_count(&radio) == 1, "mute during seek", "changes merged into one command");
+    run_async_task();
+
+    // a carrier without programme between the first two stations
+    static const rda5807_sim_station_t spur = {.frequency_khz = 90200, .rssi = 35, .spur = true};
+    rda5807_sim_add_station(&spur);
+    fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+    measurement = begin_measurement();
+    fm_seek_blocking(&radio, FM_SEEK_UP);
+    end_measurement(measurement, "seek spur");
+    printf("%-18s stopped on %.1f MHz\n", "", fm_get_frequency_khz(&radio) / 1000.0);
+    expect(is_on_frequency(&radio, spur.frequency_khz, 0), "seek spur", "stopped on the spur");
+
+    fm_seek_config_t seek_config = fm_seek_config_default();
+    seek_config.require_fm_true = true;
+    fm_set_seek_config(&radio, seek_config);
+    fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+    measurement = begin_measurement();
+    fm_seek_blocking(&radio, FM_SEEK_UP);
+    end_measurement(measurement, "seek validated");
+    printf("%-18s stopped on %.1f MHz\n", "", fm_get_frequency_khz(&radio) / 1000.0);
+    expect(is_on_frequency(&radio, stations[1].frequency_khz, 0), "seek validated", "spur skipped");
+
+    seek_config.wrap = false;
+    fm_set_seek_config(&radio, seek_config);
+    fm_set_frequency_khz_blocking(&radio, stations[count_of(stations) - 1].frequency_khz);
+    measurement = begin_measurement();
+    bool success = fm_seek_blocking(&radio, FM_SEEK_UP);
+    end_measurement(measurement, "seek band edge");
+    printf("%-18s %s, on %.1f MHz\n", "", success ? "found" : "failed", fm_get_frequency_khz(&radio) / 1000.0);
+    expect(!success && is_on_frequency(&radio, fm_get_frequency_range_khz(&radio).top, 0), "seek band edge",
+        "failed at the band top");
+    fm_set_seek_config(&radio, fm_seek_config_default());
+
+    measurement = begin_measurement();
+    for (int i = 0; i < 10; i++) {
+        fm_resync_registers(&radio);
+    }
+    end_measurement(measurement, "resync x10");
+
+    // supply dip, repaired by the next RDS poll without data
+    fm_set_frequency_khz_blocking(&radio, stations[count_of(stations) - 1].frequency_khz);
+    fm_set_resync_period(&radio, 1000);
+    rda5807_sim_brown_out();
+    measurement = begin_measurement();
+    uint64_t timeout_time = time_us_64() + RDS_TIMEOUT_MS * 1000;
+    uint16_t blocks[4];
+    while (!fm_read_rds_group(&radio, blocks) && time_us_64() < timeout_time) {
+        sleep_ms(RDS_POLL_INTERVAL_MS);
+    }
+    end_measurement(measurement, "resync brown-out");
+    printf("%-18s %s, on %.1f MHz\n", "", time_us_64() < timeout_time ? "RDS restored" : "timed out",
+        rda5807_sim_get_frequency_khz() / 1000.0);
+    expect(time_us_64() < timeout_time && is_on_frequency(&radio, stations[count_of(stations) - 1].frequency_khz, 0),
+        "resync brown-out", "station and RDS restored");
+    fm_set_resync_period(&radio, 0);
+
+    // the repair retunes the station found by the seek, not the channel tuned before it
+    fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+    fm_seek_blocking(&radio, FM_SEEK_UP);
+    rda5807_sim_brown_out();
+    measurement = begin_measurement();
+    fm_resync_registers(&radio);
+    for (int i = 0; i < 100 && radio.resync_state != FM_RESYNC_IDLE; i++) {
+        sleep_ms(10); // chip start-up, then tune polls
+        fm_resync_registers(&radio);
+    }
+    end_measurement(measurement, "resync after seek");
+    printf("%-18s driver %.1f MHz, chip %.1f MHz\n", "", fm_get_frequency_khz(&radio) / 1000.0,
+        rda5807_sim_get_frequency_khz() / 1000.0);
+    expect(is_on_frequency(&radio, spur.frequency_khz, 0), "resync after seek", "seek result retuned");
+
+    benchmark_fault("tune nak", stations[0].frequency_khz, 1, 0);
+    benchmark_fault("tune stall", stations[1].frequency_khz, 0, 1);
+    benchmark_fault("tune bus down", stations[2].frequency_khz, 0, 1000);
+    fm_set_frequency_khz_blocking(&radio, stations[2].frequency_khz);
+
+    // a setting NAKed on every retry stays pending, and goes out with the next commit
+    rda5807_sim_inject_faults(1 + FM_I2C_RETRIES, 0);
+    bool written = fm_set_volume(&radio, 3);
+    uint8_t failed_volume = rda5807_sim_get_register(0x5) & 0xF;
+    fm_begin_update(&radio);
+    bool committed = fm_commit_update(&radio);
+    printf("%-18s %s with chip volume %u, %s with %u\n", "setting nak", written ? "written" : "failed", failed_volume,
+        committed ? "committed" : "failed", rda5807_sim_get_register(0x5) & 0xF);
+    expect(!written && failed_volume == 8, "setting nak", "failed write reported");
+    expect(committed && (rda5807_sim_get_register(0x5) & 0xF) == 3, "setting nak", "retried by the next commit");
+
+    // a setting failing mid-seek stays pending, without cancelling the seek
+    fm_set_frequency_khz_blocking(&radio, stations[1].frequency_khz);
+    fm_seek_async(&radio, FM_SEEK_UP);
+    rda5807_sim_inject_faults(1 + FM_I2C_RETRIES, 0);
+    written = fm_set_volume(&radio, 4);
+    fm_async_progress_t progress = run_async_task();
+    fm_begin_update(&radio);
+    committed = fm_commit_update(&radio);
+    printf("%-18s %s, seek result %d on %.1f MHz, %s with %u\n", "setting nak seek", written ? "written" : "failed",
+        progress.result, fm_get_frequency_khz(&radio) / 1000.0, committed ? "committed" : "failed",
+        rda5807_sim_get_register(0x5) & 0xF);
+    expect(!written && progress.result == 0 && is_on_frequency(&radio, stations[2].frequency_khz, 0), "setting nak seek",
+        "seek not cancelled");
+    expect(committed && (rda5807_sim_get_register(0x5) & 0xF) == 4, "setting nak seek", "retried by the next commit");
+
+    fm_power_down(&radio);
+    measurement = begin_measurement();
+    fm_power_up_async(&radio, FM_CONFIG, 0);
+    run_async_task();
+    end_measurement(measurement, "resume");
+    expect(is_on_frequency(&radio, stations[2].frequency_khz, 0), "resume", "previous station retuned");
+
+    // settings restored right after starting power-up wait for the chip
+    fm_power_down(&radio);
+    measurement = begin_measurement();
+    fm_power_up_async(&radio, FM_CONFIG, 0);
+    fm_begin_update(&radio);
+    fm_set_volume(&radio, 9);
+    fm_set_mute(&radio, true);
+    fm_commit_update(&radio);
+    size_t queued = fm_get_queued_command_count(&radio);
+    run_async_task();
+    end_measurement(measurement, "restore settings");
+    printf("%-18s %zu queued, chip volume %u\n", "", queued, rda5807_sim_get_register(0x5) & 0xF);
+    expect(queued == 2 && (rda5807_sim_get_register(0x5) & 0xF) == 9 && fm_get_mute(&radio), "restore settings",
+        "settings applied after power-up");
+
+    fm_power_down(&radio);
+    puts("");
+}
+
+//
+// multi-tuner manager
+//
+
+static void on_manager_task(fm_manager_t *manager, size_t radio_index, fm_async_progress_t progress) {
+    (void)manager;
+    (void)radio_index;
+    manager_seek_result = progress.result;
+}
+
+static void on_manager_rds(fm_manager_t *manager, size_t radio_index, const uint16_t *blocks, uint8_t block_errors) {
+    (void)manager;
+    union
+    {
+        uint16_t group_data[4];
+        rds_group_t group;
+    } rds;
+    memcpy(rds.group_data, blocks, sizeof(rds.group_data));
+    rds_parser_update_with_errors(&manager_rds_parsers[radio_index], &rds.group, block_errors);
+}
+
+static bool has_manager_ps(size_t radio_index) {
+    return rds_get_program_service_name_str(&manager_rds_parsers[radio_index])[0] != '\0';
+}
+
+static void run_manager_benchmark() {
+    // two tuners sharing the bus at different addresses, one seeking while the other reads RDS
+    printf("== manager\n");
+    mock_reset();
+    rda5807_sim_config_t config = rda5807_sim_config_default();
+    rda5807_sim_init(config);
+    size_t second_chip = rda5807_sim_add_chip(config, SECOND_ADDR_SEQUENTIAL, SECOND_ADDR_RANDOM_ACCESS);
+    for (size_t chip = 0; chip <= second_chip; chip++) {
+        rda5807_sim_select_chip(chip);
+        for (size_t i = 0; i < count_of(stations); i++) {
+            rda5807_sim_add_station(&stations[i].sim);
+        }
+    }
+    i2c_init(i2c_default, config.i2c_baudrate);
+    fm_init(&radio, i2c_default, SDIO_PIN, SCLK_PIN, true);
+    fm_init(&second_radio, i2c_default, SDIO_PIN, SCLK_PIN, true);
+    fm_set_i2c_addresses(&second_radio, SECOND_ADDR_SEQUENTIAL, SECOND_ADDR_RANDOM_ACCESS);
+    fm_power_up(&radio, FM_CONFIG);
+    fm_power_up(&second_radio, FM_CONFIG);
+    fm_set_frequency_khz_blocking(&radio, stations[0].frequency_khz);
+    fm_set_frequency_khz_blocking(&second_radio, stations[2].frequency_khz);
+
+    fm_manager_t manager;
+    fm_manager_init(&manager, NULL);
+    fm_manager_add_radio(&manager, &radio);
+    fm_manager_add_radio(&manager, &second_radio);
+    fm_manager_set_task_callback(&manager, &on_manager_task);
+    fm_manager_set_rds_callback(&manager, &on_manager_rds, RDS_POLL_INTERVAL_MS);
+    rds_parser_reset(&manager_rds_parsers[0]);
+    rds_parser_reset(&manager_rds_parsers[1]);
+
+    rda5807_sim_select_chip(second_chip);
+    rda5807_sim_reset_stats();
+    rda5807_sim_select_chip(0);
+    manager_seek_result = 1; // pending
+    measurement_t measurement = begin_measurement();
+    fm_seek_async(&second_radio, FM_SEEK_UP);
+    uint64_t timeout_time = time_us_64() + RDS_TIMEOUT_MS * 1000;
+    while (!(has_manager_ps(0) && has_manager_ps(1) && manager_seek_result != 1) && time_us_64() < timeout_time) {
+        fm_manager_tick(&manager);
+        uint64_t next_time = MIN(fm_manager_get_next_time(&manager), timeout_time);
+        if (time_us_64() < next_time) {
+            sleep_until(from_us_since_boot(next_time));
+        }
+    }
+    end_measurement(measurement, "manager radio 0");
+    rda5807_sim_select_chip(second_chip);
+    end_measurement(measurement, "manager radio 1");
+    rda5807_sim_select_chip(0);
+    printf("%-18s radio 0 PS '%s' on %.1f MHz, radio 1 PS '%s' on %.1f MHz after seek result %d\n", "",
+        rds_get_program_service_name_str(&manager_rds_parsers[0]), fm_get_frequency_khz(&radio) / 1000.0,
+        rds_get_program_service_name_str(&manager_rds_parsers[1]), fm_get_frequency_khz(&second_radio) / 1000.0,
+        manager_seek_result);
+    expect(strcmp(rds_get_program_service_name_str(&manager_rds_parsers[0]), stations[0].ps) == 0
+            && is_on_frequency(&radio, stations[0].frequency_khz, 0),
+        "manager", "radio 0 PS decoded during the seek");
+    expect(manager_seek_result == 0 && is_on_frequency(&second_radio, stations[3].frequency_khz, second_chip)
+            && strcmp(rds_get_program_service_name_str(&manager_rds_parsers[1]), stations[3].ps) == 0,
+        "manager", "radio 1 PS decoded after the seek");
+
+    fm_power_down(&radio);
+    fm_power_down(&second_radio);
+}
+
+int main() {
+    for (size_t i = 0; i < count_of(stations); i++) {
+        build_rds_groups(&stations[i]);
+    }
+    run_benchmark(false);
+    run_benchmark(true);
+    run_manager_benchmark();
+    if (failure_count != 0) {
+        printf("%u checks failed\n", failure_count);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_HARDWARE_DMA_H_
+#define _HOST_HARDWARE_DMA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// DMA isn't simulated, the functions panic if fm_enable_dma() is used on the host
+
+typedef struct dma_channel_config
+{
+    uint32_t ctrl;
+} dma_channel_config;
+
+enum dma_channel_transfer_size
+{
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2,
+};
+
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+    const volatile void *read_addr, uint transfer_count, bool trigger);
+bool dma_channel_is_busy(uint channel);
+void dma_channel_abort(uint channel);
+
+#endif // _HOST_HARDWARE_DMA_H_
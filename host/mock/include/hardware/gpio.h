@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_HARDWARE_GPIO_H_
+#define _HOST_HARDWARE_GPIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+enum gpio_function
+{
+    GPIO_FUNC_I2C = 3,
+    GPIO_FUNC_SIO = 5,
+};
+
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+#define GPIO_OUT 1
+#define GPIO_IN 0
+
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+typedef void (*irq_handler_t)(void);
+
+void gpio_init(uint gpio);
+void gpio_set_function(uint gpio, enum gpio_function fn);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_put(uint gpio, bool value);
+bool gpio_get(uint gpio);
+void gpio_pull_up(uint gpio);
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler);
+uint32_t gpio_get_irq_event_mask(uint gpio);
+void gpio_acknowledge_irq(uint gpio, uint32_t events);
+
+#endif // _HOST_HARDWARE_GPIO_H_
@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_HARDWARE_I2C_H_
+#define _HOST_HARDWARE_I2C_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// only the fields touched by the driver's DMA transport, which isn't simulated
+typedef struct i2c_hw_t
+{
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t raw_intr_stat;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t clr_stop_det;
+    volatile uint32_t enable;
+    volatile uint32_t dma_cr;
+} i2c_hw_t;
+
+typedef struct i2c_inst
+{
+    i2c_hw_t *hw;
+    uint baudrate;
+} i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c_default i2c0
+
+#define I2C_IC_DATA_CMD_CMD_BITS 0x100u
+#define I2C_IC_DATA_CMD_STOP_BITS 0x200u
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x400u
+#define I2C_IC_DMA_CR_TDMAE_BITS 0x2u
+#define I2C_IC_DMA_CR_RDMAE_BITS 0x1u
+#define I2C_IC_RAW_INTR_STAT_STOP_DET_BITS 0x200u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x40u
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us);
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us);
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx);
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) {
+    return i2c->hw;
+}
+
+#endif // _HOST_HARDWARE_I2C_H_
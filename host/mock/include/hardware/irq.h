@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_HARDWARE_IRQ_H_
+#define _HOST_HARDWARE_IRQ_H_
+
+#include <hardware/gpio.h>
+#include <stdbool.h>
+
+#define IO_IRQ_BANK0 13
+
+void irq_set_enabled(uint num, bool enabled);
+
+#endif // _HOST_HARDWARE_IRQ_H_
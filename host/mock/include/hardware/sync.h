@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_HARDWARE_SYNC_H_
+#define _HOST_HARDWARE_SYNC_H_
+
+#include <stdint.h>
+
+// single threaded host, interrupts are raised synchronously by the simulator
+
+static inline void __dmb(void) {
+    __sync_synchronize();
+}
+
+static inline void __mem_fence_acquire(void) {
+    __sync_synchronize();
+}
+
+static inline void __mem_fence_release(void) {
+    __sync_synchronize();
+}
+
+static inline void __wfe(void) {
+}
+
+static inline void __sev(void) {
+}
+
+static inline uint32_t save_and_disable_interrupts(void) {
+    return 0;
+}
+
+static inline void restore_interrupts(uint32_t status) {
+    (void)status;
+}
+
+#endif // _HOST_HARDWARE_SYNC_H_
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_PICO_STDLIB_H_
+#define _HOST_PICO_STDLIB_H_
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define count_of(a) (sizeof(a) / sizeof((a)[0]))
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT -1
+#define PICO_ERROR_GENERIC -2
+
+#define NUM_BANK0_GPIOS 30
+
+void panic(const char *fmt, ...);
+
+static inline void tight_loop_contents(void) {
+}
+
+#include <hardware/gpio.h>
+#include <pico/time.h>
+
+#endif // _HOST_PICO_STDLIB_H_
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _HOST_PICO_TIME_H_
+#define _HOST_PICO_TIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// simulated clock, see mock_advance_to()
+
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t from_us_since_boot(uint64_t us) {
+    return us;
+}
+
+static inline uint64_t to_us_since_boot(absolute_time_t t) {
+    return t;
+}
+
+uint64_t time_us_64(void);
+absolute_time_t get_absolute_time(void);
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void sleep_until(absolute_time_t target);
+void busy_wait_us(uint64_t us);
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+#endif // _HOST_PICO_TIME_H_
@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _PICO_MOCK_H_
+#define _PICO_MOCK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file pico_mock.h
+ *
+ * \brief Pico SDK mocks for host builds.
+ *
+ * Time is simulated: it only moves forward while the driver sleeps or waits, and while
+ * I2C transfers occupy the bus. Sleeping runs the RDA5807 simulator through each pending
+ * event in order, and waiting for an event returns early once the simulator raises
+ * an interrupt.
+ */
+
+/**
+ * \brief Restart simulated time at 0 and clear GPIO callbacks.
+ */
+void mock_reset(void);
+
+/**
+ * \brief Advance simulated time, processing simulator events on the way.
+ *
+ * @param time Target time in µs.
+ * @param stop_on_interrupt Return early if an interrupt is raised.
+ * @return False if stopped by an interrupt.
+ */
+bool mock_advance_to(uint64_t time, bool stop_on_interrupt);
+
+/**
+ * \brief Advance simulated time, e.g. by the duration of a bus transfer.
+ */
+void mock_advance_us(uint64_t us);
+
+/**
+ * \brief Raise a falling edge on a GPIO, calling its IRQ callback if enabled.
+ */
+void mock_raise_gpio_irq(unsigned int gpio);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _PICO_MOCK_H_
@@ -0,0 +1,304 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <pico_mock.h>
+#include <rda5807_sim.h>
+#include <hardware/dma.h>
+#include <hardware/i2c.h>
+#include <hardware/irq.h>
+#include <pico/stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t mock_time_us;
+static uint32_t mock_interrupt_count;
+static gpio_irq_callback_t mock_gpio_callback;
+static uint32_t mock_gpio_irq_mask; // pins with IRQ enabled
+static uint32_t mock_gpio_raw_mask; // pins with a raw handler
+static irq_handler_t mock_raw_handlers[4];
+static size_t mock_raw_handler_count;
+static uint32_t mock_gpio_events[32]; // latched, until acknowledged
+static bool mock_bank_irq_enabled;
+
+static i2c_hw_t i2c0_hw;
+i2c_inst_t i2c0_inst = {&i2c0_hw, 0};
+
+//
+// mock interface
+//
+
+void mock_reset(void) {
+    mock_time_us = 0;
+    mock_interrupt_count = 0;
+    mock_gpio_callback = NULL;
+    mock_gpio_irq_mask = 0;
+    // raw handlers stay installed, the driver only adds them once per pin
+    memset(mock_gpio_events, 0, sizeof(mock_gpio_events));
+    mock_bank_irq_enabled = false;
+}
+
+bool mock_advance_to(uint64_t time, bool stop_on_interrupt) {
+    for (;;) {
+        uint64_t event_time = rda5807_sim_get_next_event_time();
+        if (time < event_time) {
+            break;
+        }
+        if (mock_time_us < event_time) {
+            mock_time_us = event_time;
+        }
+        uint32_t interrupt_count = mock_interrupt_count;
+        rda5807_sim_advance();
+        if (stop_on_interrupt && interrupt_count != mock_interrupt_count) {
+            return false;
+        }
+    }
+    if (mock_time_us < time) {
+        mock_time_us = time;
+    }
+    return true;
+}
+
+void mock_advance_us(uint64_t us) {
+    mock_advance_to(mock_time_us + us, false);
+}
+
+void mock_raise_gpio_irq(unsigned int gpio) {
+    if (!mock_bank_irq_enabled || !(mock_gpio_irq_mask & (1u << gpio))) {
+        return;
+    }
+    mock_interrupt_count++;
+    mock_gpio_events[gpio] |= GPIO_IRQ_EDGE_FALL;
+    // raw handlers run first, and acknowledge their own pins
+    for (size_t i = 0; i < mock_raw_handler_count; i++) {
+        mock_raw_handlers[i]();
+    }
+    if (mock_gpio_callback != NULL && !(mock_gpio_raw_mask & (1u << gpio)) && mock_gpio_events[gpio] != 0) {
+        uint32_t events = mock_gpio_events[gpio];
+        mock_gpio_events[gpio] = 0;
+        mock_gpio_callback(gpio, events);
+    }
+}
+
+//
+// pico/stdlib.h
+//
+
+void panic(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(stderr, fmt, args);
+    va_end(args);
+    fputc('\n', stderr);
+    abort();
+}
+
+//
+// pico/time.h
+//
+
+uint64_t time_us_64(void) {
+    return mock_time_us;
+}
+
+absolute_time_t get_absolute_time(void) {
+    return mock_time_us;
+}
+
+void sleep_us(uint64_t us) {
+    mock_advance_us(us);
+}
+
+void sleep_ms(uint32_t ms) {
+    mock_advance_us((uint64_t)ms * 1000);
+}
+
+void sleep_until(absolute_time_t target) {
+    mock_advance_to(target, false);
+}
+
+void busy_wait_us(uint64_t us) {
+    mock_advance_us(us);
+}
+
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) {
+    return mock_advance_to(timeout_timestamp, true);
+}
+
+//
+// hardware/gpio.h
+//
+
+void gpio_init(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_function(uint gpio, enum gpio_function fn) {
+    (void)gpio;
+    (void)fn;
+}
+
+void gpio_set_dir(uint gpio, bool out) {
+    (void)gpio;
+    (void)out;
+}
+
+void gpio_put(uint gpio, bool value) {
+    (void)gpio;
+    (void)value;
+}
+
+bool gpio_get(uint gpio) {
+    (void)gpio;
+    return true; // bus lines idle high
+}
+
+void gpio_pull_up(uint gpio) {
+    (void)gpio;
+}
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) {
+    mock_gpio_callback = callback;
+    gpio_set_irq_enabled(gpio, events, enabled);
+    mock_bank_irq_enabled = true;
+}
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) {
+    (void)events;
+    if (enabled) {
+        mock_gpio_irq_mask |= 1u << gpio;
+    } else {
+        mock_gpio_irq_mask &= ~(1u << gpio);
+    }
+}
+
+void gpio_add_raw_irq_handler(uint gpio, irq_handler_t handler) {
+    // the SDK asserts on pins claimed twice
+    if ((mock_gpio_raw_mask & (1u << gpio)) || mock_raw_handler_count == count_of(mock_raw_handlers)) {
+        fprintf(stderr, "mock: raw IRQ handler for GPIO %u added twice, or too many handlers\n", gpio);
+        abort();
+    }
+    mock_gpio_raw_mask |= 1u << gpio;
+    mock_raw_handlers[mock_raw_handler_count++] = handler;
+}
+
+uint32_t gpio_get_irq_event_mask(uint gpio) {
+    return mock_gpio_events[gpio];
+}
+
+void gpio_acknowledge_irq(uint gpio, uint32_t events) {
+    mock_gpio_events[gpio] &= ~events;
+}
+
+//
+// hardware/irq.h
+//
+
+void irq_set_enabled(uint num, bool enabled) {
+    if (num == IO_IRQ_BANK0) {
+        mock_bank_irq_enabled = enabled;
+    }
+}
+
+//
+// hardware/i2c.h
+//
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate) {
+    i2c->baudrate = baudrate;
+    return baudrate;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    int result = rda5807_sim_write(addr, src, len);
+    return result < 0 ? PICO_ERROR_GENERIC : result;
+}
+
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop) {
+    (void)i2c;
+    (void)nostop;
+    int result = rda5807_sim_read(addr, dst, len);
+    return result < 0 ? PICO_ERROR_GENERIC : result;
+}
+
+static int mock_i2c_timeout_result(int result, uint timeout_us) {
+    // a stalled transfer only returns after the timeout
+    if (result == RDA5807_SIM_STALL) {
+        mock_advance_us(timeout_us);
+        return PICO_ERROR_TIMEOUT;
+    }
+    return result < 0 ? PICO_ERROR_GENERIC : result;
+}
+
+int i2c_write_timeout_us(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop, uint timeout_us) {
+    (void)i2c;
+    (void)nostop;
+    return mock_i2c_timeout_result(rda5807_sim_write(addr, src, len), timeout_us);
+}
+
+int i2c_read_timeout_us(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop, uint timeout_us) {
+    (void)i2c;
+    (void)nostop;
+    return mock_i2c_timeout_result(rda5807_sim_read(addr, dst, len), timeout_us);
+}
+
+uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) {
+    (void)i2c;
+    (void)is_tx;
+    return 0;
+}
+
+//
+// hardware/dma.h
+//
+
+dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void)channel;
+    panic("mock - DMA transport isn't simulated");
+    return (dma_channel_config){0};
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) {
+    (void)c;
+    (void)size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) {
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) {
+    (void)c;
+    (void)dreq;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+    const volatile void *read_addr, uint transfer_count, bool trigger) {
+    (void)channel;
+    (void)config;
+    (void)write_addr;
+    (void)read_addr;
+    (void)transfer_count;
+    (void)trigger;
+}
+
+bool dma_channel_is_busy(uint channel) {
+    (void)channel;
+    return false;
+}
+
+void dma_channel_abort(uint channel) {
+    (void)channel;
+}
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <rds_capture.h>
+#include <rds_parser.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Replays RDS captures (see rds_capture.h) through rds_parser_t: reports when PS and RT
+// complete in capture time, and parser throughput in groups per second of host time.
+//
+//   rds_replay capture.bin [capture.bin ...]
+
+static const unsigned THROUGHPUT_ROUNDS = 1000;
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(length > 0 ? length : 1);
+    *size = fread(data, 1, length, file);
+    fclose(file);
+    return data;
+}
+
+static uint64_t host_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void replay_decode(rds_capture_reader_t *reader) {
+    // one pass in capture time, noting when the station data completes
+    rds_parser_t parser;
+    rds_parser_reset(&parser);
+    rds_capture_reader_rewind(reader);
+    rds_capture_record_t record;
+    uint64_t time_us = 0;
+    uint32_t group_count = 0;
+    uint32_t error_count = 0; // groups with any uncorrectable block
+    uint64_t ps_time_us = 0;
+    uint64_t rt_time_us = 0;
+    while (rds_capture_reader_next(reader, &record)) {
+        time_us += record.delta_us;
+        group_count++;
+        for (uint8_t errors = record.block_errors; errors != 0; errors >>= 2) {
+            if ((errors & 0x3) == 0x3) {
+                error_count++;
+                break;
+            }
+        }
+        rds_parser_update_with_errors(&parser, &record.group, record.block_errors);
+        if (ps_time_us == 0 && rds_get_program_service_name_str(&parser)[0] != '\0') {
+            ps_time_us = time_us;
+        }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+        if (rt_time_us == 0 && rds_get_radio_text_str(&parser)[0] != '\0' && rds_is_radio_text_complete(&parser)) {
+            rt_time_us = time_us;
+        }
+#endif
+    }
+    char pi_str[5];
+    rds_get_program_id_as_str(&parser, pi_str);
+    printf("%.2f MHz, %lu groups over %.1f s, %lu with uncorrectable blocks%s\n",
+        reader->frequency_khz / 1000.0,
+        (unsigned long)group_count,
+        time_us / 1e6,
+        (unsigned long)error_count,
+        reader->ended ? "" : " (truncated)");
+    printf("  PI: %s, PS: '%s'", pi_str, rds_get_program_service_name_str(&parser));
+    if (ps_time_us != 0) {
+        printf(" complete after %.0f ms\n", ps_time_us / 1e3);
+    } else {
+        puts(" incomplete");
+    }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    printf("  RT: '%s'", rds_get_radio_text_str(&parser));
+    if (rt_time_us != 0) {
+        printf(" complete after %.0f ms\n", rt_time_us / 1e3);
+    } else {
+        puts(" incomplete");
+    }
+#endif
+}
+
+static void replay_throughput(rds_capture_reader_t *reader) {
+    // decode the records once, then push them through the parser back to back
+    size_t capacity = 0;
+    rds_capture_record_t record;
+    rds_capture_reader_rewind(reader);
+    while (rds_capture_reader_next(reader, &record)) {
+        capacity++;
+    }
+    if (capacity == 0) {
+        return;
+    }
+    rds_capture_record_t *records = malloc(capacity * sizeof(rds_capture_record_t));
+    size_t count = 0;
+    rds_capture_reader_rewind(reader);
+    while (count < capacity && rds_capture_reader_next(reader, &records[count])) {
+        count++;
+    }
+
+    rds_parser_t parser;
+    uint64_t start_ns = host_time_ns();
+    for (unsigned round = 0; round < THROUGHPUT_ROUNDS; round++) {
+        rds_parser_reset(&parser);
+        for (size_t i = 0; i < count; i++) {
+            rds_parser_update_with_errors(&parser, &records[i].group, records[i].block_errors);
+        }
+    }
+    uint64_t elapsed_ns = host_time_ns() - start_ns;
+    double groups = (double)count * THROUGHPUT_ROUNDS;
+    printf("  parser: %.0f groups/s, %.1f ns/group\n", groups * 1e9 / elapsed_ns, elapsed_ns / groups);
+    free(records);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s capture.bin [capture.bin ...]\n", argv[0]);
+        return 2;
+    }
+    int status = 0;
+    for (int i = 1; i < argc; i++) {
+        size_t size;
+        uint8_t *data = read_file(argv[i], &size);
+        if (data == NULL) {
+            fprintf(stderr, "%s: can't read\n", argv[i]);
+            status = 1;
+            continue;
+        }
+        // a file may hold several captures, e.g. a session log
+        printf("== %s\n", argv[i]);
+        size_t offset = 0;
+        rds_capture_reader_t reader;
+        bool found = false;
+        while (rds_capture_reader_init(&reader, &data[offset], size - offset)) {
+            found = true;
+            replay_decode(&reader);
+            replay_throughput(&reader); // leaves the reader past the last record
+            offset = (reader.data - data) + reader.offset;
+        }
+        if (!found) {
+            fprintf(stderr, "%s: no capture found\n", argv[i]);
+            status = 1;
+        }
+        free(data);
+    }
+    return status;
+}
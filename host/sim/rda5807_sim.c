@@ -0,0 +1,529 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include "fm_rda5807_regs.h"
+#include <rda5807_sim.h>
+#include <pico_mock.h>
+#include <pico/time.h>
+#include <assert.h>
+#include <string.h>
+
+#define SIM_MAX_STATIONS 32
+
+#define sim_get_bit(reg, bit) (((reg) & bit##_BIT) != 0)
+#define sim_get_bits(reg, bits) (((reg) & (bits##_BITS)) >> bits##_LSB)
+
+static const uint16_t SIM_RESET_REGS[16] = {
+    [0x0] = 0x5804, // chip ID
+    [0x3] = 0x4FC0,
+    [0x4] = 0x0400,
+    [0x5] = 0x888B,
+    [0x7] = 0x42C6,
+    [0xA] = 0x013F,
+};
+
+typedef struct sim_op_t
+{
+    bool pending;
+    bool seek;
+    bool failed;
+    int direction; // seek step, in channels
+    uint32_t start_khz;
+    uint32_t target_khz;
+    uint64_t start_time;
+    uint64_t done_time;
+} sim_op_t;
+
+typedef struct sim_chip_t
+{
+    uint8_t addr_sequential;
+    uint8_t addr_random_access;
+    rda5807_sim_config_t config;
+    rda5807_sim_stats_t stats;
+    const rda5807_sim_station_t *stations[SIM_MAX_STATIONS];
+    size_t station_count;
+    uint16_t regs[16];
+    uint8_t selected_reg; // for random access reads
+    uint64_t ready_time;
+    sim_op_t op;
+    bool stc;
+    bool sf;
+    uint32_t frequency_khz;
+    uint64_t tuned_time;
+    const rda5807_sim_station_t *station; // tuned station, NULL while tuning
+    size_t rds_index;
+    uint64_t next_rds_time;
+    bool rdsr;
+    uint16_t rds_blocks[4];
+    uint8_t rds_block_errors;
+    uint32_t fault_naks; // injected faults left
+    uint32_t fault_stalls;
+} sim_chip_t;
+
+static sim_chip_t sim_chips[RDA5807_SIM_MAX_CHIPS];
+static size_t sim_chip_count;
+static sim_chip_t *sim_selected; // target of the public interface
+static sim_chip_t *sim; // chip being simulated
+
+//
+// chip model
+//
+
+static bool sim_is_enabled() {
+    return sim_get_bit(sim->regs[0x2], ENABLE);
+}
+
+static void sim_get_range(uint32_t *bottom, uint32_t *top, uint32_t *spacing) {
+    static const uint32_t SPACINGS[] = {100, 200, 50, 25};
+    uint16_t reg3 = sim->regs[0x3];
+    *spacing = SPACINGS[sim_get_bits(reg3, SPACE)];
+    switch (sim_get_bits(reg3, BAND)) {
+    case 0b00:
+        *bottom = 87000;
+        *top = 108000;
+        break;
+    case 0b01:
+        *bottom = 76000;
+        *top = 91000;
+        break;
+    case 0b10:
+        *bottom = 76000;
+        *top = 108000;
+        break;
+    default:
+        *bottom = sim_get_bit(sim->regs[0x7], BAND_65M_50M_MODE) ? 65000 : 50000;
+        *top = 76000;
+        break;
+    }
+}
+
+static const rda5807_sim_station_t *sim_find_station(uint32_t frequency_khz) {
+    for (size_t i = 0; i < sim->station_count; i++) {
+        if (sim->stations[i]->frequency_khz == frequency_khz) {
+            return sim->stations[i];
+        }
+    }
+    return NULL;
+}
+
+static bool sim_is_seek_stop(uint32_t frequency_khz) {
+    const rda5807_sim_station_t *station = sim_find_station(frequency_khz);
+    uint8_t seek_threshold = sim_get_bits(sim->regs[0x5], SEEKTH);
+    if (station == NULL || station->rssi < sim->config.noise_rssi + seek_threshold) {
+        return false;
+    }
+    bool rssi_mode = sim_get_bits(sim->regs[0x5], SEEK_MODE) == 0b10;
+    return !rssi_mode || sim_get_bits(sim->regs[0x7], SEEK_TH_OLD) <= station->rssi;
+}
+
+static bool sim_has_interrupt_output() {
+    return sim->config.interrupt_pin >= 0 && sim_get_bits(sim->regs[0x4], GPIO2) == 0b01;
+}
+
+static void sim_raise_interrupt() {
+    sim->stats.interrupts++;
+    mock_raise_gpio_irq(sim->config.interrupt_pin);
+}
+
+static void sim_set_station(uint32_t frequency_khz) {
+    sim->frequency_khz = frequency_khz;
+    sim->station = sim_find_station(frequency_khz);
+    sim->tuned_time = time_us_64();
+    sim->rds_index = 0;
+    sim->rdsr = false;
+    sim->next_rds_time = sim->tuned_time + sim->config.rds_sync_us;
+}
+
+static void sim_complete_op() {
+    sim->op.pending = false;
+    sim->stc = true;
+    sim->sf = sim->op.failed;
+    sim_set_station(sim->op.target_khz);
+    if (sim_has_interrupt_output() && sim_get_bit(sim->regs[0x4], STCIEN)) {
+        sim_raise_interrupt();
+    }
+}
+
+static void sim_start_op(bool seek, uint32_t target_khz, uint64_t duration_us) {
+    sim->op = (sim_op_t){
+        .pending = true,
+        .seek = seek,
+        .start_khz = sim->frequency_khz,
+        .target_khz = target_khz,
+        .start_time = time_us_64(),
+        .done_time = time_us_64() + duration_us,
+    };
+    sim->stc = false;
+    sim->sf = false;
+    sim->station = NULL;
+    sim->rdsr = false;
+}
+
+static void sim_start_tune() {
+    uint32_t bottom, top, spacing;
+    sim_get_range(&bottom, &top, &spacing);
+    uint32_t frequency_khz;
+    if (sim_get_bit(sim->regs[0x7], FREQ_MODE)) {
+        frequency_khz = bottom + sim->regs[0x8];
+    } else {
+        frequency_khz = bottom + sim_get_bits(sim->regs[0x3], CHAN) * spacing;
+    }
+    if (top < frequency_khz) {
+        frequency_khz = top;
+    }
+    sim_start_op(false, frequency_khz, sim->config.tune_us);
+}
+
+static void sim_start_seek() {
+    uint32_t bottom, top, spacing;
+    sim_get_range(&bottom, &top, &spacing);
+    uint16_t reg2 = sim->regs[0x2];
+    int direction = sim_get_bit(reg2, SEEKUP) ? 1 : -1;
+    bool wrap = !sim_get_bit(reg2, SKMODE);
+    int channel_count = (top - bottom) / spacing + 1;
+    int start = (sim->frequency_khz < bottom) ? 0 : (int)((sim->frequency_khz - bottom) / spacing);
+    int channel = start;
+    int steps = 0;
+    bool found = false;
+    while (steps < channel_count) {
+        channel += direction;
+        steps++;
+        if (channel < 0 || channel_count <= channel) {
+            if (!wrap) {
+                channel -= direction;
+                break; // stop at band limit
+            }
+            channel = (channel + channel_count) % channel_count;
+        }
+        if (sim_is_seek_stop(bottom + channel * spacing)) {
+            found = true;
+            break;
+        }
+    }
+    uint32_t target_khz = (found || !wrap) ? bottom + channel * spacing : sim->frequency_khz;
+    sim_start_op(true, target_khz, (uint64_t)steps * sim->config.seek_channel_us);
+    sim->op.direction = direction;
+    sim->op.failed = !found;
+}
+
+static void sim_write_register(size_t reg_index, uint16_t value) {
+    if (reg_index < 0x2 || 0x9 < reg_index) {
+        return; // read-only
+    }
+    uint16_t old_value = sim->regs[reg_index];
+    if (reg_index == 0x2 && (value & SOFT_RESET_BIT)) {
+        memcpy(sim->regs, SIM_RESET_REGS, sizeof(sim->regs));
+        sim->op.pending = false;
+        sim->stc = false;
+        sim->sf = false;
+        old_value = 0;
+    }
+    sim->regs[reg_index] = value;
+
+    if (reg_index == 0x2) {
+        bool enabled = (value & ENABLE_BIT) != 0;
+        if (enabled && !(old_value & ENABLE_BIT)) {
+            sim->ready_time = time_us_64() + sim->config.ready_delay_us;
+        } else if (!enabled) {
+            sim->op.pending = false;
+            sim->station = NULL;
+            sim->rdsr = false;
+        }
+        bool seek = enabled && (value & SEEK_BIT);
+        bool seeking = sim->op.pending && sim->op.seek;
+        if (seek && (!(old_value & SEEK_BIT) || seeking)) {
+            if (seeking) {
+                // the chip starts over on every write with SEEK set, from where it got to
+                sim->stats.restarts++;
+                sim->frequency_khz = rda5807_sim_get_frequency_khz();
+            }
+            sim_start_seek();
+        } else if (!seek && (old_value & SEEK_BIT) && sim->op.pending && sim->op.seek) {
+            // cancelled, stop where the seek got to
+            sim->op.pending = false;
+            sim_set_station(rda5807_sim_get_frequency_khz());
+        }
+    } else if (reg_index == 0x3) {
+        bool tune = sim_is_enabled() && (value & TUNE_BIT);
+        bool tuning = sim->op.pending && !sim->op.seek;
+        if (tune && (!(old_value & TUNE_BIT) || tuning)) {
+            if (tuning) {
+                sim->stats.restarts++; // likewise for TUNE
+            }
+            sim_start_tune();
+        }
+    }
+}
+
+static uint16_t sim_read_register(size_t reg_index) {
+    uint64_t now = time_us_64();
+    const rda5807_sim_station_t *station = sim->station;
+    switch (reg_index) {
+    case 0xA: {
+        uint32_t bottom, top, spacing;
+        sim_get_range(&bottom, &top, &spacing);
+        uint32_t frequency_khz = rda5807_sim_get_frequency_khz();
+        uint16_t channel = (bottom <= frequency_khz) ? (frequency_khz - bottom) / spacing : 0;
+        bool stereo = station != NULL && station->stereo && !sim_get_bit(sim->regs[0x2], MONO);
+        bool rds_sync = station != NULL && station->rds_groups != NULL && sim->tuned_time + sim->config.rds_sync_us <= now;
+        return (sim->rdsr ? RDSR_BIT : 0) | (sim->stc ? STC_BIT : 0) | (sim->sf ? SF_BIT : 0) | (rds_sync ? RDSS_BIT : 0)
+            | (stereo ? ST_BIT : 0) | (channel & 0x3FF);
+    }
+    case 0xB: {
+        uint8_t rssi = (station != NULL) ? station->rssi : sim->config.noise_rssi;
+        bool ready = sim_is_enabled() && sim->ready_time <= now;
+        uint8_t blera = sim->rds_block_errors & 0x3;
+        uint8_t blerb = (sim->rds_block_errors >> 2) & 0x3;
+        return ((rssi & 0x7F) << RSSI_LSB) | (station != NULL && !station->spur ? FM_TRUE_BIT : 0) | (ready ? FM_READY_BIT : 0)
+            | (blera << BLERA_LSB) | (blerb << BLERB_LSB);
+    }
+    case 0xC:
+    case 0xD:
+    case 0xE:
+    case 0xF:
+        return sim->rds_blocks[reg_index - 0xC];
+    default:
+        return sim->regs[reg_index];
+    }
+}
+
+static sim_chip_t *sim_find_chip(uint8_t addr) {
+    for (size_t i = 0; i < sim_chip_count; i++) {
+        sim_chip_t *chip = &sim_chips[i];
+        if (addr == chip->addr_sequential || addr == chip->addr_random_access) {
+            return chip;
+        }
+    }
+    return NULL;
+}
+
+static int sim_begin_transfer(uint8_t addr, size_t len) {
+    // returns 0, or the rda5807_sim_write() / rda5807_sim_read() error, and simulates the
+    // addressed chip until the transfer ends (a NAK for no chip is counted on the selected one)
+    rda5807_sim_advance();
+    sim_chip_t *chip = sim_find_chip(addr);
+    sim = (chip != NULL) ? chip : sim_selected;
+    bool acked = chip != NULL && sim->config.bus_delay_us <= time_us_64();
+    int result = acked ? 0 : -1;
+    if (acked && sim->fault_naks != 0) {
+        sim->fault_naks--;
+        result = -1;
+    } else if (acked && sim->fault_stalls != 0) {
+        sim->fault_stalls--;
+        result = RDA5807_SIM_STALL;
+    }
+    size_t byte_count = (result == 0) ? len + 1 : 1; // address byte
+    uint64_t bus_us = (uint64_t)byte_count * 9 * 1000000 / sim->config.i2c_baudrate;
+    sim->stats.transactions++;
+    sim->stats.bus_us += bus_us;
+    mock_advance_us(bus_us);
+    if (result == -1) {
+        sim->stats.naks++;
+    } else if (result == RDA5807_SIM_STALL) {
+        sim->stats.stalls++;
+    }
+    return result;
+}
+
+//
+// public interface
+//
+
+static void sim_init_chip(sim_chip_t *chip, rda5807_sim_config_t config, uint8_t sequential_addr, uint8_t random_access_addr) {
+    memset(chip, 0, sizeof(sim_chip_t));
+    chip->addr_sequential = sequential_addr;
+    chip->addr_random_access = random_access_addr;
+    chip->config = config;
+    memcpy(chip->regs, SIM_RESET_REGS, sizeof(chip->regs));
+    chip->frequency_khz = 87000;
+}
+
+void rda5807_sim_init(rda5807_sim_config_t config) {
+    sim_init_chip(&sim_chips[0], config, RDA5807_ADDR_SEQUENTIAL, RDA5807_ADDR_RANDOM_ACCESS);
+    sim_chip_count = 1;
+    sim_selected = sim = &sim_chips[0];
+}
+
+size_t rda5807_sim_add_chip(rda5807_sim_config_t config, uint8_t sequential_addr, uint8_t random_access_addr) {
+    assert(0 < sim_chip_count && sim_chip_count < RDA5807_SIM_MAX_CHIPS);
+    assert(sim_find_chip(sequential_addr) == NULL && sim_find_chip(random_access_addr) == NULL);
+
+    size_t chip_index = sim_chip_count++;
+    sim_init_chip(&sim_chips[chip_index], config, sequential_addr, random_access_addr);
+    return chip_index;
+}
+
+void rda5807_sim_select_chip(size_t chip_index) {
+    assert(chip_index < sim_chip_count);
+
+    sim_selected = sim = &sim_chips[chip_index];
+}
+
+void rda5807_sim_add_station(const rda5807_sim_station_t *station) {
+    if (sim->station_count < SIM_MAX_STATIONS) {
+        sim->stations[sim->station_count++] = station;
+    }
+}
+
+const rda5807_sim_config_t *rda5807_sim_get_config(void) {
+    return &sim->config;
+}
+
+const rda5807_sim_stats_t *rda5807_sim_get_stats(void) {
+    return &sim->stats;
+}
+
+void rda5807_sim_reset_stats(void) {
+    memset(&sim->stats, 0, sizeof(sim->stats));
+}
+
+uint16_t rda5807_sim_get_register(size_t reg_index) {
+    return sim_read_register(reg_index & 0xF);
+}
+
+uint32_t rda5807_sim_get_frequency_khz(void) {
+    if (!sim->op.pending || !sim->op.seek) {
+        return sim->op.pending ? sim->op.target_khz : sim->frequency_khz;
+    }
+    // seek in progress, step through channels over time
+    uint32_t bottom, top, spacing;
+    sim_get_range(&bottom, &top, &spacing);
+    int channel_count = (top - bottom) / spacing + 1;
+    int steps = (time_us_64() - sim->op.start_time) / sim->config.seek_channel_us;
+    int channel = (int)((sim->op.start_khz - bottom) / spacing) + sim->op.direction * steps;
+    channel = ((channel % channel_count) + channel_count) % channel_count;
+    return bottom + channel * spacing;
+}
+
+static int sim_write(uint8_t addr, const uint8_t *src, size_t len) {
+    int result = sim_begin_transfer(addr, len);
+    if (result < 0) {
+        return result;
+    }
+    sim->stats.bytes_written += len;
+    size_t reg_index = 0x2;
+    size_t i = 0;
+    if (addr == sim->addr_random_access) {
+        if (len == 0) {
+            return 0;
+        }
+        reg_index = src[i++];
+        sim->selected_reg = reg_index;
+    }
+    for (; i + 1 < len; i += 2) {
+        sim_write_register(reg_index++ & 0xF, (src[i] << 8) | src[i + 1]);
+    }
+    return len;
+}
+
+static int sim_read(uint8_t addr, uint8_t *dst, size_t len) {
+    int result = sim_begin_transfer(addr, len);
+    if (result < 0) {
+        return result;
+    }
+    sim->stats.bytes_read += len;
+    size_t reg_index = (addr == sim->addr_random_access) ? sim->selected_reg : 0xA;
+    for (size_t i = 0; i < len; i += 2) {
+        uint16_t reg = sim_read_register(reg_index);
+        dst[i] = reg >> 8;
+        if (i + 1 < len) {
+            dst[i + 1] = reg & 0xFF;
+            if (reg_index == 0xF) {
+                sim->rdsr = false; // group taken
+            }
+        }
+        reg_index = (reg_index + 1) & 0xF;
+    }
+    return len;
+}
+
+int rda5807_sim_write(uint8_t addr, const uint8_t *src, size_t len) {
+    int result = sim_write(addr, src, len);
+    sim = sim_selected;
+    return result;
+}
+
+int rda5807_sim_read(uint8_t addr, uint8_t *dst, size_t len) {
+    int result = sim_read(addr, dst, len);
+    sim = sim_selected;
+    return result;
+}
+
+void rda5807_sim_brown_out(void) {
+    memcpy(sim->regs, SIM_RESET_REGS, sizeof(sim->regs));
+    sim->op.pending = false;
+    sim->stc = false;
+    sim->sf = false;
+    sim->station = NULL;
+    sim->rdsr = false;
+}
+
+void rda5807_sim_inject_faults(uint32_t nak_count, uint32_t stall_count) {
+    sim->fault_naks = nak_count;
+    sim->fault_stalls = stall_count;
+}
+
+static uint64_t sim_get_next_event_time() {
+    if (sim->op.pending) {
+        return sim->op.done_time;
+    }
+    const rda5807_sim_station_t *station = sim->station;
+    if (sim_is_enabled() && station != NULL && station->rds_groups != NULL && station->rds_group_count != 0) {
+        return sim->next_rds_time;
+    }
+    return UINT64_MAX;
+}
+
+static void sim_advance() {
+    uint64_t now = time_us_64();
+    if (sim->op.pending && sim->op.done_time <= now) {
+        sim_complete_op();
+    }
+    const rda5807_sim_station_t *station = sim->station;
+    if (!sim_is_enabled() || station == NULL || station->rds_groups == NULL || station->rds_group_count == 0) {
+        return;
+    }
+    bool arrived = false;
+    while (sim->next_rds_time <= now) {
+        if (sim->rdsr) {
+            sim->stats.rds_groups_dropped++;
+        }
+        size_t index = sim->rds_index;
+        memcpy(sim->rds_blocks, station->rds_groups[index], sizeof(sim->rds_blocks));
+        sim->rds_block_errors = (station->rds_block_errors != NULL) ? station->rds_block_errors[index] : 0;
+        sim->rds_index = (index + 1) % station->rds_group_count;
+        sim->rdsr = true;
+        sim->stats.rds_groups_sent++;
+        sim->next_rds_time += sim->config.rds_group_us;
+        arrived = true;
+    }
+    if (arrived && sim_has_interrupt_output() && sim_get_bit(sim->regs[0x4], RDSIEN)) {
+        sim_raise_interrupt();
+    }
+}
+
+uint64_t rda5807_sim_get_next_event_time(void) {
+    sim_chip_t *current = sim; // also called by the mock clock during a transfer
+    uint64_t next_time = UINT64_MAX;
+    for (size_t i = 0; i < sim_chip_count; i++) {
+        sim = &sim_chips[i];
+        uint64_t time = sim_get_next_event_time();
+        if (time < next_time) {
+            next_time = time;
+        }
+    }
+    sim = current;
+    return next_time;
+}
+
+void rda5807_sim_advance(void) {
+    sim_chip_t *current = sim;
+    for (size_t i = 0; i < sim_chip_count; i++) {
+        sim = &sim_chips[i];
+        sim_advance();
+    }
+    sim = current;
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDA5807_SIM_H_
+#define _RDA5807_SIM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rda5807_sim.h
+ *
+ * \brief Register-level RDA5807 simulator for host builds.
+ *
+ * Answers the mocked I2C bus on the sequential (0x10) and random access (0x11) addresses.
+ * More chips may be added on translated addresses, as behind an address translator, to
+ * simulate several tuners sharing the bus.
+ * Tune, seek and power-up complete after configurable delays of simulated time, RSSI comes
+ * from a table of stations, and stations with RDS cycle through their groups at the real
+ * group rate. A group that isn't read before the next one arrives is counted as dropped.
+ *
+ * Simplifications: a new RDS group stays flagged by RDSR until register 0xF is read, seek
+ * stops on the first station whose RSSI is at least SEEKTH above the noise floor (and at
+ * least SEEK_TH_OLD with SEEK_MODE 0b10), and the RDS FIFO is one group deep.
+ */
+
+#define RDA5807_SIM_MAX_CHIPS 4
+
+/**
+ * \brief Simulated station.
+ */
+typedef struct rda5807_sim_station_t
+{
+    uint32_t frequency_khz;
+    uint8_t rssi;
+    bool stereo;
+    bool spur; // stops a seek, but isn't flagged FM_TRUE
+    const uint16_t (*rds_groups)[4]; // NULL for no RDS
+    const uint8_t *rds_block_errors; // per group, packed like fm_get_rds_block_errors(), may be NULL
+    size_t rds_group_count;
+} rda5807_sim_station_t;
+
+/**
+ * \brief Chip timing.
+ */
+typedef struct rda5807_sim_config_t
+{
+    uint32_t bus_delay_us; // chip NAKs until this time, after power-on
+    uint32_t ready_delay_us; // ENABLE to FM_READY
+    uint32_t tune_us; // TUNE to STC
+    uint32_t seek_channel_us; // per channel stepped during seek
+    uint32_t rds_sync_us; // tune to RDS sync
+    uint32_t rds_group_us; // RDS group period
+    uint32_t i2c_baudrate;
+    uint8_t noise_rssi; // RSSI without a station
+    int interrupt_pin; // raised on STC and RDS groups when GPIO2 is the interrupt output, -1 for none
+} rda5807_sim_config_t;
+
+static inline rda5807_sim_config_t rda5807_sim_config_default() {
+    return (rda5807_sim_config_t){
+        .bus_delay_us = 0,
+        .ready_delay_us = 50000,
+        .tune_us = 40000,
+        .seek_channel_us = 8000,
+        .rds_sync_us = 100000,
+        .rds_group_us = 87600,
+        .i2c_baudrate = 400000,
+        .noise_rssi = 10,
+        .interrupt_pin = -1,
+    };
+}
+
+/**
+ * \brief Bus traffic.
+ */
+typedef struct rda5807_sim_stats_t
+{
+    uint32_t transactions; // each START ... STOP, counting repeated starts
+    uint32_t bytes_written;
+    uint32_t bytes_read;
+    uint32_t naks;
+    uint32_t stalls;
+    uint64_t bus_us; // simulated time spent on the bus
+    uint32_t rds_groups_sent;
+    uint32_t rds_groups_dropped;
+    uint32_t interrupts;
+    uint32_t restarts; // seek / tune restarted by a write with SEEK / TUNE set while pending
+} rda5807_sim_stats_t;
+
+/**
+ * \brief Reset the chip to power-on state, removing all stations and added chips.
+ *
+ * Chip 0 answers on the default addresses and is selected.
+ *
+ * @param config Chip timing.
+ */
+void rda5807_sim_init(rda5807_sim_config_t config);
+
+/**
+ * \brief Add another chip to the bus, in power-on state and without stations.
+ *
+ * @param config Chip timing, the interrupt pin should differ from other chips.
+ * @param sequential_addr Address for sequential register access.
+ * @param random_access_addr Address for random register access.
+ * @return Chip index, for rda5807_sim_select_chip().
+ */
+size_t rda5807_sim_add_chip(rda5807_sim_config_t config, uint8_t sequential_addr, uint8_t random_access_addr);
+
+/**
+ * \brief Select the chip that the other calls below apply to.
+ *
+ * Bus transfers reach every chip by address, regardless of the selection.
+ *
+ * @param chip_index Chip index, 0 for the chip set up by rda5807_sim_init().
+ */
+void rda5807_sim_select_chip(size_t chip_index);
+
+/**
+ * \brief Add a station, the data must stay valid while simulating.
+ */
+void rda5807_sim_add_station(const rda5807_sim_station_t *station);
+
+const rda5807_sim_config_t *rda5807_sim_get_config(void);
+const rda5807_sim_stats_t *rda5807_sim_get_stats(void);
+void rda5807_sim_reset_stats(void);
+
+/**
+ * \brief Get a register as currently seen by the chip.
+ */
+uint16_t rda5807_sim_get_register(size_t reg_index);
+
+/**
+ * \brief Frequency the chip is tuned to, or being tuned to.
+ */
+uint32_t rda5807_sim_get_frequency_khz(void);
+
+//
+// mock interface
+//
+
+/**
+ * \brief rda5807_sim_write() / rda5807_sim_read() result when the bus stalled.
+ */
+#define RDA5807_SIM_STALL (-2)
+
+/**
+ * \brief Handle an I2C segment, returns bytes transferred, -1 for NAK or RDA5807_SIM_STALL.
+ */
+int rda5807_sim_write(uint8_t addr, const uint8_t *src, size_t len);
+int rda5807_sim_read(uint8_t addr, uint8_t *dst, size_t len);
+
+/**
+ * \brief Simulate a supply dip, the chip resets and stays powered down until enabled.
+ */
+void rda5807_sim_brown_out(void);
+
+/**
+ * \brief Fail upcoming transactions, to exercise driver error handling.
+ *
+ * The next nak_count transactions are NAKed, the stall_count after them hold the bus until
+ * the driver times out.
+ */
+void rda5807_sim_inject_faults(uint32_t nak_count, uint32_t stall_count);
+
+/**
+ * \brief Time of the next internal event on any chip, UINT64_MAX if none.
+ */
+uint64_t rda5807_sim_get_next_event_time(void);
+
+/**
+ * \brief Process events due at the current simulated time, on all chips.
+ */
+void rda5807_sim_advance(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RDA5807_SIM_H_
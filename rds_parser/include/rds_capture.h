@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDS_CAPTURE_H_
+#define _RDS_CAPTURE_H_
+
+#include <rds_parser.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rds_capture.h
+ *
+ * \brief Compact binary recording of received RDS groups.
+ *
+ * A capture holds the groups of one station, as read with fm_read_rds_group(), so that
+ * real-world reception can be replayed through rds_parser_t later.
+ *
+ * Layout, multi-byte fields big-endian:
+ *
+ * | field          | size | notes                                            |
+ * | -------------- | ---- | ------------------------------------------------ |
+ * | magic          | 4    | "RDSC"                                           |
+ * | version        | 1    | RDS_CAPTURE_VERSION                              |
+ * | frequency_khz  | 4    |                                                  |
+ * | records...     |      |                                                  |
+ *
+ * Each record is an error byte in the format of fm_get_rds_block_errors(), the time since
+ * the previous record (or since the capture began) in µs as an unsigned LEB128 varint, and
+ * blocks A-D. Typical records take 12 bytes. An error byte of RDS_CAPTURE_END terminates
+ * the capture, so groups with all 4 blocks uncorrectable are not recorded.
+ *
+ * The reader skips any bytes before the magic, e.g. console output logged along with a
+ * capture streamed over stdio.
+ */
+
+#define RDS_CAPTURE_VERSION 1
+#define RDS_CAPTURE_HEADER_SIZE 9
+#define RDS_CAPTURE_MAX_RECORD_SIZE 14
+#define RDS_CAPTURE_END 0xFF // error byte marking the end
+
+/**
+ * \brief Recorded RDS group.
+ */
+typedef struct rds_capture_record_t
+{
+    uint32_t delta_us; // since the previous record
+    rds_group_t group;
+    uint8_t block_errors; // 2-bit error level per block, A in bits 0-1 ... D in bits 6-7
+} rds_capture_record_t;
+
+/**
+ * \brief Receives capture bytes, e.g. writes them to stdio or a file.
+ */
+typedef void (*rds_capture_write_t)(const uint8_t *data, size_t size, void *user_data);
+
+/**
+ * \brief Capture writer.
+ */
+typedef struct rds_capture_writer_t
+{
+    rds_capture_write_t write;
+    void *user_data;
+    uint64_t last_time; // µs since boot
+    bool active;
+} rds_capture_writer_t;
+
+/**
+ * \brief Capture reader over a memory buffer.
+ */
+typedef struct rds_capture_reader_t
+{
+    const uint8_t *data;
+    size_t size;
+    size_t offset;
+    uint32_t frequency_khz;
+    bool ended; // end marker read
+} rds_capture_reader_t;
+
+/**
+ * \brief Initialize the writer.
+ *
+ * @param writer Capture writer.
+ * @param write Output callback.
+ * @param user_data Passed to the output callback.
+ */
+void rds_capture_writer_init(rds_capture_writer_t *writer, rds_capture_write_t write, void *user_data);
+
+/**
+ * \brief Start a capture, writing the header.
+ *
+ * A capture still in progress is ended first.
+ *
+ * @param writer Capture writer.
+ * @param frequency_khz Tuned frequency.
+ * @param now Current time in µs since boot.
+ */
+void rds_capture_writer_begin(rds_capture_writer_t *writer, uint32_t frequency_khz, uint64_t now);
+
+/**
+ * \brief Record an RDS group.
+ *
+ * Ignored if no capture is in progress.
+ *
+ * @param writer Capture writer.
+ * @param blocks RDS blocks A-D.
+ * @param block_errors Error levels, as returned by fm_get_rds_block_errors().
+ * @param now Time the group was read in µs since boot.
+ */
+void rds_capture_writer_add(rds_capture_writer_t *writer, const uint16_t *blocks, uint8_t block_errors, uint64_t now);
+
+/**
+ * \brief End the capture, writing the end marker.
+ *
+ * @param writer Capture writer.
+ */
+void rds_capture_writer_end(rds_capture_writer_t *writer);
+
+/**
+ * \brief Check if a capture is in progress.
+ *
+ * @param writer Capture writer.
+ */
+static inline bool rds_capture_writer_is_active(const rds_capture_writer_t *writer) {
+    return writer->active;
+}
+
+/**
+ * \brief Open a capture.
+ *
+ * @param reader Capture reader.
+ * @param data Capture bytes, must outlive the reader.
+ * @param size Byte count.
+ * @return true Header found.
+ * @return false No capture of a supported version in the data.
+ */
+bool rds_capture_reader_init(rds_capture_reader_t *reader, const uint8_t *data, size_t size);
+
+/**
+ * \brief Read the next record.
+ *
+ * @param reader Capture reader.
+ * @param record Output record.
+ * @return true Record read.
+ * @return false End of capture, or truncated record.
+ */
+bool rds_capture_reader_next(rds_capture_reader_t *reader, rds_capture_record_t *record);
+
+/**
+ * \brief Rewind to the first record.
+ *
+ * @param reader Capture reader.
+ */
+void rds_capture_reader_rewind(rds_capture_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RDS_CAPTURE_H_
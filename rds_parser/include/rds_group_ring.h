@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDS_GROUP_RING_H_
+#define _RDS_GROUP_RING_H_
+
+#include <rds_parser.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rds_group_ring.h
+ *
+ * \brief Lock-free queue of RDS groups between two cores.
+ *
+ * One core pushes groups as they are read from the tuner, the other pops them into an
+ * rds_parser_t. There is exactly one producer and one consumer, so no locking is needed
+ * and neither side ever blocks.
+ *
+ */
+
+#ifndef RDS_GROUP_RING_CAPACITY
+#define RDS_GROUP_RING_CAPACITY 16 // must be a power of two
+#endif
+
+static_assert((RDS_GROUP_RING_CAPACITY & (RDS_GROUP_RING_CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+/**
+ * \brief Queued RDS group.
+ */
+typedef struct rds_group_ring_entry_t
+{
+    rds_group_t group;
+    uint8_t block_errors; // 2-bit error level per block, A in bits 0-1 ... D in bits 6-7
+} rds_group_ring_entry_t;
+
+/**
+ * \brief Single-producer / single-consumer ring buffer of RDS groups.
+ */
+typedef struct rds_group_ring_t
+{
+    volatile uint32_t head; // written by producer
+    volatile uint32_t tail; // written by consumer
+    uint32_t dropped_count; // written by producer
+    rds_group_ring_entry_t entries[RDS_GROUP_RING_CAPACITY];
+} rds_group_ring_t;
+
+/**
+ * \brief Empty the ring.
+ * 
+ * Must not be called while the producer or consumer is active.
+ * 
+ * @param ring Group ring.
+ */
+void rds_group_ring_init(rds_group_ring_t *ring);
+
+/**
+ * \brief Queue an RDS group.
+ * 
+ * May only be called from the producer side. If the ring is full the group is dropped.
+ * 
+ * @param ring Group ring.
+ * @param group RDS group.
+ * @param block_errors Error levels, as returned by fm_get_rds_block_errors().
+ * @return true Group queued.
+ * @return false Ring full, group dropped.
+ */
+bool rds_group_ring_push(rds_group_ring_t *ring, const rds_group_t *group, uint8_t block_errors);
+
+/**
+ * \brief Dequeue the oldest RDS group.
+ * 
+ * May only be called from the consumer side.
+ * 
+ * @param ring Group ring.
+ * @param entry Output entry.
+ * @return true Entry filled.
+ * @return false Ring empty.
+ */
+bool rds_group_ring_pop(rds_group_ring_t *ring, rds_group_ring_entry_t *entry);
+
+/**
+ * \brief Pass all queued groups to the parser.
+ * 
+ * May only be called from the consumer side.
+ * 
+ * @param ring Group ring.
+ * @param parser RDS parser.
+ * @return Number of groups processed.
+ */
+size_t rds_group_ring_drain(rds_group_ring_t *ring, rds_parser_t *parser);
+
+/**
+ * \brief Get the number of groups dropped because the ring was full.
+ * 
+ * @param ring Group ring.
+ */
+static inline uint32_t rds_group_ring_get_dropped_count(const rds_group_ring_t *ring) {
+    return ring->dropped_count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RDS_GROUP_RING_H_
@@ -28,10 +28,137 @@ extern "C" {
 #define RDS_PARSER_RADIO_TEXT_ENABLE 1
 #endif
 
+#ifndef RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
+#define RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE 1 // publish only complete Radio Text, 68 bytes
+#endif
+
 #ifndef RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
 #define RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE 1
 #endif
 
+#ifndef RDS_PARSER_PROGRAM_ITEM_ENABLE
+#define RDS_PARSER_PROGRAM_ITEM_ENABLE 1 // group 1A: PIN and extended country code
+#endif
+
+#ifndef RDS_PARSER_CLOCK_TIME_ENABLE
+#define RDS_PARSER_CLOCK_TIME_ENABLE 1 // group 4A
+#endif
+
+#ifndef RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+#define RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE 1 // group 10A
+#endif
+
+#ifndef RDS_PARSER_EON_ENABLE
+#define RDS_PARSER_EON_ENABLE 0 // groups 14A / 14B, off by default for RAM
+#endif
+
+#ifndef RDS_PARSER_EON_MAX_NETWORKS
+#define RDS_PARSER_EON_MAX_NETWORKS 4 // other networks tracked with EON
+#endif
+
+/**
+ * \brief Confidence required before a PS / RT character is published.
+ * 
+ * An error-free block adds 3, and blocks with 1-2 / 3-5 corrected errors add 2 / 1.
+ * Conflicting characters subtract their weight.
+ */
+#ifndef RDS_PARSER_MIN_CONFIDENCE
+#define RDS_PARSER_MIN_CONFIDENCE 3
+#endif
+
+#ifndef RDS_PARSER_MAX_CONFIDENCE
+#define RDS_PARSER_MAX_CONFIDENCE 9
+#endif
+
+/**
+ * \brief Error level of an RDS block.
+ */
+typedef enum rds_block_error_t
+{
+    RDS_BLOCK_ERROR_NONE, // no errors
+    RDS_BLOCK_ERROR_LOW, // 1-2 corrected errors
+    RDS_BLOCK_ERROR_HIGH, // 3-5 corrected errors
+    RDS_BLOCK_ERROR_UNCORRECTABLE, // block is unusable
+} rds_block_error_t;
+
+/**
+ * \brief Get the error level of a block from packed block errors.
+ * 
+ * Block errors hold a 2-bit rds_block_error_t per block: A in bits 0-1, B in bits 2-3,
+ * C in bits 4-5, D in bits 6-7.
+ * 
+ * @param block_errors Packed block errors.
+ * @param block_index Block index, 0 for A ... 3 for D.
+ */
+static inline rds_block_error_t rds_get_block_error(uint8_t block_errors, size_t block_index) {
+    assert(block_index < 4);
+
+    return (rds_block_error_t)((block_errors >> (2 * block_index)) & 0x3);
+}
+
+/**
+ * \brief Change flags, see rds_parser_take_changes().
+ */
+typedef enum rds_change_t
+{
+    RDS_CHANGE_PI = 1 << 0,
+    RDS_CHANGE_PTY = 1 << 1,
+    RDS_CHANGE_TP = 1 << 2,
+    RDS_CHANGE_TA = 1 << 3,
+    RDS_CHANGE_MS = 1 << 4,
+    RDS_CHANGE_DI = 1 << 5,
+    RDS_CHANGE_PS = 1 << 6, // new PS name published
+    RDS_CHANGE_RT = 1 << 7, // new Radio Text published
+    RDS_CHANGE_RT_A_B = 1 << 8, // A/B flag toggled, a new Radio Text is starting
+    RDS_CHANGE_ALT_FREQ = 1 << 9, // alternative frequency added or list replaced
+    RDS_CHANGE_PROGRAM_ITEM = 1 << 10, // PIN or ECC
+    RDS_CHANGE_CLOCK_TIME = 1 << 11,
+    RDS_CHANGE_PROGRAM_TYPE_NAME = 1 << 12,
+    RDS_CHANGE_EON = 1 << 13,
+    RDS_CHANGE_ALL = (1 << 14) - 1,
+} rds_change_t;
+
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+/**
+ * \brief How the alternative frequency list is transmitted.
+ */
+typedef enum rds_alt_freq_method_t
+{
+    RDS_ALT_FREQ_METHOD_UNKNOWN,
+    RDS_ALT_FREQ_METHOD_A, // one list for the whole network
+    RDS_ALT_FREQ_METHOD_B, // one list per transmitter, pairs with its tuning frequency
+} rds_alt_freq_method_t;
+#endif
+
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+/**
+ * \brief Clock time and date from group 4A.
+ */
+typedef struct rds_clock_time_t
+{
+    uint32_t mjd; // Modified Julian Day, UTC
+    uint8_t hour; // UTC
+    uint8_t minute; // UTC
+    int8_t offset; // local time offset in multiples of 30 minutes
+} rds_clock_time_t;
+#endif
+
+#if RDS_PARSER_EON_ENABLE
+/**
+ * \brief Other network received through Enhanced Other Networks.
+ */
+typedef struct rds_eon_network_t
+{
+    uint16_t pi;
+    char ps_str[9];
+    uint8_t pty;
+    bool tp;
+    bool ta;
+    uint8_t alt_freq[4]; // first AF codes, same format as rds_get_alternative_frequency()
+    uint8_t alt_freq_count;
+} rds_eon_network_t;
+#endif
+
 /**
  * \brief RDS block group.
  */
@@ -57,22 +184,59 @@ typedef struct rds_parser_t
     uint8_t di_scratch; // back-buffer for decoder identification
     char ps_str[9]; // program service name
     char ps_scratch_str[9]; // back-buffer for program service name
+    uint8_t ps_confidence[8]; // per-character confidence for back-buffer
+    uint8_t ps_segments; // segments received in agreement with back-buffer, bit i for characters 2i..2i+1
 #if RDS_PARSER_RADIO_TEXT_ENABLE
     char rt_str[65]; // radio text
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
     char rt_scratch_str[65]; // back-buffer for radio text
+#endif
+    uint8_t rt_confidence[64]; // per-character confidence for back-buffer
+    uint16_t rt_segments; // segments received for back-buffer, since the A/B flag toggled
+    uint16_t rt_expected_segments; // segments up to the end of text, all until it's received
+    uint8_t rt_length; // characters to receive, including the end of text
     bool rt_a_b; // alternating radio text flag
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
     bool rt_scratch_a_b; // back-bufer for alternating radio text flag
 #endif
+#endif
 #if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
     uint8_t alt_freq[25];
     uint8_t alt_freq_count;
+    uint8_t alt_freq_expected; // list size from header, 0 if unknown
+    uint8_t alt_freq_head; // frequency following the list header
+    uint8_t alt_freq_tuned; // tuned frequency code, 0 if unknown
+    uint8_t alt_freq_method; // rds_alt_freq_method_t
+    bool alt_freq_active; // whether pairs belong to the tracked list
+    bool alt_freq_skip_next; // next code is an LF/MF frequency
+#endif
+#if RDS_PARSER_PROGRAM_ITEM_ENABLE
+    uint16_t pin; // program item number, 0 if unknown
+    uint8_t ecc; // extended country code, 0 if unknown
+#endif
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+    rds_clock_time_t clock_time;
+    bool has_clock_time;
+#endif
+#if RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+    char ptyn_str[9]; // program type name
+    char ptyn_scratch_str[9]; // back-buffer for program type name
+    uint8_t ptyn_confidence[8]; // per-character confidence for back-buffer
+    bool ptyn_scratch_a_b; // back-buffer is cleared when the A/B flag toggles
 #endif
+#if RDS_PARSER_EON_ENABLE
+    rds_eon_network_t eon[RDS_PARSER_EON_MAX_NETWORKS];
+    uint8_t eon_count;
+    uint8_t eon_next; // replaced when the table is full
+#endif
+    uint16_t changes; // rds_change_t flags since last taken
 } rds_parser_t;
 
 /**
  * \brief Clear buffered data.
  * 
- * Should be called after changing FM frequency.
+ * Should be called after changing FM frequency. All change flags are raised, so consumers
+ * redraw the cleared fields.
  * 
  * @param parser RDS parser.
  */
@@ -81,11 +245,56 @@ void rds_parser_reset(rds_parser_t *parser);
 /**
  * \brief Process an RDS group.
  * 
+ * All blocks are assumed to be error-free.
+ * 
  * @param parser RDS parser.
  * @param group 
  */
 void rds_parser_update(rds_parser_t *parser, const rds_group_t *group);
 
+/**
+ * \brief Process an RDS group with block error information.
+ * 
+ * Groups with an uncorrectable block B are dropped, and other uncorrectable blocks are
+ * ignored. Characters received in corrected blocks count less towards confidence, so
+ * the PS name and Radio Text are only published once every character has been received
+ * cleanly, or repeated enough times.
+ * 
+ * @param parser RDS parser.
+ * @param group RDS group.
+ * @param block_errors Packed block errors, see rds_get_block_error().
+ */
+void rds_parser_update_with_errors(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors);
+
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+/**
+ * \brief Tell the parser which frequency is tuned.
+ * 
+ * Selects the matching method B alternative frequency list. Should be called after
+ * rds_parser_reset().
+ * 
+ * @param parser RDS parser.
+ * @param frequency_khz Tuned frequency in kHz.
+ */
+void rds_parser_set_tuned_frequency_khz(rds_parser_t *parser, uint32_t frequency_khz);
+#endif
+
+/**
+ * \brief Get and clear the change flags.
+ * 
+ * Each rds_change_t flag is raised when rds_parser_update() modifies the published value,
+ * and stays raised until taken. Lets consumers process deltas instead of comparing all
+ * fields after every group.
+ * 
+ * @param parser RDS parser.
+ * @return Flags raised since the previous call.
+ */
+static inline uint16_t rds_parser_take_changes(rds_parser_t *parser) {
+    uint16_t changes = parser->changes;
+    parser->changes = 0;
+    return changes;
+}
+
 /**
  * \brief Get the PI code
  * 
@@ -168,18 +377,129 @@ static inline const char *rds_get_program_service_name_str(const rds_parser_t *p
     return parser->ps_str;
 }
 
+/**
+ * \brief Get the PS segments received.
+ *
+ * The name is sent in 4 segments of 2 characters. Refers to the name being assembled: when a
+ * segment arrives with changed characters, the name is being replaced and only that segment
+ * remains set. A segment whose characters disagree with the name being assembled is cleared
+ * until it's received in agreement again.
+ *
+ * @param parser RDS parser.
+ * @return Bitmask with bit i set once characters 2i and 2i+1 have been received, 0xF when complete.
+ */
+static inline uint8_t rds_get_program_service_name_segments(const rds_parser_t *parser) {
+    return parser->ps_segments;
+}
+
+/**
+ * \brief Get the PS name being assembled, for progressive display.
+ *
+ * Unlike rds_get_program_service_name_str(), this is updated as soon as each segment arrives,
+ * before all characters are confident. Missing characters read as spaces.
+ *
+ * @param parser RDS parser.
+ * @param str Output string with capacity for at least 9 chars.
+ * @return Received segments, see rds_get_program_service_name_segments().
+ */
+uint8_t rds_get_program_service_name_partial(const rds_parser_t *parser, char *str);
+
+/**
+ * \brief Get the confidence of a PS character being received.
+ * 
+ * Confidence grows as a character is received repeatedly, faster for error-free blocks.
+ * It refers to the name being assembled, which may be ahead of rds_get_program_service_name_str().
+ * 
+ * @param parser RDS parser.
+ * @param index Character index, up to 7.
+ * @return Confidence, up to RDS_PARSER_MAX_CONFIDENCE.
+ */
+static inline uint8_t rds_get_program_service_name_confidence(const rds_parser_t *parser, size_t index) {
+    assert(index < 8);
+
+    return parser->ps_confidence[index];
+}
+
 #if RDS_PARSER_RADIO_TEXT_ENABLE
 /**
  * \brief Get the Radio Text string.
  * 
  * See RDS code table G0 for character encoding outside of ASCII range.
  * 
+ * The text is published as soon as every segment up to the end of text has been received
+ * confidently, in any order. Without RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE characters
+ * are published as they arrive, so the text may be incomplete, see rds_is_radio_text_complete().
+ * It's cleared when the A/B flag toggles.
+ * 
  * @param parser 
  */
 static inline const char *rds_get_radio_text_str(const rds_parser_t *parser) {
     return parser->rt_str;
 }
 
+/**
+ * \brief Get the confidence of a Radio Text character being received.
+ * 
+ * See rds_get_program_service_name_confidence().
+ * 
+ * @param parser RDS parser.
+ * @param index Character index, up to 63.
+ * @return Confidence, up to RDS_PARSER_MAX_CONFIDENCE.
+ */
+static inline uint8_t rds_get_radio_text_confidence(const rds_parser_t *parser, size_t index) {
+    assert(index < 64);
+
+    return parser->rt_confidence[index];
+}
+
+/**
+ * \brief Get the Radio Text segments received.
+ *
+ * The text is sent in up to 16 segments, of 4 characters in group 2A or 2 characters in
+ * group 2B. Refers to the text being assembled, and is cleared when the A/B flag toggles.
+ *
+ * @param parser RDS parser.
+ * @return Bitmask with bit i set once segment i has been received.
+ */
+static inline uint16_t rds_get_radio_text_segments(const rds_parser_t *parser) {
+    return parser->rt_segments;
+}
+
+/**
+ * \brief Get the Radio Text segments needed for a complete text.
+ *
+ * All 16 until the segment holding the end of text has been received, then the segments
+ * up to it.
+ *
+ * @param parser RDS parser.
+ */
+static inline uint16_t rds_get_radio_text_expected_segments(const rds_parser_t *parser) {
+    return parser->rt_expected_segments;
+}
+
+/**
+ * \brief Check whether every segment of the Radio Text being assembled has been received.
+ *
+ * @param parser RDS parser.
+ */
+static inline bool rds_is_radio_text_complete(const rds_parser_t *parser) {
+    uint16_t expected_segments = parser->rt_expected_segments;
+    return (parser->rt_segments & expected_segments) == expected_segments;
+}
+
+/**
+ * \brief Get the Radio Text being assembled, for progressive display.
+ *
+ * Missing characters read as spaces, and the string ends after the last character received
+ * or at the end of text. Combine with rds_get_radio_text_segments() to know which parts are
+ * still missing.
+ *
+ * @param parser RDS parser.
+ * @param str Output string with capacity for at least 65 chars.
+ * @return String length.
+ */
+size_t rds_get_radio_text_partial(const rds_parser_t *parser, char *str);
+
 /**
  * \brief Get the Radio Text A/B flag.
  * 
@@ -200,6 +520,30 @@ static inline size_t rds_get_alternative_frequency_count(const rds_parser_t *par
     return parser->alt_freq_count;
 }
 
+/**
+ * \brief Check whether the whole alternative frequency list has been received.
+ * 
+ * Only known once a list header has been received.
+ * 
+ * @param parser RDS parser.
+ */
+static inline bool rds_has_complete_alternative_frequency_list(const rds_parser_t *parser) {
+    return parser->alt_freq_expected != 0 && parser->alt_freq_expected <= parser->alt_freq_count;
+}
+
+/**
+ * \brief Get how the alternative frequency list is transmitted.
+ * 
+ * With method B the station sends a list per transmitter. The parser tracks the list of the
+ * tuned frequency if known (see rds_parser_set_tuned_frequency_khz()), otherwise the first
+ * one seen after reset. The tuning frequency itself is left out.
+ * 
+ * @param parser RDS parser.
+ */
+static inline rds_alt_freq_method_t rds_get_alternative_frequency_method(const rds_parser_t *parser) {
+    return (rds_alt_freq_method_t)parser->alt_freq_method;
+}
+
 /**
  * \brief Get an alternative frequency.
  * 
@@ -223,6 +567,103 @@ static inline float rds_decode_alternative_frequency(uint8_t alt_freq) {
 
     return 87.5f + alt_freq * 0.1f;
 }
+
+/**
+ * \brief Decode raw frequency value into kHz.
+ * 
+ * @param alt_freq Raw frequency value.
+ */
+static inline uint32_t rds_decode_alternative_frequency_khz(uint8_t alt_freq) {
+    assert(0 < alt_freq && alt_freq < 205);
+
+    return 87500 + alt_freq * 100;
+}
+#endif
+
+#if RDS_PARSER_PROGRAM_ITEM_ENABLE
+/**
+ * \brief Get the Program Item Number.
+ * 
+ * Raw value: day of month in bits 11-15, hour in bits 6-10, minute in bits 0-5.
+ * 
+ * @param parser RDS parser.
+ * @return PIN, or 0 if not received.
+ */
+static inline uint16_t rds_get_program_item_number(const rds_parser_t *parser) {
+    return parser->pin;
+}
+
+/**
+ * \brief Get the Extended Country Code.
+ * 
+ * Together with the first PI nibble it identifies the country.
+ * 
+ * @param parser RDS parser.
+ * @return ECC, or 0 if not received.
+ */
+static inline uint8_t rds_get_extended_country_code(const rds_parser_t *parser) {
+    return parser->ecc;
+}
+#endif
+
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+/**
+ * \brief Get the last clock time received.
+ * 
+ * Broadcast once per minute, at the start of the minute.
+ * 
+ * @param parser RDS parser.
+ * @return Clock time, or NULL if not received.
+ */
+static inline const rds_clock_time_t *rds_get_clock_time(const rds_parser_t *parser) {
+    return parser->has_clock_time ? &parser->clock_time : NULL;
+}
+
+/**
+ * \brief Convert a Modified Julian Day into a calendar date.
+ * 
+ * @param mjd Modified Julian Day.
+ * @param year Output year.
+ * @param month Output month, 1-12.
+ * @param day Output day of month, 1-31.
+ */
+void rds_decode_date(uint32_t mjd, uint16_t *year, uint8_t *month, uint8_t *day);
+#endif
+
+#if RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+/**
+ * \brief Get the Program Type Name string.
+ * 
+ * Optional refinement of the PTY code (e.g. "Football" for Sport).
+ * 
+ * @param parser RDS parser.
+ */
+static inline const char *rds_get_program_type_name_str(const rds_parser_t *parser) {
+    return parser->ptyn_str;
+}
+#endif
+
+#if RDS_PARSER_EON_ENABLE
+/**
+ * \brief Get the number of other networks received through EON.
+ * 
+ * @param parser RDS parser.
+ */
+static inline size_t rds_get_eon_network_count(const rds_parser_t *parser) {
+    return parser->eon_count;
+}
+
+/**
+ * \brief Get an other network received through EON.
+ * 
+ * @param parser RDS parser.
+ * @param index Network index.
+ */
+static inline const rds_eon_network_t *rds_get_eon_network(const rds_parser_t *parser, size_t index) {
+    assert(index < parser->eon_count);
+
+    return &parser->eon[index];
+}
 #endif
 
 #ifdef __cplusplus
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDS_POLL_CONTROLLER_H_
+#define _RDS_POLL_CONTROLLER_H_
+
+#include <rds_parser.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rds_poll_controller.h
+ *
+ * \brief Adaptive RDS polling rate.
+ *
+ * Picks how often to read RDS from the tuner, based on RDS sync and on how recently the
+ * decoded data changed. Polling is fast right after tuning and after a Radio Text A/B toggle,
+ * normal while data is still arriving, and slows down once PI, PS and RT have been stable
+ * for a while, or if the station carries no RDS at all.
+ *
+ * The controller only does the bookkeeping, it's up to the caller to poll at the returned
+ * interval (see fm_executor_set_rds_poll_controller()).
+ */
+
+/**
+ * \brief Polling intervals and thresholds.
+ */
+typedef struct rds_poll_config_t
+{
+    uint16_t fast_interval_ms; // after tune and A/B toggle
+    uint16_t normal_interval_ms; // while data is changing
+    uint16_t stable_interval_ms; // once data is stable
+    uint16_t no_sync_interval_ms; // without RDS sync
+    uint16_t fast_duration_ms; // how long to poll fast
+    uint16_t stable_after_ms; // unchanged for this long counts as stable
+} rds_poll_config_t;
+
+static inline rds_poll_config_t rds_poll_config_default() {
+    // groups arrive every 87.6ms, so fast and normal rates don't drop any
+    return (rds_poll_config_t){20, 40, 500, 1000, 3000, 10000};
+}
+
+/**
+ * \brief RDS poll controller.
+ */
+typedef struct rds_poll_controller_t
+{
+    rds_poll_config_t config;
+    uint64_t fast_until_time; // µs since boot
+    uint64_t last_change_time; // µs since boot
+    uint32_t checksum; // of decoded data
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    bool rt_a_b;
+#endif
+} rds_poll_controller_t;
+
+/**
+ * \brief Initialize the controller.
+ *
+ * @param controller Poll controller.
+ * @param config Polling intervals and thresholds.
+ */
+void rds_poll_controller_init(rds_poll_controller_t *controller, rds_poll_config_t config);
+
+/**
+ * \brief Restart fast polling, should be called after tuning.
+ *
+ * @param controller Poll controller.
+ * @param now Current time in µs since boot.
+ */
+void rds_poll_controller_reset(rds_poll_controller_t *controller, uint64_t now);
+
+/**
+ * \brief Update the controller after a poll.
+ *
+ * @param controller Poll controller.
+ * @param parser RDS parser fed with the polled groups.
+ * @param rds_sync Whether the tuner is synchronized to an RDS stream.
+ * @param now Current time in µs since boot.
+ * @return Interval until the next poll in ms.
+ */
+uint16_t rds_poll_controller_update(rds_poll_controller_t *controller, const rds_parser_t *parser, bool rds_sync, uint64_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RDS_POLL_CONTROLLER_H_
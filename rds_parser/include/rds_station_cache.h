@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _RDS_STATION_CACHE_H_
+#define _RDS_STATION_CACHE_H_
+
+#include <rds_parser.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file rds_station_cache.h
+ *
+ * \brief Decoded RDS data of recently tuned stations.
+ *
+ * Decoding the PS name takes a few seconds after every retune. The cache remembers PS,
+ * Radio Text and the AF list of the stations left behind, keyed by frequency. When the
+ * station is tuned again, the cached data is restored into the parser as soon as the
+ * first group confirms the PI code, and is then replaced by fresh data as it's decoded.
+ *
+ * Least recently used stations are evicted when the cache is full.
+ */
+
+#ifndef RDS_STATION_CACHE_SIZE
+#define RDS_STATION_CACHE_SIZE 8
+#endif
+
+/**
+ * \brief Cached station.
+ */
+typedef struct rds_station_t
+{
+    uint32_t frequency_khz; // 0 if unused
+    uint32_t last_used;
+    uint16_t pi;
+    uint8_t pty;
+    char ps_str[9];
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    char rt_str[65];
+    bool rt_a_b;
+#endif
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    uint8_t alt_freq[25];
+    uint8_t alt_freq_count;
+    uint8_t alt_freq_expected;
+    uint8_t alt_freq_head;
+    uint8_t alt_freq_method;
+#endif
+} rds_station_t;
+
+/**
+ * \brief RDS station cache.
+ */
+typedef struct rds_station_cache_t
+{
+    rds_station_t stations[RDS_STATION_CACHE_SIZE];
+    uint32_t use_count; // LRU clock
+    uint32_t frequency_khz; // tuned frequency, 0 if unknown
+    bool restore_pending; // waiting for the first PI code
+} rds_station_cache_t;
+
+/**
+ * \brief Initialize the cache.
+ *
+ * @param cache Station cache.
+ */
+void rds_station_cache_init(rds_station_cache_t *cache);
+
+/**
+ * \brief Cache the current station.
+ *
+ * Done by rds_station_cache_retune(), only needed to keep the station before persisting
+ * the cache. Stations without a PS name are ignored. Storing a station again with the same
+ * data leaves the cache unchanged, including the LRU clock, so persisting it again can be
+ * skipped.
+ *
+ * @param cache Station cache.
+ * @param parser RDS parser.
+ */
+void rds_station_cache_store(rds_station_cache_t *cache, const rds_parser_t *parser);
+
+/**
+ * \brief Save the current station and reset the parser for a new frequency.
+ *
+ * Replaces rds_parser_reset() after tuning. The station being left is cached if it had
+ * a PS name.
+ *
+ * @param cache Station cache.
+ * @param parser RDS parser.
+ * @param frequency_khz New frequency in kHz.
+ */
+void rds_station_cache_retune(rds_station_cache_t *cache, rds_parser_t *parser, uint32_t frequency_khz);
+
+/**
+ * \brief Restore cached data once the PI code is known.
+ *
+ * Should be called after each rds_parser_update(). Restored fields raise the usual
+ * rds_change_t flags.
+ *
+ * @param cache Station cache.
+ * @param parser RDS parser.
+ * @return Whether cached data was restored by this call.
+ */
+bool rds_station_cache_update(rds_station_cache_t *cache, rds_parser_t *parser);
+
+/**
+ * \brief Look up a cached station, e.g. to label presets.
+ *
+ * Doesn't count as a use.
+ *
+ * @param cache Station cache.
+ * @param frequency_khz Frequency in kHz.
+ * @return Cached station or NULL.
+ */
+const rds_station_t *rds_station_cache_find(const rds_station_cache_t *cache, uint32_t frequency_khz);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _RDS_STATION_CACHE_H_
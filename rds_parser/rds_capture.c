@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <rds_capture.h>
+#include <string.h>
+
+static const uint8_t RDS_CAPTURE_MAGIC[4] = {'R', 'D', 'S', 'C'};
+
+static size_t rds_capture_put_u16(uint8_t *dst, uint16_t value) {
+    dst[0] = value >> 8;
+    dst[1] = value & 0xFF;
+    return 2;
+}
+
+static size_t rds_capture_put_varint(uint8_t *dst, uint32_t value) {
+    size_t size = 0;
+    while (0x80 <= value) {
+        dst[size++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    dst[size++] = value;
+    return size;
+}
+
+static uint16_t rds_capture_get_u16(const uint8_t *src) {
+    return (src[0] << 8) | src[1];
+}
+
+//
+// writer
+//
+
+void rds_capture_writer_init(rds_capture_writer_t *writer, rds_capture_write_t write, void *user_data) {
+    memset(writer, 0, sizeof(rds_capture_writer_t));
+    writer->write = write;
+    writer->user_data = user_data;
+}
+
+void rds_capture_writer_begin(rds_capture_writer_t *writer, uint32_t frequency_khz, uint64_t now) {
+    rds_capture_writer_end(writer);
+
+    uint8_t header[RDS_CAPTURE_HEADER_SIZE];
+    memcpy(header, RDS_CAPTURE_MAGIC, sizeof(RDS_CAPTURE_MAGIC));
+    header[4] = RDS_CAPTURE_VERSION;
+    rds_capture_put_u16(&header[5], frequency_khz >> 16);
+    rds_capture_put_u16(&header[7], frequency_khz & 0xFFFF);
+    writer->write(header, sizeof(header), writer->user_data);
+    writer->last_time = now;
+    writer->active = true;
+}
+
+void rds_capture_writer_add(rds_capture_writer_t *writer, const uint16_t *blocks, uint8_t block_errors, uint64_t now) {
+    if (!writer->active || block_errors == RDS_CAPTURE_END) {
+        return; // nothing decodable, and would read as the end marker
+    }
+    uint64_t delta_us = now - writer->last_time;
+    writer->last_time = now;
+
+    uint8_t record[RDS_CAPTURE_MAX_RECORD_SIZE];
+    size_t size = 0;
+    record[size++] = block_errors;
+    size += rds_capture_put_varint(&record[size], delta_us < UINT32_MAX ? delta_us : UINT32_MAX);
+    for (size_t i = 0; i < 4; i++) {
+        size += rds_capture_put_u16(&record[size], blocks[i]);
+    }
+    writer->write(record, size, writer->user_data);
+}
+
+void rds_capture_writer_end(rds_capture_writer_t *writer) {
+    if (!writer->active) {
+        return;
+    }
+    uint8_t end = RDS_CAPTURE_END;
+    writer->write(&end, 1, writer->user_data);
+    writer->active = false;
+}
+
+//
+// reader
+//
+
+bool rds_capture_reader_init(rds_capture_reader_t *reader, const uint8_t *data, size_t size) {
+    memset(reader, 0, sizeof(rds_capture_reader_t));
+    for (size_t i = 0; i + RDS_CAPTURE_HEADER_SIZE <= size; i++) {
+        const uint8_t *header = &data[i];
+        if (memcmp(header, RDS_CAPTURE_MAGIC, sizeof(RDS_CAPTURE_MAGIC)) != 0 || header[4] != RDS_CAPTURE_VERSION) {
+            continue;
+        }
+        reader->data = &data[i + RDS_CAPTURE_HEADER_SIZE];
+        reader->size = size - i - RDS_CAPTURE_HEADER_SIZE;
+        reader->frequency_khz = ((uint32_t)rds_capture_get_u16(&header[5]) << 16) | rds_capture_get_u16(&header[7]);
+        return true;
+    }
+    return false;
+}
+
+bool rds_capture_reader_next(rds_capture_reader_t *reader, rds_capture_record_t *record) {
+    const uint8_t *data = reader->data;
+    size_t size = reader->size;
+    size_t offset = reader->offset;
+    if (reader->ended || size <= offset) {
+        return false;
+    }
+    uint8_t block_errors = data[offset++];
+    if (block_errors == RDS_CAPTURE_END) {
+        reader->offset = offset;
+        reader->ended = true;
+        return false;
+    }
+    uint32_t delta_us = 0;
+    for (uint8_t shift = 0;; shift += 7) {
+        if (size <= offset || 32 <= shift) {
+            return false; // truncated or corrupt
+        }
+        uint8_t byte = data[offset++];
+        delta_us |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    if (size < offset + 8) {
+        return false; // truncated
+    }
+    record->delta_us = delta_us;
+    record->group.a = rds_capture_get_u16(&data[offset]);
+    record->group.b = rds_capture_get_u16(&data[offset + 2]);
+    record->group.c = rds_capture_get_u16(&data[offset + 4]);
+    record->group.d = rds_capture_get_u16(&data[offset + 6]);
+    record->block_errors = block_errors;
+    reader->offset = offset + 8;
+    return true;
+}
+
+void rds_capture_reader_rewind(rds_capture_reader_t *reader) {
+    reader->offset = 0;
+    reader->ended = false;
+}
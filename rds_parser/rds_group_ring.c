@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <rds_group_ring.h>
+#include <hardware/sync.h>
+#include <string.h>
+
+#define RDS_GROUP_RING_MASK (RDS_GROUP_RING_CAPACITY - 1)
+
+//
+// public interface
+//
+
+void rds_group_ring_init(rds_group_ring_t *ring) {
+    memset(ring, 0, sizeof(rds_group_ring_t));
+}
+
+bool rds_group_ring_push(rds_group_ring_t *ring, const rds_group_t *group, uint8_t block_errors) {
+    uint32_t head = ring->head;
+    if (head - ring->tail == RDS_GROUP_RING_CAPACITY) {
+        ring->dropped_count++;
+        return false; // full
+    }
+    rds_group_ring_entry_t *entry = &ring->entries[head & RDS_GROUP_RING_MASK];
+    entry->group = *group;
+    entry->block_errors = block_errors;
+    __dmb(); // publish entry before head
+    ring->head = head + 1;
+    return true;
+}
+
+bool rds_group_ring_pop(rds_group_ring_t *ring, rds_group_ring_entry_t *entry) {
+    uint32_t tail = ring->tail;
+    if (ring->head == tail) {
+        return false; // empty
+    }
+    __dmb(); // read head before entry
+    *entry = ring->entries[tail & RDS_GROUP_RING_MASK];
+    __dmb(); // finish reading entry before releasing the slot
+    ring->tail = tail + 1;
+    return true;
+}
+
+size_t rds_group_ring_drain(rds_group_ring_t *ring, rds_parser_t *parser) {
+    size_t count = 0;
+    rds_group_ring_entry_t entry;
+    while (rds_group_ring_pop(ring, &entry)) {
+        rds_parser_update_with_errors(parser, &entry.group, entry.block_errors);
+        count++;
+    }
+    return count;
+}
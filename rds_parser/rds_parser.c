@@ -17,22 +17,64 @@ static char hex_to_char(uint8_t value) {
     return (value < 10 ? ('0' + value) : ('A' - 10 + value));
 }
 
+#define rds_set_field(parser, field, value, change) do { \
+    if ((parser)->field != (value)) { \
+        (parser)->field = (value); \
+        (parser)->changes |= (change); \
+    } \
+} while (0)
+
+//
+// block errors
+//
+
+static rds_block_error_t rds_max_block_error(uint8_t block_errors, size_t block_index0, size_t block_index1) {
+    rds_block_error_t error0 = rds_get_block_error(block_errors, block_index0);
+    rds_block_error_t error1 = rds_get_block_error(block_errors, block_index1);
+    return (error0 < error1) ? error1 : error0;
+}
+
+static uint8_t rds_get_block_weight(rds_block_error_t error) {
+    // confidence gained by receiving a character once
+    static const uint8_t WEIGHTS[] = {3, 2, 1, 0};
+    return WEIGHTS[error];
+}
+
+static void rds_update_char(char *scratch_ch, uint8_t *confidence, char ch, uint8_t weight) {
+    if (*scratch_ch == ch) {
+        unsigned new_confidence = *confidence + weight;
+        *confidence = (new_confidence < RDS_PARSER_MAX_CONFIDENCE) ? new_confidence : RDS_PARSER_MAX_CONFIDENCE;
+    } else if (*confidence <= weight) {
+        // replace weak character
+        *scratch_ch = ch;
+        *confidence = weight;
+    } else {
+        *confidence -= weight;
+    }
+}
+
+static bool rds_is_confident(const uint8_t *confidence, size_t char_count) {
+    for (size_t i = 0; i < char_count; i++) {
+        if (confidence[i] < RDS_PARSER_MIN_CONFIDENCE) {
+            return false;
+        }
+    }
+    return true;
+}
+
 //
 // rds_group
 //
 
-typedef enum
-{
-    RDS_GROUP_BASIC = 0x00,
-    RDS_GROUP_RT = 0x02,
-} rds_group_type_t;
+#define RDS_GROUP_INDEX(type, version) (((type) << 1) | (version)) // e.g. 2A is (2, 0)
 
 static uint16_t rds_get_group_pi(const rds_group_t *group) {
     return group->a;
 }
 
-static rds_group_type_t rds_get_group_type(const rds_group_t *group) {
-    return group->b >> 12;
+static size_t rds_get_group_index(const rds_group_t *group) {
+    // group type and version
+    return group->b >> 11;
 }
 
 static uint8_t rds_get_group_version(const rds_group_t *group) {
@@ -51,18 +93,41 @@ static uint8_t rds_get_group_pty(const rds_group_t *group) {
 // rds_parser_t
 //
 
-static void rds_parse_group_basic_ps(rds_parser_t *parser, const rds_group_t *group) {
+static void rds_parse_group_basic_ps(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
     // group 0A / 0B
+    rds_block_error_t error = rds_max_block_error(block_errors, 1, 3);
+    if (error == RDS_BLOCK_ERROR_UNCORRECTABLE) {
+        return;
+    }
+    uint8_t weight = rds_get_block_weight(error);
     size_t address = group->b & 0x3;
     size_t char_index = 2 * address;
     char ch0 = group->d >> 8;
     char ch1 = group->d & 0xFF;
-    parser->ps_scratch_str[char_index] = ch0;
-    parser->ps_scratch_str[char_index + 1] = ch1;
+    char *scratch = &parser->ps_scratch_str[char_index];
+    uint8_t *confidence = &parser->ps_confidence[char_index];
+    bool was_received = (confidence[0] != 0 && confidence[1] != 0);
+    char old_ch0 = scratch[0];
+    char old_ch1 = scratch[1];
+    rds_update_char(&scratch[0], &confidence[0], ch0, weight);
+    rds_update_char(&scratch[1], &confidence[1], ch1, weight);
 
-    bool finished = (address == 3);
-    if (finished) {
+    // A segment counts while it agrees with the back-buffer. When a received segment changes
+    // after a complete set, the name is being replaced (dynamic PS) and the set is stale.
+    uint8_t segment = 1 << address;
+    if (was_received && (scratch[0] != old_ch0 || scratch[1] != old_ch1)) {
+        parser->ps_segments = (parser->ps_segments == 0xF) ? segment : parser->ps_segments | segment;
+    } else if (scratch[0] == ch0 && scratch[1] == ch1) {
+        parser->ps_segments |= segment;
+    } else {
+        parser->ps_segments &= ~segment; // outvoted by the back-buffer for now
+    }
+
+    // publish once all segments of the same name are in, whichever arrived last
+    bool finished = (parser->ps_segments == 0xF) && rds_is_confident(parser->ps_confidence, 8);
+    if (finished && memcmp(parser->ps_str, parser->ps_scratch_str, 8) != 0) {
         memcpy(parser->ps_str, parser->ps_scratch_str, 8);
+        parser->changes |= RDS_CHANGE_PS;
     }
 }
 
@@ -75,14 +140,19 @@ static void rds_parse_group_basic_di(rds_parser_t *parser, const rds_group_t *gr
 
     bool finished = (di_bit_index == 0);
     if (finished) {
-        parser->di = parser->di_scratch;
+        rds_set_field(parser, di, parser->di_scratch, RDS_CHANGE_DI);
     }
 }
 
 #if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+#define RDS_ALT_FREQ_FILLER 205
+#define RDS_ALT_FREQ_COUNT_MIN 225 // list header with 1 frequency
+#define RDS_ALT_FREQ_COUNT_MAX 249 // list header with 25 frequencies
+#define RDS_ALT_FREQ_LF_MF 250 // next code is an LF/MF frequency
+
 static void rds_add_alt_freq(rds_parser_t *parser, uint8_t alt_freq) {
-    if (alt_freq == 0 || 205 <= alt_freq) {
-        return; // out of range, ignored
+    if (alt_freq == 0 || RDS_ALT_FREQ_FILLER <= alt_freq) {
+        return; // filler or out of range, ignored
     }
     if (parser->alt_freq_count == sizeof(parser->alt_freq)) {
         return; // list full, ignored
@@ -93,99 +163,487 @@ static void rds_add_alt_freq(rds_parser_t *parser, uint8_t alt_freq) {
         }
     }
     parser->alt_freq[parser->alt_freq_count++] = alt_freq;
+    parser->changes |= RDS_CHANGE_ALT_FREQ;
+}
+
+static void rds_remove_alt_freq(rds_parser_t *parser, uint8_t alt_freq) {
+    for (size_t i = 0; i < parser->alt_freq_count; i++) {
+        if (parser->alt_freq[i] == alt_freq) {
+            parser->alt_freq_count--;
+            memmove(parser->alt_freq + i, parser->alt_freq + i + 1, parser->alt_freq_count - i);
+            parser->changes |= RDS_CHANGE_ALT_FREQ;
+            return;
+        }
+    }
+}
+
+static void rds_parse_alt_freq_header(rds_parser_t *parser, uint8_t count, uint8_t head) {
+    // header code is followed by the first frequency (method A) or the tuning frequency (method B)
+    if (head == parser->alt_freq_head) {
+        parser->alt_freq_active = true;
+        return; // list repeated
+    }
+    bool tuned = (parser->alt_freq_tuned != 0 && head == parser->alt_freq_tuned);
+    if (parser->alt_freq_head != 0 && parser->alt_freq_method == RDS_ALT_FREQ_METHOD_B && !tuned) {
+        parser->alt_freq_active = false;
+        return; // list for another transmitter
+    }
+    // new list
+    if (parser->alt_freq_count != 0) {
+        parser->alt_freq_count = 0;
+        parser->changes |= RDS_CHANGE_ALT_FREQ;
+    }
+    parser->alt_freq_expected = count;
+    parser->alt_freq_head = head;
+    parser->alt_freq_method = RDS_ALT_FREQ_METHOD_UNKNOWN;
+    parser->alt_freq_active = true;
+    rds_add_alt_freq(parser, head);
+}
+
+static void rds_parse_alt_freq_pair(rds_parser_t *parser, uint8_t f0, uint8_t f1) {
+    if (parser->alt_freq_head == 0) {
+        // no header seen yet, assume method A
+        rds_add_alt_freq(parser, f0);
+        rds_add_alt_freq(parser, f1);
+        return;
+    }
+    if (!parser->alt_freq_active) {
+        return;
+    }
+    uint8_t head = parser->alt_freq_head;
+    if (parser->alt_freq_method == RDS_ALT_FREQ_METHOD_UNKNOWN) {
+        // method B pairs all include the tuning frequency, which isn't an alternative
+        bool method_b = (f0 == head || f1 == head);
+        parser->alt_freq_method = method_b ? RDS_ALT_FREQ_METHOD_B : RDS_ALT_FREQ_METHOD_A;
+        if (method_b) {
+            rds_remove_alt_freq(parser, head);
+            parser->alt_freq_expected = (parser->alt_freq_expected - 1) / 2;
+        }
+    }
+    if (parser->alt_freq_method == RDS_ALT_FREQ_METHOD_B) {
+        // ascending pairs are the same program, descending ones regional variants
+        if (f0 == head) {
+            rds_add_alt_freq(parser, f1);
+        } else if (f1 == head) {
+            rds_add_alt_freq(parser, f0);
+        }
+    } else {
+        rds_add_alt_freq(parser, f0);
+        rds_add_alt_freq(parser, f1);
+    }
 }
 
-static void rds_parse_group_basic_alt_freq(rds_parser_t *parser, const rds_group_t *group) {
+static void rds_parse_group_basic_alt_freq(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
     uint8_t version = rds_get_group_version(group);
     if (version != 0) {
         return;
     }
+    if (RDS_BLOCK_ERROR_LOW < rds_get_block_error(block_errors, 2)) {
+        return; // corrupted frequencies would pollute the list
+    }
     // group 0A
     uint8_t f0 = group->c >> 8;
     uint8_t f1 = group->c & 0xFF;
-    rds_add_alt_freq(parser, f0);
-    rds_add_alt_freq(parser, f1);
+    if (parser->alt_freq_skip_next) {
+        parser->alt_freq_skip_next = false;
+        f0 = RDS_ALT_FREQ_FILLER;
+    }
+    if (f0 == RDS_ALT_FREQ_LF_MF) {
+        return; // LF/MF frequency in f1, not supported
+    }
+    if (f1 == RDS_ALT_FREQ_LF_MF) {
+        parser->alt_freq_skip_next = true;
+        f1 = RDS_ALT_FREQ_FILLER;
+    }
+    if (RDS_ALT_FREQ_COUNT_MIN <= f0 && f0 <= RDS_ALT_FREQ_COUNT_MAX) {
+        rds_parse_alt_freq_header(parser, f0 - 224, f1);
+    } else {
+        rds_parse_alt_freq_pair(parser, f0, f1);
+    }
 }
 #endif // RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
 
-static void rds_parse_group_basic(rds_parser_t *parser, const rds_group_t *group) {
-    rds_parse_group_basic_ps(parser, group);
+static void rds_parse_group_basic(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    rds_set_field(parser, ta, ((group->b >> 4) & 0x1) != 0, RDS_CHANGE_TA);
+    rds_set_field(parser, ms, ((group->b >> 3) & 0x1) != 0, RDS_CHANGE_MS);
+    rds_parse_group_basic_ps(parser, group, block_errors);
     rds_parse_group_basic_di(parser, group);
 #if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
-    rds_parse_group_basic_alt_freq(parser, group);
+    rds_parse_group_basic_alt_freq(parser, group, block_errors);
 #endif
 }
 
 #if RDS_PARSER_RADIO_TEXT_ENABLE
-static void rds_parse_group_rt(rds_parser_t *parser, const rds_group_t *group) {
+static void rds_clear_rt_segments(rds_parser_t *parser) {
+    // new text is starting, end of text unknown
+    parser->rt_segments = 0;
+    parser->rt_expected_segments = 0xFFFF;
+    parser->rt_length = 0;
+}
+
+static void rds_update_rt_segments(rds_parser_t *parser, size_t address, size_t char_count, size_t end_index) {
+    // end_index is the position of the end of text in this segment, or char_count if none
+    parser->rt_segments |= 1 << address;
+    if (end_index < char_count) {
+        parser->rt_expected_segments = (2 << address) - 1;
+        parser->rt_length = address * char_count + end_index + 1;
+    } else if (!(parser->rt_expected_segments & (1 << address))) {
+        // past the previous end, the text got longer
+        parser->rt_expected_segments = 0xFFFF;
+    }
+    if (parser->rt_expected_segments == 0xFFFF) {
+        parser->rt_length = 16 * char_count;
+    }
+}
+
+static void rds_parse_group_rt(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
     uint8_t version = rds_get_group_version(group);
     size_t address = group->b & 0xF;
-    parser->rt_scratch_a_b = (group->b >> 4) & 0x1;
+    bool a_b = (group->b >> 4) & 0x1;
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
+    if (a_b != parser->rt_scratch_a_b) {
+        // new text is starting, drop what was assembled of the old one
+        parser->rt_scratch_a_b = a_b;
+        memset(parser->rt_scratch_str, 0, 64);
+        memset(parser->rt_confidence, 0, 64);
+        rds_clear_rt_segments(parser);
+        parser->changes |= RDS_CHANGE_RT_A_B;
+    }
+#else
+    if (a_b != parser->rt_a_b) {
+        // new text is starting, drop the old one
+        parser->rt_a_b = a_b;
+        memset(parser->rt_str, 0, 64);
+        memset(parser->rt_confidence, 0, 64);
+        rds_clear_rt_segments(parser);
+        parser->changes |= RDS_CHANGE_RT_A_B | RDS_CHANGE_RT;
+    }
+#endif
 
     char chars[4];
+    uint8_t weights[4];
     size_t char_count;
-    size_t char_index;
     if (version == 0) { // group 2A
         chars[0] = group->c >> 8;
         chars[1] = group->c & 0xFF;
         chars[2] = group->d >> 8;
         chars[3] = group->d & 0xFF;
+        weights[0] = weights[1] = rds_get_block_weight(rds_max_block_error(block_errors, 1, 2));
+        weights[2] = weights[3] = rds_get_block_weight(rds_max_block_error(block_errors, 1, 3));
         char_count = 4;
-        char_index = address * 4;
     } else { // group 2B
         chars[0] = group->d >> 8;
         chars[1] = group->d & 0xFF;
+        weights[0] = weights[1] = rds_get_block_weight(rds_max_block_error(block_errors, 1, 3));
         char_count = 2;
-        char_index = address * 2;
     }
+    size_t char_index = address * char_count;
+    size_t end_index = char_count;
+    bool received = true; // every character up to the end of text, or of the segment
 
-    bool finished = false;
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
     for (size_t i = 0; i < char_count; i++) {
         char ch = chars[i];
+        if (weights[i] == 0) {
+            received = false;
+            continue;
+        }
+        rds_update_char(&parser->rt_scratch_str[char_index + i], &parser->rt_confidence[char_index + i], ch, weights[i]);
         if (ch == '\r') {
-            parser->rt_scratch_str[char_index++] = '\0';
-            finished = true;
+            end_index = i;
             break;
         }
-        parser->rt_scratch_str[char_index++] = ch;
-        if (char_index == 64) {
-            finished = true;
+    }
+    if (received) {
+        rds_update_rt_segments(parser, address, char_count, end_index);
+    }
+    // publish once all segments up to the end are in, whichever arrived last
+    bool finished = rds_is_radio_text_complete(parser) && rds_is_confident(parser->rt_confidence, parser->rt_length);
+    if (finished) {
+        size_t length = parser->rt_length;
+        char rt_str[64];
+        memcpy(rt_str, parser->rt_scratch_str, length);
+        memset(rt_str + length, 0, 64 - length);
+        if (rt_str[length - 1] == '\r') {
+            rt_str[length - 1] = '\0';
+        }
+        if (memcmp(parser->rt_str, rt_str, 64) != 0 || parser->rt_a_b != parser->rt_scratch_a_b) {
+            memcpy(parser->rt_str, rt_str, 64);
+            parser->rt_a_b = parser->rt_scratch_a_b;
+            parser->changes |= RDS_CHANGE_RT;
+        }
+    }
+#else
+    // decode in place, the end of text is stored as string terminator
+    for (size_t i = 0; i < char_count; i++) {
+        char ch = (chars[i] != '\r') ? chars[i] : '\0';
+        if (weights[i] == 0) {
+            received = false;
+            continue;
+        }
+        char old_ch = parser->rt_str[char_index + i];
+        rds_update_char(&parser->rt_str[char_index + i], &parser->rt_confidence[char_index + i], ch, weights[i]);
+        if (parser->rt_str[char_index + i] != old_ch) {
+            parser->changes |= RDS_CHANGE_RT;
+        }
+        if (ch == '\0') {
+            end_index = i;
             break;
         }
     }
-    if (finished) {
-        memcpy(parser->rt_str, parser->rt_scratch_str, 64);
-        parser->rt_a_b = parser->rt_scratch_a_b;
+    if (received) {
+        rds_update_rt_segments(parser, address, char_count, end_index);
     }
+#endif
 }
 #endif // RDS_PARSER_RADIO_TEXT_ENABLE
 
+#if RDS_PARSER_PROGRAM_ITEM_ENABLE
+static void rds_parse_group_program_item(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    // group 1A
+    if (rds_get_block_error(block_errors, 3) <= RDS_BLOCK_ERROR_LOW) {
+        rds_set_field(parser, pin, group->d, RDS_CHANGE_PROGRAM_ITEM);
+    }
+    uint8_t variant = (group->c >> 12) & 0x7;
+    if (variant == 0 && rds_get_block_error(block_errors, 2) <= RDS_BLOCK_ERROR_LOW) {
+        rds_set_field(parser, ecc, group->c & 0xFF, RDS_CHANGE_PROGRAM_ITEM);
+    }
+}
+#endif // RDS_PARSER_PROGRAM_ITEM_ENABLE
+
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+static void rds_parse_group_clock_time(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    // group 4A, a wrong time is worse than none
+    if (RDS_BLOCK_ERROR_LOW < rds_max_block_error(block_errors, 2, 3)) {
+        return;
+    }
+    uint32_t mjd = ((uint32_t)(group->b & 0x3) << 15) | (group->c >> 1);
+    uint8_t hour = ((group->c & 0x1) << 4) | (group->d >> 12);
+    uint8_t minute = (group->d >> 6) & 0x3F;
+    int8_t offset = group->d & 0x1F;
+    if (hour > 23 || minute > 59) {
+        return;
+    }
+    if (group->d & 0x20) {
+        offset = -offset;
+    }
+    rds_clock_time_t *clock_time = &parser->clock_time;
+    bool changed = !parser->has_clock_time || clock_time->mjd != mjd || clock_time->hour != hour
+        || clock_time->minute != minute || clock_time->offset != offset;
+    if (changed) {
+        *clock_time = (rds_clock_time_t){mjd, hour, minute, offset};
+        parser->has_clock_time = true;
+        parser->changes |= RDS_CHANGE_CLOCK_TIME;
+    }
+}
+#endif // RDS_PARSER_CLOCK_TIME_ENABLE
+
+#if RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+static void rds_parse_group_program_type_name(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    // group 10A
+    bool a_b = (group->b >> 4) & 0x1;
+    if (a_b != parser->ptyn_scratch_a_b) {
+        // new name
+        parser->ptyn_scratch_a_b = a_b;
+        memset(parser->ptyn_confidence, 0, sizeof(parser->ptyn_confidence));
+    }
+    size_t address = group->b & 0x1;
+    size_t char_index = 4 * address;
+    char chars[4] = {group->c >> 8, group->c & 0xFF, group->d >> 8, group->d & 0xFF};
+    uint8_t weights[4];
+    weights[0] = weights[1] = rds_get_block_weight(rds_max_block_error(block_errors, 1, 2));
+    weights[2] = weights[3] = rds_get_block_weight(rds_max_block_error(block_errors, 1, 3));
+    for (size_t i = 0; i < 4; i++) {
+        if (weights[i] != 0) {
+            rds_update_char(&parser->ptyn_scratch_str[char_index + i], &parser->ptyn_confidence[char_index + i], chars[i], weights[i]);
+        }
+    }
+
+    bool finished = (address == 1) && rds_is_confident(parser->ptyn_confidence, 8);
+    if (finished && memcmp(parser->ptyn_str, parser->ptyn_scratch_str, 8) != 0) {
+        memcpy(parser->ptyn_str, parser->ptyn_scratch_str, 8);
+        parser->changes |= RDS_CHANGE_PROGRAM_TYPE_NAME;
+    }
+}
+#endif // RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+
+#if RDS_PARSER_EON_ENABLE
+static rds_eon_network_t *rds_get_eon_entry(rds_parser_t *parser, uint16_t pi) {
+    for (size_t i = 0; i < parser->eon_count; i++) {
+        if (parser->eon[i].pi == pi) {
+            return &parser->eon[i];
+        }
+    }
+    size_t index;
+    if (parser->eon_count < RDS_PARSER_EON_MAX_NETWORKS) {
+        index = parser->eon_count++;
+    } else {
+        // table full, replace the oldest entry
+        index = parser->eon_next;
+        parser->eon_next = (parser->eon_next + 1) % RDS_PARSER_EON_MAX_NETWORKS;
+    }
+    rds_eon_network_t *network = &parser->eon[index];
+    memset(network, 0, sizeof(rds_eon_network_t));
+    memset(network->ps_str, ' ', 8); // PS segments arrive in any order
+    network->pi = pi;
+    parser->changes |= RDS_CHANGE_EON;
+    return network;
+}
+
+static void rds_parse_eon_network(rds_eon_network_t *network, const rds_group_t *group, uint8_t block_errors) {
+    network->tp = ((group->b >> 4) & 0x1) != 0;
+    uint8_t version = rds_get_group_version(group);
+    if (version != 0) { // group 14B
+        network->ta = ((group->b >> 3) & 0x1) != 0;
+        return;
+    }
+    if (RDS_BLOCK_ERROR_LOW < rds_get_block_error(block_errors, 2)) {
+        return;
+    }
+    // group 14A
+    uint8_t variant = group->b & 0xF;
+    if (variant <= 3) {
+        network->ps_str[2 * variant] = group->c >> 8;
+        network->ps_str[2 * variant + 1] = group->c & 0xFF;
+    } else if (variant == 4) {
+        // AF method A pair
+        uint8_t f[2] = {group->c >> 8, group->c & 0xFF};
+        for (size_t i = 0; i < 2; i++) {
+            bool in_range = (0 < f[i] && f[i] < 205); // skip filler and list headers
+            if (in_range && network->alt_freq_count < sizeof(network->alt_freq)
+                && memchr(network->alt_freq, f[i], network->alt_freq_count) == NULL) {
+                network->alt_freq[network->alt_freq_count++] = f[i];
+            }
+        }
+    } else if (variant == 13) {
+        network->pty = group->c >> 11;
+        network->ta = (group->c & 0x1) != 0;
+    }
+}
+
+static void rds_parse_group_eon(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    // group 14A / 14B, block D holds the PI code of the other network
+    if (RDS_BLOCK_ERROR_LOW < rds_get_block_error(block_errors, 3)) {
+        return;
+    }
+    rds_eon_network_t *network = rds_get_eon_entry(parser, group->d);
+    rds_eon_network_t old_network;
+    memcpy(&old_network, network, sizeof(rds_eon_network_t));
+    rds_parse_eon_network(network, group, block_errors);
+    if (memcmp(&old_network, network, sizeof(rds_eon_network_t)) != 0) {
+        parser->changes |= RDS_CHANGE_EON;
+    }
+}
+#endif // RDS_PARSER_EON_ENABLE
+
+typedef void (*rds_group_handler_t)(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors);
+
+// indexed by group type and version, disabled decoders are left out
+static const rds_group_handler_t RDS_GROUP_HANDLERS[32] = {
+    [RDS_GROUP_INDEX(0, 0)] = rds_parse_group_basic,
+    [RDS_GROUP_INDEX(0, 1)] = rds_parse_group_basic,
+#if RDS_PARSER_PROGRAM_ITEM_ENABLE
+    [RDS_GROUP_INDEX(1, 0)] = rds_parse_group_program_item,
+#endif
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    [RDS_GROUP_INDEX(2, 0)] = rds_parse_group_rt,
+    [RDS_GROUP_INDEX(2, 1)] = rds_parse_group_rt,
+#endif
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+    [RDS_GROUP_INDEX(4, 0)] = rds_parse_group_clock_time,
+#endif
+#if RDS_PARSER_PROGRAM_TYPE_NAME_ENABLE
+    [RDS_GROUP_INDEX(10, 0)] = rds_parse_group_program_type_name,
+#endif
+#if RDS_PARSER_EON_ENABLE
+    [RDS_GROUP_INDEX(14, 0)] = rds_parse_group_eon,
+    [RDS_GROUP_INDEX(14, 1)] = rds_parse_group_eon,
+#endif
+};
+
 //
 // public interface
 //
 
 void rds_parser_reset(rds_parser_t *parser) {
     memset(parser, 0, sizeof(rds_parser_t));
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    rds_clear_rt_segments(parser);
+#endif
+    parser->changes = RDS_CHANGE_ALL;
 }
 
 void rds_parser_update(rds_parser_t *parser, const rds_group_t *group) {
-    parser->pi = rds_get_group_pi(group);
-    parser->pty = rds_get_group_pty(group);
-    parser->tp = rds_get_group_tp(group);
-
-    switch (rds_get_group_type(group)) {
-    case RDS_GROUP_BASIC:
-        rds_parse_group_basic(parser, group);
-        break;
+    rds_parser_update_with_errors(parser, group, 0 /* block_errors */);
+}
+
+void rds_parser_update_with_errors(rds_parser_t *parser, const rds_group_t *group, uint8_t block_errors) {
+    if (rds_get_block_error(block_errors, 1) == RDS_BLOCK_ERROR_UNCORRECTABLE) {
+        return; // unknown group type
+    }
+    if (rds_get_block_error(block_errors, 0) != RDS_BLOCK_ERROR_UNCORRECTABLE) {
+        rds_set_field(parser, pi, rds_get_group_pi(group), RDS_CHANGE_PI);
+    }
+    rds_set_field(parser, pty, rds_get_group_pty(group), RDS_CHANGE_PTY);
+    rds_set_field(parser, tp, rds_get_group_tp(group), RDS_CHANGE_TP);
+
+    rds_group_handler_t handler = RDS_GROUP_HANDLERS[rds_get_group_index(group)];
+    if (handler != NULL) {
+        handler(parser, group, block_errors);
+    }
+}
+
+#if RDS_PARSER_CLOCK_TIME_ENABLE
+void rds_decode_date(uint32_t mjd, uint16_t *year, uint8_t *month, uint8_t *day) {
+    // integer version of the conversion in EN 50067 Annex G
+    uint32_t y = (mjd * 100 - 1507820) / 36525; // years since 1900
+    uint32_t m = (mjd * 10000 - 149561000 - (y * 36525 / 100) * 10000) / 306001;
+    *day = mjd - 14956 - y * 36525 / 100 - m * 306001 / 10000;
+    uint32_t k = (m == 14 || m == 15) ? 1 : 0;
+    *year = 1900 + y + k;
+    *month = m - 1 - k * 12;
+}
+#endif
+
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+void rds_parser_set_tuned_frequency_khz(rds_parser_t *parser, uint32_t frequency_khz) {
+    bool in_range = (87600 <= frequency_khz && frequency_khz <= 107900 && frequency_khz % 100 == 0);
+    parser->alt_freq_tuned = in_range ? (frequency_khz - 87500) / 100 : 0;
+}
+#endif
+
+uint8_t rds_get_program_service_name_partial(const rds_parser_t *parser, char *str) {
+    for (size_t i = 0; i < 8; i++) {
+        str[i] = (parser->ps_confidence[i] != 0) ? parser->ps_scratch_str[i] : ' ';
+    }
+    str[8] = '\0';
+    return parser->ps_segments;
+}
+
 #if RDS_PARSER_RADIO_TEXT_ENABLE
-    case RDS_GROUP_RT:
-        rds_parse_group_rt(parser, group);
-        break;
+size_t rds_get_radio_text_partial(const rds_parser_t *parser, char *str) {
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
+    const char *text = parser->rt_scratch_str;
+#else
+    const char *text = parser->rt_str; // end of text already stored as terminator
 #endif
-    default:
-        break;
+    size_t length = 0;
+    for (size_t i = 0; i < 64; i++) {
+        if (parser->rt_confidence[i] == 0) {
+            str[i] = ' '; // missing
+            continue;
+        }
+        char ch = text[i];
+        if (ch == '\r' || ch == '\0') {
+            break;
+        }
+        str[i] = ch;
+        length = i + 1;
     }
+    str[length] = '\0';
+    return length;
 }
+#endif
 
 void rds_get_program_id_as_str(const rds_parser_t *parser, char *str) {
     str[0] = hex_to_char(parser->pi >> 12);
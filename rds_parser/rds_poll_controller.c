@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <rds_poll_controller.h>
+#include <string.h>
+
+static uint32_t rds_checksum_str(uint32_t checksum, const char *str) {
+    // FNV-1a, cheap enough to run on every poll
+    for (; *str != '\0'; str++) {
+        checksum = (checksum ^ (uint8_t)*str) * 16777619u;
+    }
+    return checksum;
+}
+
+static uint32_t rds_checksum_parser(const rds_parser_t *parser) {
+    uint32_t checksum = 2166136261u;
+    checksum = (checksum ^ parser->pi) * 16777619u;
+    checksum = rds_checksum_str(checksum, rds_get_program_service_name_str(parser));
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    checksum = rds_checksum_str(checksum, rds_get_radio_text_str(parser));
+#endif
+    return checksum;
+}
+
+//
+// public interface
+//
+
+void rds_poll_controller_init(rds_poll_controller_t *controller, rds_poll_config_t config) {
+    memset(controller, 0, sizeof(rds_poll_controller_t));
+    controller->config = config;
+}
+
+void rds_poll_controller_reset(rds_poll_controller_t *controller, uint64_t now) {
+    controller->fast_until_time = now + controller->config.fast_duration_ms * 1000;
+    controller->last_change_time = now;
+}
+
+uint16_t rds_poll_controller_update(rds_poll_controller_t *controller, const rds_parser_t *parser, bool rds_sync, uint64_t now) {
+    const rds_poll_config_t *config = &controller->config;
+
+    uint32_t checksum = rds_checksum_parser(parser);
+    if (checksum != controller->checksum) {
+        controller->checksum = checksum;
+        controller->last_change_time = now;
+    }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+#if RDS_PARSER_RADIO_TEXT_DOUBLE_BUFFER_ENABLE
+    bool rt_a_b = parser->rt_scratch_a_b; // toggles with the first segment, not when the text is published
+#else
+    bool rt_a_b = rds_has_alternative_radio_text(parser);
+#endif
+    if (rt_a_b != controller->rt_a_b) {
+        // new Radio Text is starting
+        controller->rt_a_b = rt_a_b;
+        rds_poll_controller_reset(controller, now);
+    }
+#endif
+
+    if (now < controller->fast_until_time) {
+        return config->fast_interval_ms;
+    }
+    if (!rds_sync) {
+        return config->no_sync_interval_ms;
+    }
+    if (controller->last_change_time + config->stable_after_ms * 1000 <= now) {
+        return config->stable_interval_ms;
+    }
+    return config->normal_interval_ms;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2021 Valentin Milea <valentin.milea@gmail.com>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <rds_station_cache.h>
+#include <string.h>
+
+static rds_station_t *rds_station_cache_get_slot(rds_station_cache_t *cache, uint32_t frequency_khz) {
+    // same frequency, or a free slot, or the least recently used one
+    rds_station_t *slot = &cache->stations[0];
+    for (size_t i = 0; i < RDS_STATION_CACHE_SIZE; i++) {
+        rds_station_t *station = &cache->stations[i];
+        if (station->frequency_khz == frequency_khz) {
+            return station;
+        }
+        if (slot->frequency_khz != 0 && (station->frequency_khz == 0 || station->last_used < slot->last_used)) {
+            slot = station;
+        }
+    }
+    return slot;
+}
+
+static void rds_station_cache_restore(const rds_station_t *station, rds_parser_t *parser) {
+    // only fill fields that haven't been decoded yet
+    if (parser->ps_str[0] == '\0') {
+        memcpy(parser->ps_str, station->ps_str, sizeof(parser->ps_str));
+        parser->changes |= RDS_CHANGE_PS;
+    }
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    if (parser->rt_str[0] == '\0' && station->rt_str[0] != '\0') {
+        memcpy(parser->rt_str, station->rt_str, sizeof(parser->rt_str));
+        parser->rt_a_b = station->rt_a_b;
+        parser->changes |= RDS_CHANGE_RT;
+    }
+#endif
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    if (parser->alt_freq_head == 0 && parser->alt_freq_count == 0 && station->alt_freq_count != 0) {
+        // a repeated list header will be recognized and keep the list
+        memcpy(parser->alt_freq, station->alt_freq, station->alt_freq_count);
+        parser->alt_freq_count = station->alt_freq_count;
+        parser->alt_freq_expected = station->alt_freq_expected;
+        parser->alt_freq_head = station->alt_freq_head;
+        parser->alt_freq_method = station->alt_freq_method;
+        parser->changes |= RDS_CHANGE_ALT_FREQ;
+    }
+#endif
+}
+
+//
+// public interface
+//
+
+void rds_station_cache_init(rds_station_cache_t *cache) {
+    memset(cache, 0, sizeof(rds_station_cache_t));
+}
+
+void rds_station_cache_store(rds_station_cache_t *cache, const rds_parser_t *parser) {
+    if (cache->frequency_khz == 0 || parser->pi == 0 || parser->ps_str[0] == '\0') {
+        return; // nothing worth caching
+    }
+    rds_station_t entry;
+    memset(&entry, 0, sizeof(rds_station_t));
+    entry.frequency_khz = cache->frequency_khz;
+    entry.pi = parser->pi;
+    entry.pty = parser->pty;
+    memcpy(entry.ps_str, parser->ps_str, sizeof(entry.ps_str));
+#if RDS_PARSER_RADIO_TEXT_ENABLE
+    memcpy(entry.rt_str, parser->rt_str, sizeof(entry.rt_str));
+    entry.rt_a_b = parser->rt_a_b;
+#endif
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    memcpy(entry.alt_freq, parser->alt_freq, parser->alt_freq_count);
+    entry.alt_freq_count = parser->alt_freq_count;
+    entry.alt_freq_expected = parser->alt_freq_expected;
+    entry.alt_freq_head = parser->alt_freq_head;
+    entry.alt_freq_method = parser->alt_freq_method;
+#endif
+    rds_station_t *station = rds_station_cache_get_slot(cache, cache->frequency_khz);
+    entry.last_used = station->last_used;
+    if (memcmp(station, &entry, sizeof(rds_station_t)) == 0) {
+        return; // unchanged, leave the LRU clock alone so a persisted cache compares equal
+    }
+    entry.last_used = ++cache->use_count;
+    memcpy(station, &entry, sizeof(rds_station_t));
+}
+
+void rds_station_cache_retune(rds_station_cache_t *cache, rds_parser_t *parser, uint32_t frequency_khz) {
+    rds_station_cache_store(cache, parser);
+    rds_parser_reset(parser);
+#if RDS_PARSER_ALTERNATIVE_FREQUENCIES_ENABLE
+    rds_parser_set_tuned_frequency_khz(parser, frequency_khz);
+#endif
+    cache->frequency_khz = frequency_khz;
+    cache->restore_pending = (rds_station_cache_find(cache, frequency_khz) != NULL);
+}
+
+bool rds_station_cache_update(rds_station_cache_t *cache, rds_parser_t *parser) {
+    if (!cache->restore_pending || parser->pi == 0) {
+        return false;
+    }
+    cache->restore_pending = false;
+    rds_station_t *station = rds_station_cache_get_slot(cache, cache->frequency_khz);
+    if (station->frequency_khz != cache->frequency_khz || station->pi != parser->pi) {
+        return false; // different station on this frequency now
+    }
+    station->last_used = ++cache->use_count;
+    rds_station_cache_restore(station, parser);
+    return true;
+}
+
+const rds_station_t *rds_station_cache_find(const rds_station_cache_t *cache, uint32_t frequency_khz) {
+    for (size_t i = 0; i < RDS_STATION_CACHE_SIZE; i++) {
+        const rds_station_t *station = &cache->stations[i];
+        if (station->frequency_khz != 0 && station->frequency_khz == frequency_khz) {
+            return station;
+        }
+    }
+    return NULL;
+}